@@ -0,0 +1,247 @@
+/*--------------------------------------------------------------------*/
+/* benchhash.c                                                        */
+/* Author: Kevin Castro                                               */
+/*--------------------------------------------------------------------*/
+
+#include "hashfn.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*--------------------------------------------------------------------*/
+
+/* The bucket count of the old fixed-size expanding table at its
+   largest, reduced modulo by the classic hash. */
+enum {CLASSIC_PRIME = 65521};
+
+/* Number of times each key set is hashed when timing. */
+enum {TIMING_ROUNDS = 20};
+
+/* A set of keys, stored back to back in one buffer. */
+struct KeySet
+{
+   /* Name printed in the report. */
+   const char *pcName;
+   /* The keys, each followed by '\0'. */
+   char *pcBuffer;
+   /* Start offset and length of each key. */
+   size_t *puOffsets;
+   size_t *puLengths;
+   size_t uCount;
+   /* Sum of all key lengths. */
+   size_t uBytes;
+};
+
+/* A hash function under test, and how it picks a bucket. */
+struct Candidate
+{
+   /* Name printed in the report. */
+   const char *pcName;
+   /* The hash function. */
+   size_t (*pfHash)(const char *pcKey, size_t uLength);
+   /* Nonzero to take the hash modulo CLASSIC_PRIME instead of masking
+      it to a power of two. */
+   int iPrime;
+   /* Nonzero to pass the hash through HashFn_mix before masking. */
+   int iMix;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Fill *psKeys with uCount keys printed by pcFormat, which takes the
+   key number as its only argument. Exit with EXIT_FAILURE if memory
+   allocation fails. */
+
+static void makeKeys(struct KeySet *psKeys, const char *pcName,
+   const char *pcFormat, size_t uCount)
+{
+   enum {MAX_KEY_LENGTH = 128};
+   char acKey[MAX_KEY_LENGTH];
+   size_t uCapacity = uCount * 16;
+   size_t uUsed = 0;
+   size_t u;
+
+   psKeys->pcName = pcName;
+   psKeys->uCount = uCount;
+   psKeys->uBytes = 0;
+   psKeys->pcBuffer = (char*)malloc(uCapacity);
+   psKeys->puOffsets = (size_t*)malloc(uCount * sizeof(size_t));
+   psKeys->puLengths = (size_t*)malloc(uCount * sizeof(size_t));
+   if (psKeys->pcBuffer == NULL || psKeys->puOffsets == NULL
+       || psKeys->puLengths == NULL)
+   {
+      fprintf(stderr, "Out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+
+   for (u = 0; u < uCount; u++)
+   {
+      size_t uLength;
+      sprintf(acKey, pcFormat, (unsigned long)u);
+      uLength = strlen(acKey);
+      if (uUsed + uLength + 1 > uCapacity)
+      {
+         uCapacity *= 2;
+         psKeys->pcBuffer = (char*)realloc(psKeys->pcBuffer, uCapacity);
+         if (psKeys->pcBuffer == NULL)
+         {
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
+         }
+      }
+      memcpy(psKeys->pcBuffer + uUsed, acKey, uLength + 1);
+      psKeys->puOffsets[u] = uUsed;
+      psKeys->puLengths[u] = uLength;
+      psKeys->uBytes += uLength;
+      uUsed += uLength + 1;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free the memory owned by *psKeys. */
+
+static void freeKeys(struct KeySet *psKeys)
+{
+   free(psKeys->pcBuffer);
+   free(psKeys->puOffsets);
+   free(psKeys->puLengths);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the bucket that psCandidate assigns to uHash in a table with
+   uBuckets buckets, a power of two. */
+
+static size_t bucketOf(const struct Candidate *psCandidate,
+   size_t uHash, size_t uBuckets)
+{
+   if (psCandidate->iPrime)
+      return uHash % CLASSIC_PRIME;
+   if (psCandidate->iMix)
+      uHash = HashFn_mix(uHash);
+   return uHash & (uBuckets - 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Hash every key of *psKeys with psCandidate, and write its throughput
+   and chain-length distribution to stdout. */
+
+static void benchmark(const struct Candidate *psCandidate,
+   const struct KeySet *psKeys)
+{
+   size_t *puChains;
+   size_t uBuckets = 1;
+   size_t uRound;
+   size_t u;
+   size_t uSink = 0;
+   size_t uMaxChain = 0;
+   size_t uEmpty = 0;
+   double dProbes = 0.0;
+   clock_t iInitialClock;
+   double dSeconds;
+
+   /* Size the table the way the expanding hash table would: at least
+      one bucket per key. */
+   while (uBuckets < psKeys->uCount)
+      uBuckets *= 2;
+   if (psCandidate->iPrime)
+      uBuckets = CLASSIC_PRIME;
+
+   iInitialClock = clock();
+   for (uRound = 0; uRound < TIMING_ROUNDS; uRound++)
+      for (u = 0; u < psKeys->uCount; u++)
+         uSink += bucketOf(psCandidate, (*psCandidate->pfHash)(
+            psKeys->pcBuffer + psKeys->puOffsets[u],
+            psKeys->puLengths[u]), uBuckets);
+   dSeconds = ((double)(clock() - iInitialClock)) / CLOCKS_PER_SEC;
+
+   puChains = (size_t*)calloc(uBuckets, sizeof(size_t));
+   if (puChains == NULL)
+   {
+      fprintf(stderr, "Out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+   for (u = 0; u < psKeys->uCount; u++)
+      puChains[bucketOf(psCandidate, (*psCandidate->pfHash)(
+         psKeys->pcBuffer + psKeys->puOffsets[u],
+         psKeys->puLengths[u]), uBuckets)]++;
+
+   /* A successful search for the i-th node of a chain visits i
+      nodes. */
+   for (u = 0; u < uBuckets; u++)
+   {
+      if (puChains[u] == 0)
+         uEmpty++;
+      if (puChains[u] > uMaxChain)
+         uMaxChain = puChains[u];
+      dProbes += (double)puChains[u] * (double)(puChains[u] + 1) / 2.0;
+   }
+   free(puChains);
+
+   printf("%-22s %-14s %9.1f MB/s  %6.3f probes  max chain %4lu  "
+      "empty %5.1f%%  (%lu)\n",
+      psCandidate->pcName, psKeys->pcName,
+      dSeconds > 0.0 ? (double)psKeys->uBytes * TIMING_ROUNDS
+         / dSeconds / 1e6 : 0.0,
+      psKeys->uCount > 0 ? dProbes / (double)psKeys->uCount : 0.0,
+      (unsigned long)uMaxChain,
+      100.0 * (double)uEmpty / (double)uBuckets,
+      (unsigned long)(uSink & 1));
+   fflush(stdout);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Compare the classic byte-at-a-time hash with the word-at-a-time
+   default on throughput and chain-length distribution. argv[1] is the
+   number of keys in each key set. Exit with EXIT_FAILURE if argv[1] is
+   missing or not a positive number. Otherwise return 0. */
+
+int main(int argc, char *argv[])
+{
+   enum {CANDIDATE_COUNT = 4, KEYSET_COUNT = 3};
+
+   static const struct Candidate asCandidates[CANDIDATE_COUNT] =
+   {
+      {"classic % 65521", HashFn_classic, 1, 0},
+      {"classic & mask", HashFn_classic, 0, 0},
+      {"classic mixed & mask", HashFn_classic, 0, 1},
+      {"words & mask", HashFn_words, 0, 0}
+   };
+   struct KeySet asKeys[KEYSET_COUNT];
+   long lCount;
+   int i;
+   int j;
+
+   if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s keycount\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+   if (sscanf(argv[1], "%ld", &lCount) != 1 || lCount <= 0)
+   {
+      fprintf(stderr, "keycount must be a positive number\n");
+      exit(EXIT_FAILURE);
+   }
+
+   makeKeys(&asKeys[0], "sequential", "%lu", (size_t)lCount);
+   makeKeys(&asKeys[1], "qualified",
+      "module.package.class%lu.field", (size_t)lCount);
+   makeKeys(&asKeys[2], "long",
+      "%lu-aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+      (size_t)lCount);
+
+   printf("Expected probes at one key per bucket with an ideal hash: "
+      "1.500\n");
+   for (j = 0; j < KEYSET_COUNT; j++)
+      for (i = 0; i < CANDIDATE_COUNT; i++)
+         benchmark(&asCandidates[i], &asKeys[j]);
+
+   for (j = 0; j < KEYSET_COUNT; j++)
+      freeKeys(&asKeys[j]);
+   return 0;
+}
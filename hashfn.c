@@ -0,0 +1,82 @@
+/*--------------------------------------------------------------------*/
+/* hashfn.c                                                           */
+/* Author: Kevin Castro                                               */
+/*--------------------------------------------------------------------*/
+
+#include "hashfn.h"
+#include <assert.h>
+#include <string.h>
+#include <stddef.h>
+#include <limits.h>
+
+/* Odd multipliers with well spread bits, and the shift between the
+   two multiplies of HashFn_mix, for a 64-bit or a 32-bit machine. A
+   size_t narrower than unsigned long keeps the low bits of each. */
+#if ULONG_MAX > 0xFFFFFFFFUL
+#define HASHFN_K1 ((size_t)0x9E3779B97F4A7C15UL)
+#define HASHFN_K2 ((size_t)0xBF58476D1CE4E5B9UL)
+#define HASHFN_SHIFT 29
+#else
+#define HASHFN_K1 ((size_t)0x9E3779B9UL)
+#define HASHFN_K2 ((size_t)0x85EBCA6BUL)
+#define HASHFN_SHIFT 13
+#endif
+
+/* Half the width of a size_t, which folds its high half onto its low
+   half whatever the width. */
+#define HASHFN_HALF (CHAR_BIT * sizeof(size_t) / 2)
+
+size_t HashFn_mix(size_t uHash) {
+    uHash ^= uHash >> HASHFN_HALF;
+    uHash *= HASHFN_K2;
+    uHash ^= uHash >> HASHFN_SHIFT;
+    uHash *= HASHFN_K1;
+    uHash ^= uHash >> HASHFN_HALF;
+    return uHash;
+}
+
+size_t HashFn_words(const char *pcKey, size_t uLength) {
+    size_t uHash;
+    size_t uWord;
+
+    assert(pcKey != NULL || uLength == 0);
+
+    uHash = uLength * HASHFN_K1;
+
+    /* memcpy lets the compiler emit a single unaligned load for each
+       word, without assuming anything about pcKey's alignment. */
+    while (uLength >= sizeof(size_t)){
+        memcpy(&uWord, pcKey, sizeof(size_t));
+        uHash = (uHash ^ uWord) * HASHFN_K1;
+        uHash ^= uHash >> 23;
+        pcKey += sizeof(size_t);
+        uLength -= sizeof(size_t);
+    }
+
+    if (uLength > 0)
+    {
+        /* A byte loop beats a variable-length memcpy call here, since
+           at most sizeof(size_t)-1 bytes remain. */
+        uWord = 0;
+        while (uLength > 0){
+            uLength--;
+            uWord = (uWord << 8) | (size_t)(unsigned char)pcKey[uLength];
+        }
+        uHash = (uHash ^ uWord) * HASHFN_K1;
+        uHash ^= uHash >> 23;
+    }
+
+    return HashFn_mix(uHash);
+}
+
+size_t HashFn_classic(const char *pcKey, size_t uLength) {
+    const size_t HASH_MULTIPLIER = 65599;
+    size_t u;
+    size_t uHash = 0;
+
+    assert(pcKey != NULL || uLength == 0);
+
+    for (u = 0; u < uLength; u++)
+        uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+    return uHash;
+}
@@ -0,0 +1,27 @@
+/*--------------------------------------------------------------------*/
+/* hashfn.h                                                           */
+/* Author: Kevin Castro                                               */
+/*--------------------------------------------------------------------*/
+
+#ifndef HASHFN_INCLUDED
+#define HASHFN_INCLUDED
+
+#include <stddef.h>
+
+/* Return a hash code for the uLength bytes at pcKey, consuming them a
+   machine word at a time. Every bit of the result depends on every
+   byte of the key, so any run of bits can serve as a bucket index. */
+size_t HashFn_words(const char *pcKey, size_t uLength);
+
+/* Return a hash code for the uLength bytes at pcKey, computed one byte
+   at a time with the multiplier 65599 from the assignment
+   specification. The low bits depend mostly on the last few bytes, so
+   the result should be reduced modulo a prime or passed through
+   HashFn_mix. */
+size_t HashFn_classic(const char *pcKey, size_t uLength);
+
+/* Return uHash with its bits mixed so that every bit of the result
+   depends on every bit of uHash. */
+size_t HashFn_mix(size_t uHash);
+
+#endif
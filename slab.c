@@ -0,0 +1,225 @@
+/*--------------------------------------------------------------------*/
+/* slab.c                                                             */
+/* Author: Kevin Castro                                               */
+/*--------------------------------------------------------------------*/
+
+#include "slab.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+/* Block sizes are rounded up to a multiple of SLAB_GRANULE, which is
+   also the alignment of every block. */
+enum {SLAB_GRANULE = 16};
+
+/* Number of size classes kept on free lists. Larger blocks get a
+   malloc of their own. */
+enum {SLAB_CLASSES = 32};
+
+/* Size of the first chunk, and the size that chunks stop doubling at. */
+enum {SLAB_FIRST_CHUNK = 4096, SLAB_MAX_CHUNK = 1 << 20};
+
+/* Every chunk, and every large block, starts with a SlabChunk header
+   linking it into its list. */
+struct SlabChunk {
+    /* The next chunk or large block*/
+    struct SlabChunk *next;
+    /* The previous large block; unused for chunks*/
+    struct SlabChunk *prev;
+};
+
+/* Bytes reserved at the start of a chunk for its header, rounded up so
+   that the blocks after it stay aligned. */
+#define SLAB_HEADER \
+    ((sizeof(struct SlabChunk) + SLAB_GRANULE - 1) / SLAB_GRANULE \
+     * SLAB_GRANULE)
+
+struct Slab {
+    /*Every chunk allocated so far*/
+    struct SlabChunk *chunks;
+    /*Every large block currently allocated, doubly linked*/
+    struct SlabChunk *large;
+    /*The unused part of the newest chunk runs from next to end*/
+    char *next;
+    char *end;
+    /*Size of the next chunk to allocate*/
+    size_t chunksize;
+    /*Released blocks of each size class, linked through their first
+    word*/
+    void *freelists[SLAB_CLASSES];
+};
+
+Slab_T Slab_new(void){
+    Slab_T slabnew;
+    size_t index;
+
+    slabnew = (Slab_T)malloc(sizeof(struct Slab));
+    if (slabnew == NULL)
+    {
+        return NULL;
+    }
+
+    slabnew->chunks = NULL;
+    slabnew->large = NULL;
+    slabnew->next = NULL;
+    slabnew->end = NULL;
+    slabnew->chunksize = SLAB_FIRST_CHUNK;
+    for (index = 0; index < SLAB_CLASSES; index++)
+        slabnew->freelists[index] = NULL;
+    return slabnew;
+}
+
+void Slab_free(Slab_T oSlab){
+    struct SlabChunk *currchunk;
+    struct SlabChunk *nextchunk;
+
+    assert(oSlab != NULL);
+
+    for (currchunk = oSlab->chunks; currchunk != NULL;
+         currchunk = nextchunk){
+        nextchunk = currchunk->next;
+        free(currchunk);
+    }
+    for (currchunk = oSlab->large; currchunk != NULL;
+         currchunk = nextchunk){
+        nextchunk = currchunk->next;
+        free(currchunk);
+    }
+    free(oSlab);
+}
+
+void Slab_absorb(Slab_T oSlab, Slab_T oOther){
+    struct SlabChunk *lastchunk;
+    void **lastblock;
+    size_t index;
+
+    assert(oSlab != NULL);
+    assert(oOther != NULL);
+
+    if (oOther->chunks != NULL)
+    {
+        for (lastchunk = oOther->chunks; lastchunk->next != NULL;
+             lastchunk = lastchunk->next)
+            ;
+        lastchunk->next = oSlab->chunks;
+        oSlab->chunks = oOther->chunks;
+    }
+    if (oOther->large != NULL)
+    {
+        for (lastchunk = oOther->large; lastchunk->next != NULL;
+             lastchunk = lastchunk->next)
+            ;
+        lastchunk->next = oSlab->large;
+        if (oSlab->large != NULL)
+            oSlab->large->prev = lastchunk;
+        oSlab->large = oOther->large;
+    }
+    for (index = 0; index < SLAB_CLASSES; index++)
+    {
+        if (oOther->freelists[index] == NULL)
+            continue;
+        for (lastblock = (void**)oOther->freelists[index];
+             *lastblock != NULL; lastblock = (void**)*lastblock)
+            ;
+        *lastblock = oSlab->freelists[index];
+        oSlab->freelists[index] = oOther->freelists[index];
+    }
+    /* The unused tail of oOther's newest chunk is given up. */
+    free(oOther);
+}
+
+/* Return a block of uSize bytes, a size too large for the free lists,
+   with a malloc of its own. Returns NULL if memory allocation fails. */
+static void *Slab_allocLarge(Slab_T oSlab, size_t uSize){
+    struct SlabChunk *block;
+
+    if (uSize > (size_t)-1 - SLAB_HEADER)
+    {
+        return NULL;
+    }
+    block = (struct SlabChunk*)malloc(SLAB_HEADER + uSize);
+    if (block == NULL)
+    {
+        return NULL;
+    }
+
+    block->prev = NULL;
+    block->next = oSlab->large;
+    if (oSlab->large != NULL)
+        oSlab->large->prev = block;
+    oSlab->large = block;
+    return (char*)block + SLAB_HEADER;
+}
+
+void *Slab_alloc(Slab_T oSlab, size_t uSize){
+    size_t class;
+    size_t rounded;
+    void *block;
+
+    assert(oSlab != NULL);
+
+    if (uSize == 0)
+        uSize = 1;
+    if (uSize > (size_t)SLAB_CLASSES * SLAB_GRANULE)
+    {
+        return Slab_allocLarge(oSlab, uSize);
+    }
+
+    class = (uSize - 1) / SLAB_GRANULE;
+    rounded = (class + 1) * SLAB_GRANULE;
+
+    block = oSlab->freelists[class];
+    if (block != NULL)
+    {
+        oSlab->freelists[class] = *(void**)block;
+        return block;
+    }
+
+    if ((size_t)(oSlab->end - oSlab->next) < rounded)
+    {
+        struct SlabChunk *chunk;
+
+        chunk = (struct SlabChunk*)malloc(oSlab->chunksize);
+        if (chunk == NULL)
+        {
+            return NULL;
+        }
+        chunk->next = oSlab->chunks;
+        oSlab->chunks = chunk;
+        oSlab->next = (char*)chunk + SLAB_HEADER;
+        oSlab->end = (char*)chunk + oSlab->chunksize;
+        if (oSlab->chunksize < SLAB_MAX_CHUNK)
+            oSlab->chunksize *= 2;
+    }
+
+    block = oSlab->next;
+    oSlab->next += rounded;
+    return block;
+}
+
+void Slab_release(Slab_T oSlab, void *pvBlock, size_t uSize){
+    size_t class;
+
+    assert(oSlab != NULL);
+    assert(pvBlock != NULL);
+
+    if (uSize == 0)
+        uSize = 1;
+    if (uSize > (size_t)SLAB_CLASSES * SLAB_GRANULE)
+    {
+        struct SlabChunk *block =
+            (struct SlabChunk*)(void*)((char*)pvBlock - SLAB_HEADER);
+        if (block->prev != NULL)
+            block->prev->next = block->next;
+        else
+            oSlab->large = block->next;
+        if (block->next != NULL)
+            block->next->prev = block->prev;
+        free(block);
+        return;
+    }
+
+    class = (uSize - 1) / SLAB_GRANULE;
+    *(void**)pvBlock = oSlab->freelists[class];
+    oSlab->freelists[class] = pvBlock;
+}
@@ -0,0 +1,38 @@
+/*--------------------------------------------------------------------*/
+/* slab.h                                                             */
+/* Author: Kevin Castro                                               */
+/*--------------------------------------------------------------------*/
+
+#ifndef SLAB_INCLUDED
+#define SLAB_INCLUDED
+
+#include <stddef.h>
+
+/* A Slab_T hands out small blocks of memory carved from a few large
+   chunks. Released blocks are kept for reuse by later allocations of
+   the same size class, and everything is returned to the system at
+   once by Slab_free. */
+typedef struct Slab *Slab_T;
+
+/* Returns a Slab_T that owns no memory yet. Returns NULL if memory
+   allocation fails. */
+Slab_T Slab_new(void);
+
+/* Frees oSlab and every block that was ever allocated from it. */
+void Slab_free(Slab_T oSlab);
+
+/* Moves every block of oOther, allocated or released, into oSlab and
+   frees oOther. Lets blocks allocated from private slabs by separate
+   threads end up owned by one slab. */
+void Slab_absorb(Slab_T oSlab, Slab_T oOther);
+
+/* Returns a block of at least uSize bytes from oSlab, aligned for any
+   of the object types stored in a symbol table node. Returns NULL if
+   memory allocation fails. */
+void *Slab_alloc(Slab_T oSlab, size_t uSize);
+
+/* Returns the block pvBlock, which was allocated from oSlab with size
+   uSize, to oSlab for reuse. */
+void Slab_release(Slab_T oSlab, void *pvBlock, size_t uSize);
+
+#endif
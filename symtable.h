@@ -11,10 +11,20 @@
 /* A SymTable_T is a collection of key and value pairs */
 typedef struct Stack *SymTable_T; 
 
+/* A SymTable_HashFunction returns a hash code for the uLength bytes
+at pcKey. Equal keys must get equal hash codes. The table mixes the
+result itself, so the function need not spread its bits evenly. */
+typedef size_t (*SymTable_HashFunction)(const char *pcKey, size_t uLength);
+
 /*Returns a SymTable_T that is empty with no bindings. Returns NULL
 if the memory allocation results in NULL.*/
 SymTable_T SymTable_new(void);
 
+/*Returns a SymTable_T that is empty with no bindings and that hashes
+keys with pfHash, or with the default word-at-a-time hash if pfHash is
+NULL. Returns NULL if the memory allocation results in NULL.*/
+SymTable_T SymTable_newWithHash(SymTable_HashFunction pfHash);
+
 /* Frees all memory that is allocated for oSymTable. */
 void SymTable_free(SymTable_T oSymTable);
 
@@ -59,6 +69,195 @@ void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
 const void *pvExtra);
 
 
+/*--------------------------------------------------------------------*/
+/* The functions below are extensions provided by the list and hash
+   table implementations. */
+
+/*Returns a SymTable_T that is empty with no bindings and that can hold
+uCapacity bindings without resizing. Returns NULL if the memory
+allocation results in NULL.*/
+SymTable_T SymTable_newWithCapacity(size_t uCapacity);
+
+/* Resizes oSymTable at once, if needed, so that it can hold uCapacity
+bindings without resizing again, and keeps it from shrinking below that
+size. Returns 1 on success. Returns 0 if memory allocation fails, in
+which case oSymTable still holds the same bindings. */
+int SymTable_reserve(SymTable_T oSymTable, size_t uCapacity);
+
+/* These behave like their counterparts without the
+trailing n, except that the key is the uLength bytes at pcKey rather
+than a '\0'-terminated string. pcKey need not be '\0'-terminated, so
+keys can be looked up in place inside a larger buffer. A key stored by
+SymTable_putn is copied and given a terminating '\0', which is how
+SymTable_map presents it. */
+int SymTable_putn(SymTable_T oSymTable, const char *pcKey,
+size_t uLength, const void *pvValue);
+
+void *SymTable_replacen(SymTable_T oSymTable, const char *pcKey,
+size_t uLength, const void *pvValue);
+
+int SymTable_containsn(SymTable_T oSymTable, const char *pcKey,
+size_t uLength);
+
+void *SymTable_getn(SymTable_T oSymTable, const char *pcKey,
+size_t uLength);
+
+void *SymTable_removen(SymTable_T oSymTable, const char *pcKey,
+size_t uLength);
+
+/* Binds pcKey to pvValue in oSymTable, adding a binding if pcKey has
+none and replacing the value otherwise, with a single lookup. Returns
+the value pcKey was bound to before, or NULL if it had no binding. If
+piAdded is not NULL, sets *piAdded to 0 if a binding was replaced, 1 if
+one was added, or -1 if memory allocation failed and oSymTable is
+unchanged. */
+void *SymTable_upsert(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue, int *piAdded);
+
+/* Returns the value bound to pcKey in oSymTable if there is one.
+Otherwise adds a binding of pcKey to pvValue and returns pvValue. Only
+one lookup is done either way. If piAdded is not NULL, sets *piAdded to
+0 if the binding existed, 1 if it was added, or -1 if memory allocation
+failed, in which case NULL is returned and oSymTable is unchanged. */
+void *SymTable_getOrPut(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue, int *piAdded);
+
+/* Stores in apvValues[i] the value bound to apcKeys[i] in oSymTable, or
+NULL if apcKeys[i] has no binding, for each i below uCount. The hash
+table implementation overlaps the memory accesses of neighbouring
+keys, which makes a batch faster than separate SymTable_get calls on
+tables larger than the cache. */
+void SymTable_getBatch(SymTable_T oSymTable, const char *const apcKeys[],
+size_t uCount, void *apvValues[]);
+
+/* Stores in aiFound[i] 1 if oSymTable contains a binding with key
+apcKeys[i] and 0 otherwise, for each i below uCount. */
+void SymTable_containsBatch(SymTable_T oSymTable,
+const char *const apcKeys[], size_t uCount, int aiFound[]);
+
+/* Adds a binding of apcKeys[i] to apvValues[i] to oSymTable for each i
+below uCount, using up to uThreads threads. Sets aiResults[i] to 1 if
+the binding was added, 0 if apcKeys[i] was already bound, either in
+oSymTable or earlier in the batch, or -1 if memory allocation failed.
+Existing bindings are left unchanged, as with SymTable_put. Returns the
+number of bindings added. The hash table implementation splits its
+buckets into ranges, one per thread, so oSymTable's hash function must
+be safe to call from several threads at once. */
+size_t SymTable_putBatch(SymTable_T oSymTable, const char *const apcKeys[],
+const void *const apvValues[], size_t uCount, size_t uThreads,
+int aiResults[]);
+
+/* Applies *pfApply to every binding of oSymTable, as SymTable_map
+does, using up to uThreads threads that each handle a share of the
+buckets. apvExtra holds uThreads pointers, and every call of *pfApply
+made by the i-th thread is passed apvExtra[i], so that each thread can
+accumulate into its own state without locking. Some of the pointers
+go unused when fewer threads are worth starting, and the list
+implementation uses only apvExtra[0]. *pfApply must not change
+oSymTable. */
+void SymTable_mapParallel(SymTable_T oSymTable,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *const apvExtra[], size_t uThreads);
+
+/* A SymTable_Key is a key whose hash has been computed ahead of time,
+so that looking it up in many tables hashes it only once. It refers to
+the caller's key bytes rather than copying them, so they must stay
+unchanged while the SymTable_Key is in use. The fields are filled in by
+SymTable_prepareKey and should be treated as read-only. */
+struct SymTable_Key {
+    /* The key bytes and their number*/
+    const char *pcKey;
+    size_t uLength;
+    /* The full hash of the key, valid however a table is resized*/
+    size_t uHash;
+    /* The hash function uHash was computed with, NULL for the default*/
+    SymTable_HashFunction pfHash;
+};
+
+/* Fills *psKey with the uLength bytes at pcKey and their hash under
+pfHash, or under the default hash if pfHash is NULL. *psKey can then be
+used with any table; with a table created for the same hash function it
+is never hashed again. */
+void SymTable_prepareKey(struct SymTable_Key *psKey, const char *pcKey,
+size_t uLength, SymTable_HashFunction pfHash);
+
+/* Behaves like SymTable_putn with the key of *psKey. */
+int SymTable_putPrepared(SymTable_T oSymTable,
+const struct SymTable_Key *psKey, const void *pvValue);
+
+/* Behaves like SymTable_getn with the key of *psKey. */
+void *SymTable_getPrepared(SymTable_T oSymTable,
+const struct SymTable_Key *psKey);
+
+/* A SymTable_Iter is a cursor over the bindings of a table. The caller
+provides the storage, usually on the stack, so iterating allocates
+nothing. The fields belong to the implementation. */
+struct SymTable_Iter {
+    /* The table being iterated over*/
+    SymTable_T oSymTable;
+    /* The next binding to visit, or NULL to look in the next bucket*/
+    void *pvNode;
+    /* The next bucket to look in, for the hash table implementation*/
+    size_t uBucket;
+};
+
+/* Starts *psIter at the first binding of oSymTable. The bindings are
+visited in the order SymTable_map visits them. oSymTable must not be
+changed other than by SymTable_replace until SymTable_iterEnd is called
+on *psIter. */
+void SymTable_iterBegin(SymTable_T oSymTable, struct SymTable_Iter *psIter);
+
+/* Moves *psIter to the next binding. If there is one, sets *ppcKey to
+its key and *ppvValue to its value, either of which may be NULL to
+skip it, and returns 1. Returns 0 once every binding has been visited. */
+int SymTable_iterNext(struct SymTable_Iter *psIter, const char **ppcKey,
+void **ppvValue);
+
+/* Ends the iteration *psIter, which may be stopped before every binding
+has been visited. */
+void SymTable_iterEnd(struct SymTable_Iter *psIter);
+
+/* A table can hold nested scopes, as a compiler's symbol table does. It
+starts in the outermost scope, depth 0. SymTable_putScoped binds a key
+in the innermost scope, hiding any binding of the same key from an
+outer scope until the innermost scope is popped. Every other function
+sees only the innermost binding of each key, counts each key once, and
+puts bindings in the outermost scope, and SymTable_remove removes the
+innermost binding, uncovering the one it hid. Scopes share the one
+table, so a lookup costs the same however deep the nesting is. */
+
+/* Enters a new innermost scope. Takes constant time. Returns 1 on
+success, or 0 if memory allocation fails. */
+int SymTable_pushScope(SymTable_T oSymTable);
+
+/* Leaves the innermost scope, removing every binding put in it by
+SymTable_putScoped and uncovering the bindings they hid, in time
+proportional to their number. Returns 1 on success, or 0 if oSymTable
+is in its outermost scope. */
+int SymTable_popScope(SymTable_T oSymTable);
+
+/* Binds pcKey to pvValue in the innermost scope of oSymTable. Returns 1
+on success, or 0 if pcKey is already bound in the innermost scope or
+memory allocation fails. */
+int SymTable_putScoped(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue);
+
+/* Returns the value of the innermost binding of pcKey in oSymTable, or
+NULL if there is none. If there is one and puDepth is not NULL, sets
+*puDepth to the depth of the scope it was put in. */
+void *SymTable_getScoped(SymTable_T oSymTable, const char *pcKey,
+size_t *puDepth);
+
+/* Returns a new SymTable_T holding a copy of every binding of oSymTable
+that the other functions see, with the same hash function and the same
+number of buckets, so the copy never has to resize to catch up. Keys
+and their cached hashes are copied as they are stored, without being
+hashed again. The copy is in its outermost scope: a binding hidden by
+an inner scope is left out, and the binding hiding it belongs to the
+outermost scope of the copy. Changes to either table are not seen in
+the other. Returns NULL if memory allocation fails. */
+SymTable_T SymTable_clone(SymTable_T oSymTable);
+
 #endif
 
 
@@ -0,0 +1,1034 @@
+/*--------------------------------------------------------------------*/
+/* symtableart.c                                                      */
+/* Author: Kevin Castro                                               */
+/*--------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include "symtable.h"
+#include "symtableordered.h"
+#include "slab.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+/* An adaptive radix tree. Each inner node branches on one byte of the
+   key, and comes in four sizes, for up to 4, 16, 48 or 256 children,
+   so that it is only as wide as it needs to be. Nodes grow and shrink
+   between the sizes as children come and go.
+
+   Bytes that every key below a node shares are not given a node each:
+   the node keeps them, partialLength of them, right after itself as its
+   prefix. A leaf keeps only the bytes of its key below the place it
+   hangs from, so the bytes that a run of keys such as module.class.field
+   share are stored once, in the nodes above them, rather than once per
+   key. A lookup costs time proportional to the length of the key rather
+   than the number of bindings.
+
+   A key is taken together with its terminating '\0', so no key is a
+   prefix of another and every binding is a leaf. Children are kept in
+   byte order, and '\0' sorts first, so an in-order walk of the tree
+   visits the keys in strcmp order. Since no leaf holds a whole key, a
+   walk rebuilds each one in the table's key buffer before passing it
+   on; the key passed to a callback is only good until it returns, and
+   a callback must not start another walk of the same table. */
+
+/* Node types. Every node and leaf starts with one of these. */
+enum {ART_LEAF, ART_NODE4, ART_NODE16, ART_NODE48, ART_NODE256};
+
+/* Child counts at which a node shrinks to the next smaller size. */
+enum {SHRINK16 = 3, SHRINK48 = 12, SHRINK256 = 37};
+
+/* A binding. The bytes of the key below the leaf's place in the tree,
+   ending with the key's '\0', follow the leaf in memory. */
+struct ArtLeaf {
+    /* ART_LEAF*/
+    unsigned char type;
+    /* Number of key bytes that follow the leaf*/
+    size_t length;
+    /* Value of the binding*/
+    void *value;
+};
+
+/* What every inner node starts with. The node's prefix follows the
+   whole node in memory. */
+struct ArtNode {
+    /* ART_NODE4, ART_NODE16, ART_NODE48 or ART_NODE256*/
+    unsigned char type;
+    /* Number of children*/
+    unsigned short count;
+    /* Number of bytes shared below this node*/
+    size_t partialLength;
+};
+
+/* Up to 4 children, with their bytes in increasing order. */
+struct ArtNode4 {
+    struct ArtNode node;
+    unsigned char keys[4];
+    void *children[4];
+};
+
+/* Up to 16 children, with their bytes in increasing order. */
+struct ArtNode16 {
+    struct ArtNode node;
+    unsigned char keys[16];
+    void *children[16];
+};
+
+/* Up to 48 children. index[c] is one more than the slot of the child
+   for byte c, or 0 if there is none. */
+struct ArtNode48 {
+    struct ArtNode node;
+    unsigned char index[256];
+    void *children[48];
+};
+
+/* A child, or NULL, for every byte. */
+struct ArtNode256 {
+    struct ArtNode node;
+    void *children[256];
+};
+
+/*A stack is the root of the tree: a leaf, an inner node, or NULL if
+the tree is empty.*/
+struct Stack {
+    /*The root*/
+    void *root;
+    /*Number of bindings in the tree*/
+    size_t bindings;
+    /*Allocator for nodes and leaves*/
+    Slab_T nodes;
+    /*Where walks rebuild keys: room for the longest key ever put, with
+    its '\0'*/
+    char *keybuffer;
+    size_t buffersize;
+};
+
+/* Return the smaller of uFirst and uSecond. */
+static size_t SymTable_min(size_t uFirst, size_t uSecond) {
+    return uFirst<uSecond?uFirst:uSecond;
+}
+
+/* Return the type of pvNode, a node or leaf. */
+static unsigned char SymTable_type(const void *pvNode) {
+    return *(const unsigned char*)pvNode;
+}
+
+/* Return the size of a node of type iType, not counting its prefix. */
+static size_t SymTable_nodeSize(int iType) {
+    switch (iType) {
+    case ART_LEAF:
+        return sizeof(struct ArtLeaf);
+    case ART_NODE4:
+        return sizeof(struct ArtNode4);
+    case ART_NODE16:
+        return sizeof(struct ArtNode16);
+    case ART_NODE48:
+        return sizeof(struct ArtNode48);
+    default:
+        return sizeof(struct ArtNode256);
+    }
+}
+
+/* Return the bytes that follow pvNode: the prefix of a node, or the
+   key bytes of a leaf. */
+static unsigned char *SymTable_bytes(const void *pvNode) {
+    return (unsigned char*)pvNode+SymTable_nodeSize(SymTable_type(pvNode));
+}
+
+/* Return the number of bytes that follow pvNode. */
+static size_t SymTable_byteCount(const void *pvNode) {
+    if (SymTable_type(pvNode)==ART_LEAF)
+    {
+        return ((const struct ArtLeaf*)pvNode)->length;
+    }
+    return ((const struct ArtNode*)pvNode)->partialLength;
+}
+
+/* Return 1 if poLeaf, whose place in the tree is uDepth bytes down, has
+   the key pucKey of length uLength, counting its '\0', and 0
+   otherwise. */
+static int SymTable_leafMatches(const struct ArtLeaf *poLeaf,
+    const unsigned char *pucKey, size_t uLength, size_t uDepth) {
+    return poLeaf->length==uLength-uDepth&&
+        memcmp(SymTable_bytes(poLeaf),pucKey+uDepth,poLeaf->length)==0;
+}
+
+/* Return a new node of type iType with no children and room for a
+   prefix of uPartialLength bytes, or NULL if memory allocation
+   fails. */
+static struct ArtNode *SymTable_newNode(SymTable_T oSymTable, int iType,
+    size_t uPartialLength) {
+    struct ArtNode *node;
+
+    if (uPartialLength>(size_t)-1-SymTable_nodeSize(iType))
+    {
+        return NULL;
+    }
+    node=(struct ArtNode*)Slab_alloc(oSymTable->nodes,SymTable_nodeSize(iType)+uPartialLength);
+    if (node==NULL)
+    {
+        return NULL;
+    }
+    memset(node,0,SymTable_nodeSize(iType));
+    node->type=(unsigned char)iType;
+    node->partialLength=uPartialLength;
+    return node;
+}
+
+/* Return a new leaf binding a key whose bytes below the leaf are the
+   uLength at pucBytes to pvValue, or NULL if memory allocation
+   fails. */
+static struct ArtLeaf *SymTable_newLeaf(SymTable_T oSymTable,
+    const unsigned char *pucBytes, size_t uLength, const void *pvValue) {
+    struct ArtLeaf *leaf;
+
+    if (uLength>(size_t)-1-sizeof(struct ArtLeaf))
+    {
+        return NULL;
+    }
+    leaf=(struct ArtLeaf*)Slab_alloc(oSymTable->nodes,sizeof(struct ArtLeaf)+uLength);
+    if (leaf==NULL)
+    {
+        return NULL;
+    }
+    leaf->type=ART_LEAF;
+    leaf->length=uLength;
+    leaf->value=(void*)pvValue;
+    memcpy(leaf+1,pucBytes,uLength);
+    return leaf;
+}
+
+/* Return pvNode, a node or leaf, to the allocator of oSymTable. */
+static void SymTable_release(SymTable_T oSymTable, void *pvNode) {
+    Slab_release(oSymTable->nodes,pvNode,
+        SymTable_nodeSize(SymTable_type(pvNode))+SymTable_byteCount(pvNode));
+}
+
+/* Return a copy of pvNode, a node or leaf, whose following bytes are
+   its own less the first uDrop, or, if poParent is not NULL, the prefix
+   of poParent and ucByte followed by its own. This is how a node or
+   leaf moves down or up the tree. Returns NULL if memory allocation
+   fails, in which case pvNode is left as it was. */
+static void *SymTable_move(SymTable_T oSymTable, const void *pvNode,
+    size_t uDrop, const struct ArtNode *poParent, unsigned char ucByte) {
+    size_t fixed=SymTable_nodeSize(SymTable_type(pvNode));
+    size_t own=SymTable_byteCount(pvNode)-uDrop;
+    size_t head=0;
+    size_t size;
+    unsigned char *copy;
+
+    if (poParent!=NULL)
+        head=poParent->partialLength+1;
+    size=fixed+head+own;
+    if (size<fixed+own)
+    {
+        return NULL;
+    }
+    copy=(unsigned char*)Slab_alloc(oSymTable->nodes,size);
+    if (copy==NULL)
+    {
+        return NULL;
+    }
+    memcpy(copy,pvNode,fixed);
+    if (poParent!=NULL)
+    {
+        memcpy(copy+fixed,SymTable_bytes(poParent),poParent->partialLength);
+        copy[fixed+head-1]=ucByte;
+    }
+    memcpy(copy+fixed+head,SymTable_bytes(pvNode)+uDrop,own);
+    if (SymTable_type(copy)==ART_LEAF)
+        ((struct ArtLeaf*)copy)->length=head+own;
+    else
+        ((struct ArtNode*)copy)->partialLength=head+own;
+    return copy;
+}
+
+/* Copy the child count and prefix of poSource to poDest, which has
+   room for the prefix. */
+static void SymTable_copyHeader(struct ArtNode *poDest,
+    const struct ArtNode *poSource) {
+    poDest->count=poSource->count;
+    memcpy(SymTable_bytes(poDest),SymTable_bytes(poSource),poSource->partialLength);
+}
+
+/* Return the slot of poNode that holds its child for byte ucByte, or
+   NULL if there is none. */
+static void **SymTable_findChild(struct ArtNode *poNode,
+    unsigned char ucByte) {
+    size_t index;
+
+    switch (poNode->type) {
+    case ART_NODE4: {
+        struct ArtNode4 *node=(struct ArtNode4*)poNode;
+        for (index = 0; index < node->node.count; index++)
+            if (node->keys[index]==ucByte)
+                return &node->children[index];
+        return NULL;
+    }
+    case ART_NODE16: {
+        /* The bytes are sorted, so the search can stop early. */
+        struct ArtNode16 *node=(struct ArtNode16*)poNode;
+        for (index = 0; index < node->node.count&&node->keys[index]<=ucByte; index++)
+            if (node->keys[index]==ucByte)
+                return &node->children[index];
+        return NULL;
+    }
+    case ART_NODE48: {
+        struct ArtNode48 *node=(struct ArtNode48*)poNode;
+        index=node->index[ucByte];
+        return index!=0?&node->children[index-1]:NULL;
+    }
+    default: {
+        struct ArtNode256 *node=(struct ArtNode256*)poNode;
+        return node->children[ucByte]!=NULL?&node->children[ucByte]:NULL;
+    }
+    }
+}
+
+/* Return the child of poNode after the one at position *puCursor, in
+   byte order, store its byte in *pucByte, and advance *puCursor past
+   it, or return NULL if there is none. *puCursor starts at 0. */
+static void *SymTable_nextChild(const struct ArtNode *poNode,
+    size_t *puCursor, unsigned char *pucByte) {
+    switch (poNode->type) {
+    case ART_NODE4: {
+        const struct ArtNode4 *node=(const struct ArtNode4*)poNode;
+        if (*puCursor>=node->node.count)
+            return NULL;
+        *pucByte=node->keys[*puCursor];
+        return node->children[(*puCursor)++];
+    }
+    case ART_NODE16: {
+        const struct ArtNode16 *node=(const struct ArtNode16*)poNode;
+        if (*puCursor>=node->node.count)
+            return NULL;
+        *pucByte=node->keys[*puCursor];
+        return node->children[(*puCursor)++];
+    }
+    case ART_NODE48: {
+        const struct ArtNode48 *node=(const struct ArtNode48*)poNode;
+        for (; *puCursor < 256; (*puCursor)++)
+            if (node->index[*puCursor]!=0)
+            {
+                *pucByte=(unsigned char)*puCursor;
+                return node->children[node->index[(*puCursor)++]-1];
+            }
+        return NULL;
+    }
+    default: {
+        const struct ArtNode256 *node=(const struct ArtNode256*)poNode;
+        for (; *puCursor < 256; (*puCursor)++)
+            if (node->children[*puCursor]!=NULL)
+            {
+                *pucByte=(unsigned char)*puCursor;
+                return node->children[(*puCursor)++];
+            }
+        return NULL;
+    }
+    }
+}
+
+/* Return how many of the prefix bytes of poNode match pucKey, of
+   length uLength, from position uDepth on. */
+static size_t SymTable_checkPrefix(const struct ArtNode *poNode,
+    const unsigned char *pucKey, size_t uLength, size_t uDepth) {
+    const unsigned char *prefix=SymTable_bytes(poNode);
+    size_t limit=SymTable_min(poNode->partialLength,uLength-uDepth);
+    size_t index;
+
+    for (index = 0; index < limit; index++)
+        if (prefix[index]!=pucKey[uDepth+index])
+            break;
+    return index;
+}
+
+/* Add pvChild to poNode, which *ppvRef points to, for byte ucByte. If
+   poNode is full it is replaced, in *ppvRef, by a node of the next
+   size. Returns 1 on success, or 0 if memory allocation fails, in
+   which case nothing is changed. */
+static int SymTable_addChild(SymTable_T oSymTable, struct ArtNode *poNode,
+    void **ppvRef, unsigned char ucByte, void *pvChild) {
+    struct ArtNode *grown;
+    size_t index;
+    size_t slot;
+
+    switch (poNode->type) {
+    case ART_NODE4: {
+        struct ArtNode4 *node=(struct ArtNode4*)poNode;
+        if (node->node.count<4)
+        {
+            for (index = 0; index < node->node.count&&node->keys[index]<ucByte; index++)
+                ;
+            memmove(&node->keys[index+1],&node->keys[index],node->node.count-index);
+            memmove(&node->children[index+1],&node->children[index],(node->node.count-index)*sizeof(void*));
+            node->keys[index]=ucByte;
+            node->children[index]=pvChild;
+            node->node.count++;
+            return 1;
+        }
+        grown=SymTable_newNode(oSymTable,ART_NODE16,poNode->partialLength);
+        if (grown==NULL)
+        {
+            return 0;
+        }
+        SymTable_copyHeader(grown,poNode);
+        memcpy(((struct ArtNode16*)grown)->keys,node->keys,4);
+        memcpy(((struct ArtNode16*)grown)->children,node->children,4*sizeof(void*));
+        break;
+    }
+    case ART_NODE16: {
+        struct ArtNode16 *node=(struct ArtNode16*)poNode;
+        if (node->node.count<16)
+        {
+            for (index = 0; index < node->node.count&&node->keys[index]<ucByte; index++)
+                ;
+            memmove(&node->keys[index+1],&node->keys[index],node->node.count-index);
+            memmove(&node->children[index+1],&node->children[index],(node->node.count-index)*sizeof(void*));
+            node->keys[index]=ucByte;
+            node->children[index]=pvChild;
+            node->node.count++;
+            return 1;
+        }
+        grown=SymTable_newNode(oSymTable,ART_NODE48,poNode->partialLength);
+        if (grown==NULL)
+        {
+            return 0;
+        }
+        SymTable_copyHeader(grown,poNode);
+        for (index = 0; index < 16; index++) {
+            ((struct ArtNode48*)grown)->index[node->keys[index]]=(unsigned char)(index+1);
+            ((struct ArtNode48*)grown)->children[index]=node->children[index];
+        }
+        break;
+    }
+    case ART_NODE48: {
+        struct ArtNode48 *node=(struct ArtNode48*)poNode;
+        if (node->node.count<48)
+        {
+            /* Removals leave holes, so look for a free slot. */
+            for (slot = 0; node->children[slot] != NULL; slot++)
+                ;
+            node->children[slot]=pvChild;
+            node->index[ucByte]=(unsigned char)(slot+1);
+            node->node.count++;
+            return 1;
+        }
+        grown=SymTable_newNode(oSymTable,ART_NODE256,poNode->partialLength);
+        if (grown==NULL)
+        {
+            return 0;
+        }
+        SymTable_copyHeader(grown,poNode);
+        for (index = 0; index < 256; index++)
+            if (node->index[index]!=0)
+                ((struct ArtNode256*)grown)->children[index]=node->children[node->index[index]-1];
+        break;
+    }
+    default: {
+        struct ArtNode256 *node=(struct ArtNode256*)poNode;
+        node->children[ucByte]=pvChild;
+        node->node.count++;
+        return 1;
+    }
+    }
+
+    /* The grown node has room, so adding to it cannot fail. */
+    *ppvRef=grown;
+    SymTable_release(oSymTable,poNode);
+    return SymTable_addChild(oSymTable,grown,ppvRef,ucByte,pvChild);
+}
+
+/* Remove the child of poNode, which *ppvRef points to, for byte
+   ucByte, whose slot is ppvSlot. If poNode is left with few enough
+   children it is replaced, in *ppvRef, by a smaller node, or by its
+   only child, or by NULL if it has none left. If memory for the
+   replacement cannot be allocated, poNode stays as it is. */
+static void SymTable_removeChild(SymTable_T oSymTable, struct ArtNode *poNode,
+    void **ppvRef, unsigned char ucByte, void **ppvSlot) {
+    struct ArtNode *shrunk;
+    size_t index;
+    size_t slot;
+
+    switch (poNode->type) {
+    case ART_NODE4: {
+        struct ArtNode4 *node=(struct ArtNode4*)poNode;
+        void *child;
+
+        index=(size_t)(ppvSlot-node->children);
+        memmove(&node->keys[index],&node->keys[index+1],node->node.count-index-1);
+        memmove(&node->children[index],&node->children[index+1],(node->node.count-index-1)*sizeof(void*));
+        node->node.count--;
+        if (node->node.count>1)
+        {
+            return;
+        }
+        if (node->node.count==0)
+        {
+            *ppvRef=NULL;
+            SymTable_release(oSymTable,poNode);
+            return;
+        }
+
+        /* A node with one child is replaced by that child, which takes
+           this node's prefix and byte in front of its own bytes. */
+        child=SymTable_move(oSymTable,node->children[0],0,poNode,node->keys[0]);
+        if (child==NULL)
+        {
+            return;
+        }
+        SymTable_release(oSymTable,node->children[0]);
+        *ppvRef=child;
+        SymTable_release(oSymTable,poNode);
+        return;
+    }
+    case ART_NODE16: {
+        struct ArtNode16 *node=(struct ArtNode16*)poNode;
+        index=(size_t)(ppvSlot-node->children);
+        memmove(&node->keys[index],&node->keys[index+1],node->node.count-index-1);
+        memmove(&node->children[index],&node->children[index+1],(node->node.count-index-1)*sizeof(void*));
+        node->node.count--;
+        if (node->node.count!=SHRINK16)
+            return;
+        shrunk=SymTable_newNode(oSymTable,ART_NODE4,poNode->partialLength);
+        if (shrunk==NULL)
+            return;
+        SymTable_copyHeader(shrunk,poNode);
+        memcpy(((struct ArtNode4*)shrunk)->keys,node->keys,SHRINK16);
+        memcpy(((struct ArtNode4*)shrunk)->children,node->children,SHRINK16*sizeof(void*));
+        break;
+    }
+    case ART_NODE48: {
+        struct ArtNode48 *node=(struct ArtNode48*)poNode;
+        node->children[node->index[ucByte]-1]=NULL;
+        node->index[ucByte]=0;
+        node->node.count--;
+        if (node->node.count!=SHRINK48)
+            return;
+        shrunk=SymTable_newNode(oSymTable,ART_NODE16,poNode->partialLength);
+        if (shrunk==NULL)
+            return;
+        SymTable_copyHeader(shrunk,poNode);
+        slot=0;
+        for (index = 0; index < 256; index++) {
+            if (node->index[index]!=0)
+            {
+                ((struct ArtNode16*)shrunk)->keys[slot]=(unsigned char)index;
+                ((struct ArtNode16*)shrunk)->children[slot]=node->children[node->index[index]-1];
+                slot++;
+            }
+        }
+        break;
+    }
+    default: {
+        struct ArtNode256 *node=(struct ArtNode256*)poNode;
+        node->children[ucByte]=NULL;
+        node->node.count--;
+        if (node->node.count!=SHRINK256)
+            return;
+        shrunk=SymTable_newNode(oSymTable,ART_NODE48,poNode->partialLength);
+        if (shrunk==NULL)
+            return;
+        SymTable_copyHeader(shrunk,poNode);
+        slot=0;
+        for (index = 0; index < 256; index++) {
+            if (node->children[index]!=NULL)
+            {
+                ((struct ArtNode48*)shrunk)->children[slot]=node->children[index];
+                ((struct ArtNode48*)shrunk)->index[index]=(unsigned char)(slot+1);
+                slot++;
+            }
+        }
+        break;
+    }
+    }
+
+    *ppvRef=shrunk;
+    SymTable_release(oSymTable,poNode);
+}
+
+SymTable_T SymTable_new(void){
+    SymTable_T symtablenew;
+
+    symtablenew =(SymTable_T)malloc(sizeof(struct Stack));
+    if (symtablenew==NULL)
+    {
+        return NULL;
+    }
+
+    symtablenew->nodes=Slab_new();
+    if (symtablenew->nodes==NULL)
+    {
+        free(symtablenew);
+        return NULL;
+    }
+
+    symtablenew->root=NULL;
+    symtablenew->bindings=0;
+    symtablenew->keybuffer=NULL;
+    symtablenew->buffersize=0;
+    return symtablenew;
+}
+
+SymTable_T SymTable_newWithHash(SymTable_HashFunction pfHash){
+    /* Keys are ordered, never hashed. */
+    (void)pfHash;
+    return SymTable_new();
+}
+
+void SymTable_free(SymTable_T oSymTable){
+
+    assert(oSymTable!=NULL);
+
+    /* Every node and leaf lives in the slab. */
+    Slab_free(oSymTable->nodes);
+    free(oSymTable->keybuffer);
+    free(oSymTable);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+
+    assert(oSymTable!=NULL);
+
+    return oSymTable->bindings;
+}
+
+/* Return the leaf of oSymTable with key pucKey, of length uLength
+   counting its '\0', or NULL if there is none. */
+static struct ArtLeaf *SymTable_search(SymTable_T oSymTable,
+    const unsigned char *pucKey, size_t uLength) {
+    void *node=oSymTable->root;
+    void **child;
+    size_t depth=0;
+
+    while (node!=NULL)
+    {
+        struct ArtNode *inner=(struct ArtNode*)node;
+
+        if (inner->type==ART_LEAF)
+        {
+            struct ArtLeaf *leaf=(struct ArtLeaf*)node;
+            return SymTable_leafMatches(leaf,pucKey,uLength,depth)?leaf:NULL;
+        }
+        if (inner->partialLength!=0)
+        {
+            if (SymTable_checkPrefix(inner,pucKey,uLength,depth)!=inner->partialLength)
+            {
+                return NULL;
+            }
+            depth+=inner->partialLength;
+        }
+        if (depth>=uLength)
+        {
+            return NULL;
+        }
+        child=SymTable_findChild(inner,pucKey[depth]);
+        node=child!=NULL?*child:NULL;
+        depth++;
+    }
+    return NULL;
+}
+
+/* Add a binding of pucKey, of length uLength counting its '\0', to
+   pvValue in the subtree that *ppvRef points to, whose keys agree with
+   pucKey on their first uDepth bytes. Returns 1 if the binding was
+   added, 0 if the key was already there, and -1 if memory allocation
+   failed, in which case nothing is changed. */
+static int SymTable_insert(SymTable_T oSymTable, void **ppvRef,
+    const unsigned char *pucKey, size_t uLength, size_t uDepth,
+    const void *pvValue) {
+    struct ArtNode *node=(struct ArtNode*)*ppvRef;
+    struct ArtLeaf *newleaf;
+    struct ArtNode *split;
+    void *moved;
+    void **child;
+    const unsigned char *bytes;
+    size_t diff;
+
+    if (node==NULL)
+    {
+        newleaf=SymTable_newLeaf(oSymTable,pucKey+uDepth,uLength-uDepth,pvValue);
+        if (newleaf==NULL)
+        {
+            return -1;
+        }
+        *ppvRef=newleaf;
+        return 1;
+    }
+
+    if (node->type==ART_LEAF)
+    {
+        struct ArtLeaf *leaf=(struct ArtLeaf*)node;
+
+        if (SymTable_leafMatches(leaf,pucKey,uLength,uDepth))
+        {
+            return 0;
+        }
+
+        /* Both keys end in '\0', so they differ before either ends. A
+           new node takes the bytes they share as its prefix, and the
+           old leaf moves below it, keeping only the bytes after its
+           new byte. */
+        bytes=SymTable_bytes(leaf);
+        for (diff = 0; bytes[diff] == pucKey[uDepth+diff]; diff++)
+            ;
+    }
+    else
+    {
+        if (node->partialLength==0)
+        {
+            diff=0;
+        }
+        else
+        {
+            diff=SymTable_checkPrefix(node,pucKey,uLength,uDepth);
+        }
+        if (diff==node->partialLength)
+        {
+            uDepth+=node->partialLength;
+            child=SymTable_findChild(node,pucKey[uDepth]);
+            if (child!=NULL)
+            {
+                return SymTable_insert(oSymTable,child,pucKey,uLength,uDepth+1,pvValue);
+            }
+
+            newleaf=SymTable_newLeaf(oSymTable,pucKey+uDepth+1,uLength-uDepth-1,pvValue);
+            if (newleaf==NULL)
+            {
+                return -1;
+            }
+            if (!SymTable_addChild(oSymTable,node,ppvRef,pucKey[uDepth],newleaf))
+            {
+                SymTable_release(oSymTable,newleaf);
+                return -1;
+            }
+            return 1;
+        }
+
+        /* The key leaves the prefix part way along, so a new node takes
+           the part before that, with this node, keeping the part after
+           its new byte, and the new leaf below it. */
+        bytes=SymTable_bytes(node);
+    }
+
+    newleaf=SymTable_newLeaf(oSymTable,pucKey+uDepth+diff+1,uLength-uDepth-diff-1,pvValue);
+    split=SymTable_newNode(oSymTable,ART_NODE4,diff);
+    moved=SymTable_move(oSymTable,node,diff+1,NULL,0);
+    if (newleaf==NULL||split==NULL||moved==NULL)
+    {
+        if (newleaf!=NULL)
+            SymTable_release(oSymTable,newleaf);
+        if (split!=NULL)
+            SymTable_release(oSymTable,split);
+        if (moved!=NULL)
+            SymTable_release(oSymTable,moved);
+        return -1;
+    }
+    memcpy(SymTable_bytes(split),pucKey+uDepth,diff);
+    SymTable_addChild(oSymTable,split,ppvRef,bytes[diff],moved);
+    SymTable_addChild(oSymTable,split,ppvRef,pucKey[uDepth+diff],newleaf);
+    SymTable_release(oSymTable,node);
+    *ppvRef=split;
+    return 1;
+}
+
+/* Make the key buffer of oSymTable big enough for a key of uLength
+   bytes, counting its '\0'. Returns 1 on success, or 0 if memory
+   allocation fails. */
+static int SymTable_fitKey(SymTable_T oSymTable, size_t uLength) {
+    char *grown;
+
+    if (uLength<=oSymTable->buffersize)
+    {
+        return 1;
+    }
+    grown=(char*)realloc(oSymTable->keybuffer,uLength);
+    if (grown==NULL)
+    {
+        return 0;
+    }
+    oSymTable->keybuffer=grown;
+    oSymTable->buffersize=uLength;
+    return 1;
+}
+
+int SymTable_put(SymTable_T oSymTable, const char *pcKey, const void *pvValue){
+    size_t length;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    length=strlen(pcKey)+1;
+    if (!SymTable_fitKey(oSymTable,length)||
+        SymTable_insert(oSymTable,&oSymTable->root,(const unsigned char*)pcKey,
+        length,0,pvValue)!=1)
+    {
+        return 0;
+    }
+    oSymTable->bindings++;
+    return 1;
+}
+
+void *SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue){
+    struct ArtLeaf *leaf;
+    void *oldval;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    leaf=SymTable_search(oSymTable,(const unsigned char*)pcKey,strlen(pcKey)+1);
+    if (leaf==NULL)
+    {
+        return NULL;
+    }
+    oldval=leaf->value;
+    leaf->value=(void*)pvValue;
+    return oldval;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    return SymTable_search(oSymTable,(const unsigned char*)pcKey,strlen(pcKey)+1)!=NULL;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+    struct ArtLeaf *leaf;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    leaf=SymTable_search(oSymTable,(const unsigned char*)pcKey,strlen(pcKey)+1);
+    return leaf!=NULL?leaf->value:NULL;
+}
+
+/* Remove the binding with key pucKey, of length uLength counting its
+   '\0', from the subtree that *ppvRef points to, whose keys agree with
+   pucKey on their first uDepth bytes, and store its value in
+   *ppvValue. A subtree left empty is replaced by NULL. Returns 1 if
+   there was such a binding, and 0 otherwise. */
+static int SymTable_delete(SymTable_T oSymTable, void **ppvRef,
+    const unsigned char *pucKey, size_t uLength, size_t uDepth,
+    void **ppvValue) {
+    struct ArtNode *node=(struct ArtNode*)*ppvRef;
+    struct ArtLeaf *leaf;
+    void **child;
+
+    if (node==NULL)
+    {
+        return 0;
+    }
+    if (node->type==ART_LEAF)
+    {
+        leaf=(struct ArtLeaf*)node;
+        if (!SymTable_leafMatches(leaf,pucKey,uLength,uDepth))
+        {
+            return 0;
+        }
+        *ppvValue=leaf->value;
+        *ppvRef=NULL;
+        SymTable_release(oSymTable,leaf);
+        return 1;
+    }
+    if (node->partialLength!=0)
+    {
+        if (SymTable_checkPrefix(node,pucKey,uLength,uDepth)!=node->partialLength)
+        {
+            return 0;
+        }
+        uDepth+=node->partialLength;
+    }
+    if (uDepth>=uLength)
+    {
+        return 0;
+    }
+
+    child=SymTable_findChild(node,pucKey[uDepth]);
+    if (child==NULL||
+        !SymTable_delete(oSymTable,child,pucKey,uLength,uDepth+1,ppvValue))
+    {
+        return 0;
+    }
+    if (*child==NULL)
+        SymTable_removeChild(oSymTable,node,ppvRef,pucKey[uDepth],child);
+    return 1;
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+    void *returni;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    if (!SymTable_delete(oSymTable,&oSymTable->root,(const unsigned char*)pcKey,
+        strlen(pcKey)+1,0,&returni))
+    {
+        return NULL;
+    }
+    oSymTable->bindings--;
+    return returni;
+}
+
+/* Apply *pfApply to every binding below pvNode, in key order. The
+   first uDepth bytes of their keys are already at the start of the key
+   buffer of oSymTable, and each key is finished there in turn. */
+static void SymTable_walk(SymTable_T oSymTable, const void *pvNode,
+    size_t uDepth,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    const void *child;
+    size_t cursor=0;
+    unsigned char byte;
+
+    memcpy(oSymTable->keybuffer+uDepth,SymTable_bytes(pvNode),SymTable_byteCount(pvNode));
+    if (SymTable_type(pvNode)==ART_LEAF)
+    {
+        (*pfApply)(oSymTable->keybuffer,((const struct ArtLeaf*)pvNode)->value,
+            (void*)pvExtra);
+        return;
+    }
+    uDepth+=SymTable_byteCount(pvNode);
+    while ((child = SymTable_nextChild((const struct ArtNode*)pvNode,&cursor,&byte)) != NULL)
+    {
+        oSymTable->keybuffer[uDepth]=(char)byte;
+        SymTable_walk(oSymTable,child,uDepth+1,pfApply,pvExtra);
+    }
+}
+
+void SymTable_map(SymTable_T oSymTable,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+
+    assert(oSymTable!=NULL);
+    assert(pfApply!=NULL);
+
+    if (oSymTable->root!=NULL)
+        SymTable_walk(oSymTable,oSymTable->root,0,pfApply,pvExtra);
+}
+
+/* Apply *pfApply, in key order, to every binding below pvNode whose
+   key is at least pcLow and less than pcHigh, either of which may be
+   NULL, rebuilding the keys as SymTable_walk does. Returns 0 once a key
+   at or above pcHigh is reached, and 1 otherwise. */
+static int SymTable_walkRange(SymTable_T oSymTable, const void *pvNode,
+    size_t uDepth, const char *pcLow, const char *pcHigh,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    const char *key=oSymTable->keybuffer;
+    const void *child;
+    size_t cursor=0;
+    unsigned char byte;
+    int compare;
+
+    memcpy(oSymTable->keybuffer+uDepth,SymTable_bytes(pvNode),SymTable_byteCount(pvNode));
+    uDepth+=SymTable_byteCount(pvNode);
+    if (SymTable_type(pvNode)==ART_LEAF)
+    {
+        if (pcHigh!=NULL&&strcmp(key,pcHigh)>=0)
+        {
+            return 0;
+        }
+        if (pcLow==NULL||strcmp(key,pcLow)>=0)
+            (*pfApply)(key,((const struct ArtLeaf*)pvNode)->value,(void*)pvExtra);
+        return 1;
+    }
+
+    /* Every key below starts with the uDepth bytes so far, none of them
+       '\0'. A subtree wholly below pcLow is skipped, and within one
+       wholly above it, or wholly below pcHigh, that bound no longer
+       needs checking. */
+    if (pcLow!=NULL)
+    {
+        compare=strncmp(key,pcLow,uDepth);
+        if (compare<0)
+            return 1;
+        if (compare>0)
+            pcLow=NULL;
+    }
+    if (pcHigh!=NULL)
+    {
+        compare=strncmp(key,pcHigh,uDepth);
+        if (compare>0)
+            return 0;
+        if (compare<0)
+            pcHigh=NULL;
+    }
+    while ((child = SymTable_nextChild((const struct ArtNode*)pvNode,&cursor,&byte)) != NULL)
+    {
+        oSymTable->keybuffer[uDepth]=(char)byte;
+        if (!SymTable_walkRange(oSymTable,child,uDepth+1,pcLow,pcHigh,pfApply,pvExtra))
+            return 0;
+    }
+    return 1;
+}
+
+void SymTable_rangeMap(SymTable_T oSymTable, const char *pcLow,
+   const char *pcHigh,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+
+    assert(oSymTable!=NULL);
+    assert(pfApply!=NULL);
+
+    if (oSymTable->root!=NULL)
+        SymTable_walkRange(oSymTable,oSymTable->root,0,pcLow,pcHigh,pfApply,pvExtra);
+}
+
+void SymTable_prefixMap(SymTable_T oSymTable, const char *pcPrefix,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+
+    const unsigned char *prefix=(const unsigned char*)pcPrefix;
+    size_t length;
+    size_t depth=0;
+    size_t diff;
+    void *node;
+    void **child;
+
+    assert(oSymTable!=NULL);
+    assert(pcPrefix!=NULL);
+    assert(pfApply!=NULL);
+
+    /* Follow the prefix down to the subtree holding exactly the keys
+       that start with it. The bytes on the way there are the prefix's
+       own, so they go in the key buffer from it. */
+    length=strlen(pcPrefix);
+    node=oSymTable->root;
+    while (node!=NULL)
+    {
+        struct ArtNode *inner=(struct ArtNode*)node;
+
+        if (inner->type==ART_LEAF)
+        {
+            /* The leaf's bytes end in '\0', which stops the compare. */
+            if (strncmp((const char*)SymTable_bytes(node),pcPrefix+depth,length-depth)==0)
+                break;
+            return;
+        }
+        if (depth==length)
+        {
+            break;
+        }
+        diff=SymTable_checkPrefix(inner,prefix,length,depth);
+        if (depth+diff==length)
+        {
+            break;
+        }
+        if (diff<inner->partialLength)
+        {
+            return;
+        }
+        depth+=inner->partialLength;
+        child=SymTable_findChild(inner,prefix[depth]);
+        node=child!=NULL?*child:NULL;
+        depth++;
+    }
+    if (node!=NULL)
+    {
+        memcpy(oSymTable->keybuffer,pcPrefix,depth);
+        SymTable_walk(oSymTable,node,depth,pfApply,pvExtra);
+    }
+}
@@ -0,0 +1,753 @@
+/*--------------------------------------------------------------------*/
+/* symtablebtree.c                                                    */
+/* Author: Kevin Castro                                               */
+/*--------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include "symtable.h"
+#include "symtableordered.h"
+#include "slab.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+/* A B+-tree keyed by strcmp order. Every binding is in a leaf, all
+   leaves are at the same depth, and the leaves are linked left to
+   right so that SymTable_map and SymTable_rangeMap walk them in key
+   order without going back up the tree. Nodes are wide, so a lookup
+   touches few of them and each is searched by binary search over an
+   array of key pointers.
+
+   Inner nodes hold separator keys: every key in children[i] is at
+   least keys[i-1] and less than keys[i]. A separator is a copy owned
+   by its inner node, so removing the binding it was copied from
+   leaves it valid. Puts split full nodes on the way down, and removes
+   rebalance underfull nodes on the way back up, by borrowing from a
+   sibling or merging with one. If memory for a new separator runs out
+   while borrowing, the node is left underfull, which every operation
+   tolerates. */
+
+/* Most bindings a leaf holds, and fewest a leaf other than the root
+   holds once rebalanced. */
+enum {LEAF_MAX = 32, LEAF_MIN = LEAF_MAX / 2};
+
+/* Most children an inner node has, and fewest an inner node other
+   than the root has once rebalanced. */
+enum {INNER_MAX = 32, INNER_MIN = INNER_MAX / 2};
+
+/* A leaf: count bindings, sorted by key. */
+struct BtreeLeaf {
+    /* Number of bindings*/
+    size_t count;
+    /* The leaf to the right, or NULL for the last leaf*/
+    struct BtreeLeaf *next;
+    /* The keys, stored in the table's string slab, and their values*/
+    const char *keys[LEAF_MAX];
+    void *values[LEAF_MAX];
+};
+
+/* An inner node: count children and count-1 separators. */
+struct BtreeInner {
+    /* Number of children*/
+    size_t count;
+    /* The separators, stored in the table's string slab*/
+    const char *keys[INNER_MAX - 1];
+    /* The children: leaves if the node is just above the leaves,
+    inner nodes otherwise*/
+    void *children[INNER_MAX];
+};
+
+/*A stack is the root of the tree. A node's height says what it is:
+leaves have height 0, and an inner node is one higher than its
+children.*/
+struct Stack {
+    /*The root, a leaf if height is 0*/
+    void *root;
+    /*Height of the root*/
+    size_t height;
+    /*Number of bindings in the tree*/
+    size_t bindings;
+    /*Allocator for keys and separators*/
+    Slab_T strings;
+};
+
+/* Return a copy of pcKey allocated from the string slab of oSymTable,
+   or NULL if memory allocation fails. */
+static char *SymTable_copyKey(SymTable_T oSymTable, const char *pcKey) {
+    size_t length=strlen(pcKey);
+    char *copy;
+
+    copy=(char*)Slab_alloc(oSymTable->strings,length+1);
+    if (copy!=NULL)
+        memcpy(copy,pcKey,length+1);
+    return copy;
+}
+
+/* Return pcKey, allocated by SymTable_copyKey, to the string slab of
+   oSymTable. */
+static void SymTable_freeKey(SymTable_T oSymTable, const char *pcKey) {
+    Slab_release(oSymTable->strings,(void*)pcKey,strlen(pcKey)+1);
+}
+
+/* Return the position of the first key of poLeaf that is not less
+   than pcKey, or poLeaf->count if there is none. Sets *piFound to 1 if
+   that key equals pcKey and to 0 otherwise. */
+static size_t SymTable_leafSearch(const struct BtreeLeaf *poLeaf,
+    const char *pcKey, int *piFound) {
+    size_t low=0;
+    size_t high=poLeaf->count;
+    size_t middle;
+    int compare;
+
+    while (low<high)
+    {
+        middle=low+(high-low)/2;
+        compare=strcmp(poLeaf->keys[middle],pcKey);
+        if (compare==0)
+        {
+            *piFound=1;
+            return middle;
+        }
+        if (compare<0)
+            low=middle+1;
+        else
+            high=middle;
+    }
+    *piFound=0;
+    return low;
+}
+
+/* Return the index of the child of poInner whose keys span pcKey: the
+   number of separators that are not greater than pcKey. */
+static size_t SymTable_innerSearch(const struct BtreeInner *poInner,
+    const char *pcKey) {
+    size_t low=0;
+    size_t high=poInner->count-1;
+    size_t middle;
+
+    while (low<high)
+    {
+        middle=low+(high-low)/2;
+        if (strcmp(poInner->keys[middle],pcKey)<=0)
+            low=middle+1;
+        else
+            high=middle;
+    }
+    return low;
+}
+
+/* Return the leaf of oSymTable that holds, or would hold, pcKey. */
+static struct BtreeLeaf *SymTable_findLeaf(SymTable_T oSymTable,
+    const char *pcKey) {
+    void *node=oSymTable->root;
+    size_t height;
+
+    for (height = oSymTable->height; height > 0; height--) {
+        struct BtreeInner *inner=(struct BtreeInner*)node;
+        node=inner->children[SymTable_innerSearch(inner,pcKey)];
+    }
+    return (struct BtreeLeaf*)node;
+}
+
+/* Return the leftmost leaf of oSymTable. */
+static struct BtreeLeaf *SymTable_firstLeaf(SymTable_T oSymTable) {
+    void *node=oSymTable->root;
+    size_t height;
+
+    for (height = oSymTable->height; height > 0; height--)
+        node=((struct BtreeInner*)node)->children[0];
+    return (struct BtreeLeaf*)node;
+}
+
+/* Return a new empty leaf, or NULL if memory allocation fails. */
+static struct BtreeLeaf *SymTable_newLeaf(void) {
+    struct BtreeLeaf *leaf;
+
+    leaf=(struct BtreeLeaf*)malloc(sizeof(struct BtreeLeaf));
+    if (leaf==NULL)
+    {
+        return NULL;
+    }
+    leaf->count=0;
+    leaf->next=NULL;
+    return leaf;
+}
+
+/* Return 1 if pvNode, of height uHeight, can take no more bindings or
+   children, and 0 otherwise. */
+static int SymTable_isFull(const void *pvNode, size_t uHeight) {
+    if (uHeight==0)
+        return ((const struct BtreeLeaf*)pvNode)->count==LEAF_MAX;
+    return ((const struct BtreeInner*)pvNode)->count==INNER_MAX;
+}
+
+/* Return 1 if pvNode, of height uHeight, has fewer bindings or
+   children than a node other than the root should, and 0
+   otherwise. */
+static int SymTable_isUnderfull(const void *pvNode, size_t uHeight) {
+    if (uHeight==0)
+        return ((const struct BtreeLeaf*)pvNode)->count<LEAF_MIN;
+    return ((const struct BtreeInner*)pvNode)->count<INNER_MIN;
+}
+
+/* Insert pvItem into apvArray, which holds uUsed pointers, at
+   position uPosition, moving the rest one place right. */
+static void SymTable_insertAt(void *apvArray, size_t uUsed,
+    size_t uPosition, const void *pvItem) {
+    void **array=(void**)apvArray;
+
+    memmove(&array[uPosition+1],&array[uPosition],(uUsed-uPosition)*sizeof(void*));
+    array[uPosition]=(void*)pvItem;
+}
+
+/* Remove the pointer at position uPosition of apvArray, which holds
+   uUsed of them, moving the rest one place left. */
+static void SymTable_removeAt(void *apvArray, size_t uUsed,
+    size_t uPosition) {
+    void **array=(void**)apvArray;
+
+    memmove(&array[uPosition],&array[uPosition+1],(uUsed-uPosition-1)*sizeof(void*));
+}
+
+/*Splits the full child uIndex of poParent, which has height uHeight,
+into two, adding the new right half as child uIndex+1 of poParent,
+which must not be full. Returns 1 on success, or 0 if memory allocation
+fails, in which case nothing is changed. */
+static int SymTable_splitChild(SymTable_T oSymTable,
+    struct BtreeInner *poParent, size_t uIndex, size_t uHeight) {
+    const char *separator;
+    void *right;
+
+    if (uHeight==0)
+    {
+        struct BtreeLeaf *leaf=(struct BtreeLeaf*)poParent->children[uIndex];
+        struct BtreeLeaf *newleaf;
+
+        newleaf=SymTable_newLeaf();
+        if (newleaf==NULL)
+        {
+            return 0;
+        }
+        separator=SymTable_copyKey(oSymTable,leaf->keys[LEAF_MIN]);
+        if (separator==NULL)
+        {
+            free(newleaf);
+            return 0;
+        }
+
+        newleaf->count=LEAF_MAX-LEAF_MIN;
+        memcpy(newleaf->keys,&leaf->keys[LEAF_MIN],newleaf->count*sizeof(char*));
+        memcpy(newleaf->values,&leaf->values[LEAF_MIN],newleaf->count*sizeof(void*));
+        leaf->count=LEAF_MIN;
+        newleaf->next=leaf->next;
+        leaf->next=newleaf;
+        right=newleaf;
+    }
+    else
+    {
+        struct BtreeInner *inner=(struct BtreeInner*)poParent->children[uIndex];
+        struct BtreeInner *newinner;
+
+        newinner=(struct BtreeInner*)malloc(sizeof(struct BtreeInner));
+        if (newinner==NULL)
+        {
+            return 0;
+        }
+
+        /* The separator between the halves moves up rather than being
+           copied. */
+        separator=inner->keys[INNER_MIN-1];
+        newinner->count=INNER_MAX-INNER_MIN;
+        memcpy(newinner->keys,&inner->keys[INNER_MIN],(newinner->count-1)*sizeof(char*));
+        memcpy(newinner->children,&inner->children[INNER_MIN],newinner->count*sizeof(void*));
+        inner->count=INNER_MIN;
+        right=newinner;
+    }
+
+    SymTable_insertAt(poParent->keys,poParent->count-1,uIndex,separator);
+    SymTable_insertAt(poParent->children,poParent->count,uIndex+1,right);
+    poParent->count++;
+    return 1;
+}
+
+SymTable_T SymTable_new(void){
+    SymTable_T symtablenew;
+
+    symtablenew =(SymTable_T)malloc(sizeof(struct Stack));
+    if (symtablenew==NULL)
+    {
+        return NULL;
+    }
+
+    symtablenew->root=SymTable_newLeaf();
+    if (symtablenew->root==NULL)
+    {
+        free(symtablenew);
+        return NULL;
+    }
+
+    symtablenew->strings=Slab_new();
+    if (symtablenew->strings==NULL)
+    {
+        free(symtablenew->root);
+        free(symtablenew);
+        return NULL;
+    }
+
+    symtablenew->height=0;
+    symtablenew->bindings=0;
+    return symtablenew;
+}
+
+SymTable_T SymTable_newWithHash(SymTable_HashFunction pfHash){
+    /* Keys are ordered, never hashed. */
+    (void)pfHash;
+    return SymTable_new();
+}
+
+/* Free pvNode, of height uHeight, and every node below it. */
+static void SymTable_freeNode(void *pvNode, size_t uHeight) {
+    size_t index;
+
+    if (uHeight>0)
+    {
+        struct BtreeInner *inner=(struct BtreeInner*)pvNode;
+        for (index = 0; index < inner->count; index++)
+            SymTable_freeNode(inner->children[index],uHeight-1);
+    }
+    free(pvNode);
+}
+
+void SymTable_free(SymTable_T oSymTable){
+
+    assert(oSymTable!=NULL);
+
+    /* Keys and separators all live in the slab. */
+    SymTable_freeNode(oSymTable->root,oSymTable->height);
+    Slab_free(oSymTable->strings);
+    free(oSymTable);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+
+    assert(oSymTable!=NULL);
+
+    return oSymTable->bindings;
+}
+
+int SymTable_put(SymTable_T oSymTable, const char *pcKey, const void *pvValue){
+    struct BtreeInner *inner;
+    struct BtreeLeaf *leaf;
+    char *key;
+    void *node;
+    size_t height;
+    size_t index;
+    int found;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    leaf=SymTable_findLeaf(oSymTable,pcKey);
+    SymTable_leafSearch(leaf,pcKey,&found);
+    if (found)
+    {
+        return 0;
+    }
+
+    key=SymTable_copyKey(oSymTable,pcKey);
+    if (key==NULL)
+    {
+        return 0;
+    }
+
+    /* Split full nodes on the way down, starting with the root, so
+       that the parent of every split has room for one more child. A
+       split that succeeds leaves a valid tree even if a later one
+       fails. */
+    if (SymTable_isFull(oSymTable->root,oSymTable->height))
+    {
+        inner=(struct BtreeInner*)malloc(sizeof(struct BtreeInner));
+        if (inner==NULL)
+        {
+            SymTable_freeKey(oSymTable,key);
+            return 0;
+        }
+        inner->count=1;
+        inner->children[0]=oSymTable->root;
+        if (!SymTable_splitChild(oSymTable,inner,0,oSymTable->height))
+        {
+            free(inner);
+            SymTable_freeKey(oSymTable,key);
+            return 0;
+        }
+        oSymTable->root=inner;
+        oSymTable->height++;
+    }
+
+    node=oSymTable->root;
+    for (height = oSymTable->height; height > 0; height--) {
+        inner=(struct BtreeInner*)node;
+        index=SymTable_innerSearch(inner,pcKey);
+        if (SymTable_isFull(inner->children[index],height-1))
+        {
+            if (!SymTable_splitChild(oSymTable,inner,index,height-1))
+            {
+                SymTable_freeKey(oSymTable,key);
+                return 0;
+            }
+            if (strcmp(pcKey,inner->keys[index])>=0)
+                index++;
+        }
+        node=inner->children[index];
+    }
+
+    leaf=(struct BtreeLeaf*)node;
+    index=SymTable_leafSearch(leaf,pcKey,&found);
+    SymTable_insertAt(leaf->keys,leaf->count,index,key);
+    SymTable_insertAt(leaf->values,leaf->count,index,pvValue);
+    leaf->count++;
+    oSymTable->bindings++;
+    return 1;
+}
+
+void *SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue){
+    struct BtreeLeaf *leaf;
+    void *oldval;
+    size_t index;
+    int found;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    leaf=SymTable_findLeaf(oSymTable,pcKey);
+    index=SymTable_leafSearch(leaf,pcKey,&found);
+    if (!found)
+    {
+        return NULL;
+    }
+    oldval=leaf->values[index];
+    leaf->values[index]=(void*)pvValue;
+    return oldval;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+    int found;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    SymTable_leafSearch(SymTable_findLeaf(oSymTable,pcKey),pcKey,&found);
+    return found;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+    struct BtreeLeaf *leaf;
+    size_t index;
+    int found;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    leaf=SymTable_findLeaf(oSymTable,pcKey);
+    index=SymTable_leafSearch(leaf,pcKey,&found);
+    return found?leaf->values[index]:NULL;
+}
+
+/* Merge child uIndex+1 of poParent into child uIndex, both of height
+   uHeight, and remove the separator between them. The two must fit in
+   one node. */
+static void SymTable_merge(SymTable_T oSymTable,
+    struct BtreeInner *poParent, size_t uIndex, size_t uHeight) {
+    const char *separator=poParent->keys[uIndex];
+
+    if (uHeight==0)
+    {
+        struct BtreeLeaf *left=(struct BtreeLeaf*)poParent->children[uIndex];
+        struct BtreeLeaf *right=(struct BtreeLeaf*)poParent->children[uIndex+1];
+
+        assert(left->count+right->count<=LEAF_MAX);
+        memcpy(&left->keys[left->count],right->keys,right->count*sizeof(char*));
+        memcpy(&left->values[left->count],right->values,right->count*sizeof(void*));
+        left->count+=right->count;
+        left->next=right->next;
+        SymTable_freeKey(oSymTable,separator);
+        free(right);
+    }
+    else
+    {
+        struct BtreeInner *left=(struct BtreeInner*)poParent->children[uIndex];
+        struct BtreeInner *right=(struct BtreeInner*)poParent->children[uIndex+1];
+
+        /* The separator comes down between the two halves. */
+        assert(left->count+right->count<=INNER_MAX);
+        left->keys[left->count-1]=separator;
+        memcpy(&left->keys[left->count],right->keys,(right->count-1)*sizeof(char*));
+        memcpy(&left->children[left->count],right->children,right->count*sizeof(void*));
+        left->count+=right->count;
+        free(right);
+    }
+
+    SymTable_removeAt(poParent->keys,poParent->count-1,uIndex);
+    SymTable_removeAt(poParent->children,poParent->count,uIndex+1);
+    poParent->count--;
+}
+
+/* Move the last binding or child of child uIndex-1 of poParent to the
+   front of child uIndex, both of height uHeight. Returns 0 if memory
+   for the new separator cannot be allocated, in which case nothing is
+   changed. */
+static int SymTable_borrowLeft(SymTable_T oSymTable,
+    struct BtreeInner *poParent, size_t uIndex, size_t uHeight) {
+    if (uHeight==0)
+    {
+        struct BtreeLeaf *left=(struct BtreeLeaf*)poParent->children[uIndex-1];
+        struct BtreeLeaf *child=(struct BtreeLeaf*)poParent->children[uIndex];
+        char *separator;
+
+        left->count--;
+        separator=SymTable_copyKey(oSymTable,left->keys[left->count]);
+        if (separator==NULL)
+        {
+            left->count++;
+            return 0;
+        }
+        SymTable_insertAt(child->keys,child->count,0,left->keys[left->count]);
+        SymTable_insertAt(child->values,child->count,0,left->values[left->count]);
+        child->count++;
+        SymTable_freeKey(oSymTable,poParent->keys[uIndex-1]);
+        poParent->keys[uIndex-1]=separator;
+    }
+    else
+    {
+        struct BtreeInner *left=(struct BtreeInner*)poParent->children[uIndex-1];
+        struct BtreeInner *child=(struct BtreeInner*)poParent->children[uIndex];
+
+        /* Rotate through the parent: its separator comes down in
+           front of the child, and the left node's last separator goes
+           up in its place. */
+        SymTable_insertAt(child->keys,child->count-1,0,poParent->keys[uIndex-1]);
+        SymTable_insertAt(child->children,child->count,0,left->children[left->count-1]);
+        child->count++;
+        poParent->keys[uIndex-1]=left->keys[left->count-2];
+        left->count--;
+    }
+    return 1;
+}
+
+/* Move the first binding or child of child uIndex+1 of poParent to the
+   end of child uIndex, both of height uHeight. Returns 0 if memory for
+   the new separator cannot be allocated, in which case nothing is
+   changed. */
+static int SymTable_borrowRight(SymTable_T oSymTable,
+    struct BtreeInner *poParent, size_t uIndex, size_t uHeight) {
+    if (uHeight==0)
+    {
+        struct BtreeLeaf *child=(struct BtreeLeaf*)poParent->children[uIndex];
+        struct BtreeLeaf *right=(struct BtreeLeaf*)poParent->children[uIndex+1];
+        char *separator;
+
+        separator=SymTable_copyKey(oSymTable,right->keys[1]);
+        if (separator==NULL)
+        {
+            return 0;
+        }
+        child->keys[child->count]=right->keys[0];
+        child->values[child->count]=right->values[0];
+        child->count++;
+        SymTable_removeAt(right->keys,right->count,0);
+        SymTable_removeAt(right->values,right->count,0);
+        right->count--;
+        SymTable_freeKey(oSymTable,poParent->keys[uIndex]);
+        poParent->keys[uIndex]=separator;
+    }
+    else
+    {
+        struct BtreeInner *child=(struct BtreeInner*)poParent->children[uIndex];
+        struct BtreeInner *right=(struct BtreeInner*)poParent->children[uIndex+1];
+
+        child->keys[child->count-1]=poParent->keys[uIndex];
+        child->children[child->count]=right->children[0];
+        child->count++;
+        poParent->keys[uIndex]=right->keys[0];
+        SymTable_removeAt(right->keys,right->count-1,0);
+        SymTable_removeAt(right->children,right->count,0);
+        right->count--;
+    }
+    return 1;
+}
+
+/* Return 1 if pvNode, of height uHeight, has more bindings or
+   children than the minimum, so it can give one to a sibling, and 0
+   otherwise. */
+static int SymTable_canSpare(const void *pvNode, size_t uHeight) {
+    if (uHeight==0)
+        return ((const struct BtreeLeaf*)pvNode)->count>LEAF_MIN;
+    return ((const struct BtreeInner*)pvNode)->count>INNER_MIN;
+}
+
+/* Bring the underfull child uIndex of poParent, of height uHeight,
+   back up to size by borrowing from a sibling that can spare a binding
+   or child, or else by merging it with a sibling. */
+static void SymTable_rebalance(SymTable_T oSymTable,
+    struct BtreeInner *poParent, size_t uIndex, size_t uHeight) {
+    if (uIndex>0&&SymTable_canSpare(poParent->children[uIndex-1],uHeight))
+    {
+        SymTable_borrowLeft(oSymTable,poParent,uIndex,uHeight);
+        return;
+    }
+    if (uIndex+1<poParent->count&&SymTable_canSpare(poParent->children[uIndex+1],uHeight))
+    {
+        SymTable_borrowRight(oSymTable,poParent,uIndex,uHeight);
+        return;
+    }
+    /* Neither sibling can spare anything, so each holds at most the
+       minimum, and either fits together with the underfull child. */
+    if (uIndex>0)
+        SymTable_merge(oSymTable,poParent,uIndex-1,uHeight);
+    else if (uIndex+1<poParent->count)
+        SymTable_merge(oSymTable,poParent,uIndex,uHeight);
+}
+
+/* Remove the binding with key pcKey from the subtree pvNode, of height
+   uHeight, storing its value in *ppvValue. Returns 1 if there was such
+   a binding and 0 otherwise. */
+static int SymTable_removeFrom(SymTable_T oSymTable, void *pvNode,
+    size_t uHeight, const char *pcKey, void **ppvValue) {
+    size_t index;
+    int found;
+
+    if (uHeight==0)
+    {
+        struct BtreeLeaf *leaf=(struct BtreeLeaf*)pvNode;
+
+        index=SymTable_leafSearch(leaf,pcKey,&found);
+        if (!found)
+        {
+            return 0;
+        }
+        *ppvValue=leaf->values[index];
+        SymTable_freeKey(oSymTable,leaf->keys[index]);
+        SymTable_removeAt(leaf->keys,leaf->count,index);
+        SymTable_removeAt(leaf->values,leaf->count,index);
+        leaf->count--;
+        return 1;
+    }
+    else
+    {
+        struct BtreeInner *inner=(struct BtreeInner*)pvNode;
+
+        index=SymTable_innerSearch(inner,pcKey);
+        if (!SymTable_removeFrom(oSymTable,inner->children[index],uHeight-1,pcKey,ppvValue))
+        {
+            return 0;
+        }
+        if (SymTable_isUnderfull(inner->children[index],uHeight-1))
+            SymTable_rebalance(oSymTable,inner,index,uHeight-1);
+        return 1;
+    }
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+    struct BtreeInner *root;
+    void *returni;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    if (!SymTable_removeFrom(oSymTable,oSymTable->root,oSymTable->height,pcKey,&returni))
+    {
+        return NULL;
+    }
+    oSymTable->bindings--;
+
+    /* A root left with one child is replaced by that child. */
+    root=(struct BtreeInner*)oSymTable->root;
+    if (oSymTable->height>0&&root->count==1)
+    {
+        oSymTable->root=root->children[0];
+        oSymTable->height--;
+        free(root);
+    }
+    return returni;
+}
+
+void SymTable_map(SymTable_T oSymTable,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+
+    struct BtreeLeaf *leaf;
+    size_t index;
+
+    assert(oSymTable!=NULL);
+    assert(pfApply!=NULL);
+
+    for (leaf = SymTable_firstLeaf(oSymTable); leaf != NULL; leaf = leaf->next) {
+        for (index = 0; index < leaf->count; index++)
+            (*pfApply)(leaf->keys[index],leaf->values[index],(void*)pvExtra);
+    }
+}
+
+void SymTable_rangeMap(SymTable_T oSymTable, const char *pcLow,
+   const char *pcHigh,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+
+    struct BtreeLeaf *leaf;
+    size_t index=0;
+    int found;
+
+    assert(oSymTable!=NULL);
+    assert(pfApply!=NULL);
+
+    if (pcLow==NULL)
+    {
+        leaf=SymTable_firstLeaf(oSymTable);
+    }
+    else
+    {
+        leaf=SymTable_findLeaf(oSymTable,pcLow);
+        index=SymTable_leafSearch(leaf,pcLow,&found);
+    }
+
+    for (; leaf != NULL; leaf = leaf->next, index = 0) {
+        for (; index < leaf->count; index++) {
+            if (pcHigh!=NULL&&strcmp(leaf->keys[index],pcHigh)>=0)
+            {
+                return;
+            }
+            (*pfApply)(leaf->keys[index],leaf->values[index],(void*)pvExtra);
+        }
+    }
+}
+
+void SymTable_prefixMap(SymTable_T oSymTable, const char *pcPrefix,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+
+    struct BtreeLeaf *leaf;
+    size_t length;
+    size_t index;
+    int found;
+
+    assert(oSymTable!=NULL);
+    assert(pcPrefix!=NULL);
+    assert(pfApply!=NULL);
+
+    /* The keys with the prefix are the run that starts at the prefix
+       itself. */
+    length=strlen(pcPrefix);
+    leaf=SymTable_findLeaf(oSymTable,pcPrefix);
+    index=SymTable_leafSearch(leaf,pcPrefix,&found);
+
+    for (; leaf != NULL; leaf = leaf->next, index = 0) {
+        for (; index < leaf->count; index++) {
+            if (strncmp(leaf->keys[index],pcPrefix,length)!=0)
+            {
+                return;
+            }
+            (*pfApply)(leaf->keys[index],leaf->values[index],(void*)pvExtra);
+        }
+    }
+}
@@ -0,0 +1,477 @@
+/*--------------------------------------------------------------------*/
+/* symtablecompact.c                                                  */
+/* Author: Kevin Castro                                               */
+/*--------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include "symtable.h"
+#include "slab.h"
+#include "hashfn.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <limits.h>
+
+/* A hash table laid out the way CPython lays out its dicts. The
+   bindings live in one dense entries array, in the order they were
+   put, and a separate open-addressed index array maps hashes to
+   positions in it. An index slot holds just an entry number, stored in
+   the narrowest integer type that can number every entry, so the part
+   of the table that is mostly empty space is also the part that costs
+   least. SymTable_map streams through the entries array in insertion
+   order, and SymTable_free releases a handful of blocks plus about one
+   per MiB of keys, rather than one per binding. */
+
+/* Number of index slots in a new SymTable. A power of two. */
+enum {MIN_INDEX_SLOTS = 8};
+
+/* Index slot values other than entry numbers. A DUMMY slot once held
+   an entry that has since been removed, and keeps probe sequences that
+   passed through it intact. */
+enum {SLOT_EMPTY = -1, SLOT_DUMMY = -2};
+
+/* Bits of the hash folded into the probe sequence at each step. */
+enum {PERTURB_SHIFT = 5};
+
+/* The integer types an index array can be made of, narrowest first. */
+enum IndexWidth {INDEX_CHAR, INDEX_SHORT, INDEX_INT, INDEX_LONG};
+
+/* One binding. A removed binding leaves an entry whose key is NULL,
+   which the next resize squeezes out. */
+struct CompactEntry {
+    /* The key, stored in the table's key slab*/
+    const char *key;
+    /* The value*/
+    void *value;
+    /* The full hash of the key, so resizing never rereads the key*/
+    size_t hash;
+};
+
+/*A stack is the index array and the entries array it points into.*/
+struct Stack {
+    /*Number of index slots, a power of two*/
+    size_t slotcount;
+    /*The index array, whose slots are of type width*/
+    void *indices;
+    enum IndexWidth width;
+    /*The entries array; entrycount of its entrycap entries are used,
+    some of which may be removed ones*/
+    struct CompactEntry *entries;
+    size_t entrycount;
+    size_t entrycap;
+    /*Number of bindings in the table*/
+    size_t bindings;
+    /*Allocator for the key strings*/
+    Slab_T keys;
+    /*Caller's hash function, or NULL for HashFn_words*/
+    SymTable_HashFunction hashfn;
+};
+
+/* Return the hash code oSymTable uses for pcKey, whose length is
+   uLength. */
+static size_t SymTable_hash(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength) {
+    assert(pcKey != NULL);
+
+    if (oSymTable->hashfn == NULL)
+    {
+        return HashFn_words(pcKey, uLength);
+    }
+    return HashFn_mix((*oSymTable->hashfn)(pcKey, uLength));
+}
+
+/* Return the number of entries a table with uSlots index slots holds
+   before it must be resized: two thirds of the slots, so that probe
+   sequences stay short. */
+static size_t SymTable_usable(size_t uSlots) {
+    return uSlots/3*2+uSlots%3*2/3;
+}
+
+/* Return the narrowest index width that can number uEntries entries
+   and still hold SLOT_DUMMY. */
+static enum IndexWidth SymTable_widthFor(size_t uEntries) {
+    if (uEntries<=SCHAR_MAX)
+        return INDEX_CHAR;
+    if (uEntries<=SHRT_MAX)
+        return INDEX_SHORT;
+    if (uEntries<=INT_MAX)
+        return INDEX_INT;
+    return INDEX_LONG;
+}
+
+/* Return the size in bytes of one index slot of width eWidth. */
+static size_t SymTable_widthSize(enum IndexWidth eWidth) {
+    switch (eWidth)
+    {
+    case INDEX_CHAR:
+        return sizeof(signed char);
+    case INDEX_SHORT:
+        return sizeof(short);
+    case INDEX_INT:
+        return sizeof(int);
+    default:
+        return sizeof(long);
+    }
+}
+
+/* Return the contents of index slot uSlot of oSymTable. */
+static long SymTable_getSlot(SymTable_T oSymTable, size_t uSlot) {
+    switch (oSymTable->width)
+    {
+    case INDEX_CHAR:
+        return ((signed char*)oSymTable->indices)[uSlot];
+    case INDEX_SHORT:
+        return ((short*)oSymTable->indices)[uSlot];
+    case INDEX_INT:
+        return ((int*)oSymTable->indices)[uSlot];
+    default:
+        return ((long*)oSymTable->indices)[uSlot];
+    }
+}
+
+/* Set index slot uSlot of oSymTable to lValue. */
+static void SymTable_setSlot(SymTable_T oSymTable, size_t uSlot,
+    long lValue) {
+    switch (oSymTable->width)
+    {
+    case INDEX_CHAR:
+        ((signed char*)oSymTable->indices)[uSlot]=(signed char)lValue;
+        break;
+    case INDEX_SHORT:
+        ((short*)oSymTable->indices)[uSlot]=(short)lValue;
+        break;
+    case INDEX_INT:
+        ((int*)oSymTable->indices)[uSlot]=(int)lValue;
+        break;
+    default:
+        ((long*)oSymTable->indices)[uSlot]=lValue;
+        break;
+    }
+}
+
+/* Return the index slot that holds the entry for pcKey, whose hash is
+   uHash, in oSymTable. If there is no such entry, return the slot a
+   new entry for pcKey should take: the first DUMMY slot on pcKey's
+   probe sequence, or else the EMPTY slot that ends it. */
+static size_t SymTable_probe(SymTable_T oSymTable, const char *pcKey,
+    size_t uHash) {
+    size_t mask=oSymTable->slotcount-1;
+    size_t perturb=uHash;
+    size_t slot=uHash&mask;
+    size_t freeslot=(size_t)-1;
+    long index;
+
+    for (;;)
+    {
+        index=SymTable_getSlot(oSymTable,slot);
+        if (index==SLOT_EMPTY)
+        {
+            return freeslot!=(size_t)-1?freeslot:slot;
+        }
+        if (index==SLOT_DUMMY)
+        {
+            if (freeslot==(size_t)-1)
+                freeslot=slot;
+        }
+        else if (oSymTable->entries[index].hash==uHash&&
+                 strcmp(oSymTable->entries[index].key,pcKey)==0)
+        {
+            return slot;
+        }
+        perturb>>=PERTURB_SHIFT;
+        slot=(slot*5+perturb+1)&mask;
+    }
+}
+
+/* Return a new index array of uSlots EMPTY slots of width eWidth, or
+   NULL if memory allocation fails. */
+static void *SymTable_newIndices(size_t uSlots, enum IndexWidth eWidth) {
+    size_t size=SymTable_widthSize(eWidth);
+    void *indices;
+
+    if (uSlots>(size_t)-1/size)
+    {
+        return NULL;
+    }
+    indices=malloc(uSlots*size);
+    if (indices==NULL)
+    {
+        return NULL;
+    }
+    /* SLOT_EMPTY is -1, all bits set, at every width. */
+    memset(indices,0xFF,uSlots*size);
+    return indices;
+}
+
+/*Rebuilds oSymTable with room for well over its current bindings:
+the index array gets a power of two slots, at least three per binding,
+and the entries array is compacted, dropping removed entries without
+changing the order of the rest. Returns 1 on success, or 0 if memory
+allocation fails, in which case oSymTable is unchanged. */
+static int SymTable_resize(SymTable_T oSymTable) {
+    struct CompactEntry *newentries;
+    void *newindices;
+    enum IndexWidth newwidth;
+    size_t newslots=MIN_INDEX_SLOTS;
+    size_t newcap;
+    size_t mask;
+    size_t slot;
+    size_t perturb;
+    size_t from;
+    size_t to;
+
+    while (newslots/3<=oSymTable->bindings)
+    {
+        if (newslots>(size_t)-1/2/sizeof(struct CompactEntry))
+        {
+            return 0;
+        }
+        newslots*=2;
+    }
+    newcap=SymTable_usable(newslots);
+    newwidth=SymTable_widthFor(newcap);
+
+    newentries=(struct CompactEntry*)malloc(newcap*sizeof(struct CompactEntry));
+    if (newentries==NULL)
+    {
+        return 0;
+    }
+    newindices=SymTable_newIndices(newslots,newwidth);
+    if (newindices==NULL)
+    {
+        free(newentries);
+        return 0;
+    }
+
+    to=0;
+    for (from = 0; from < oSymTable->entrycount; from++) {
+        if (oSymTable->entries[from].key!=NULL)
+            newentries[to++]=oSymTable->entries[from];
+    }
+
+    free(oSymTable->entries);
+    free(oSymTable->indices);
+    oSymTable->entries=newentries;
+    oSymTable->entrycount=to;
+    oSymTable->entrycap=newcap;
+    oSymTable->indices=newindices;
+    oSymTable->width=newwidth;
+    oSymTable->slotcount=newslots;
+
+    /* Every key is known to be distinct, so each entry just takes the
+       first EMPTY slot on its probe sequence. */
+    mask=newslots-1;
+    for (from = 0; from < to; from++) {
+        perturb=newentries[from].hash;
+        slot=perturb&mask;
+        while (SymTable_getSlot(oSymTable,slot)!=SLOT_EMPTY)
+        {
+            perturb>>=PERTURB_SHIFT;
+            slot=(slot*5+perturb+1)&mask;
+        }
+        SymTable_setSlot(oSymTable,slot,(long)from);
+    }
+    return 1;
+}
+
+SymTable_T SymTable_newWithHash(SymTable_HashFunction pfHash){
+    SymTable_T symtablenew;
+
+    symtablenew =(SymTable_T)malloc(sizeof(struct Stack));
+    if (symtablenew==NULL)
+    {
+        return NULL;
+    }
+
+    symtablenew->slotcount=MIN_INDEX_SLOTS;
+    symtablenew->entrycap=SymTable_usable(MIN_INDEX_SLOTS);
+    symtablenew->width=SymTable_widthFor(symtablenew->entrycap);
+    symtablenew->indices=SymTable_newIndices(MIN_INDEX_SLOTS,symtablenew->width);
+    if (symtablenew->indices==NULL)
+    {
+        free(symtablenew);
+        return NULL;
+    }
+
+    symtablenew->entries=(struct CompactEntry*)malloc(symtablenew->entrycap*sizeof(struct CompactEntry));
+    if (symtablenew->entries==NULL)
+    {
+        free(symtablenew->indices);
+        free(symtablenew);
+        return NULL;
+    }
+
+    symtablenew->keys=Slab_new();
+    if (symtablenew->keys==NULL)
+    {
+        free(symtablenew->entries);
+        free(symtablenew->indices);
+        free(symtablenew);
+        return NULL;
+    }
+
+    symtablenew->entrycount=0;
+    symtablenew->bindings=0;
+    symtablenew->hashfn=pfHash;
+    return symtablenew;
+}
+
+SymTable_T SymTable_new(void){
+    return SymTable_newWithHash(NULL);
+}
+
+void SymTable_free(SymTable_T oSymTable){
+
+    assert(oSymTable!=NULL);
+
+    /* Every key lives in the slab, so no entry needs to be visited. */
+    Slab_free(oSymTable->keys);
+    free(oSymTable->entries);
+    free(oSymTable->indices);
+    free(oSymTable);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+
+    assert(oSymTable!=NULL);
+
+    return oSymTable->bindings;
+}
+
+int SymTable_put(SymTable_T oSymTable, const char *pcKey, const void *pvValue){
+    struct CompactEntry *entry;
+    char *key;
+    size_t length;
+    size_t hash;
+    size_t slot;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    length=strlen(pcKey);
+    hash=SymTable_hash(oSymTable,pcKey,length);
+    slot=SymTable_probe(oSymTable,pcKey,hash);
+    if (SymTable_getSlot(oSymTable,slot)>=0)
+    {
+        return 0;
+    }
+
+    key=(char*)Slab_alloc(oSymTable->keys,length+1);
+    if (key==NULL)
+    {
+        return 0;
+    }
+
+    if (oSymTable->entrycount==oSymTable->entrycap)
+    {
+        if (!SymTable_resize(oSymTable))
+        {
+            Slab_release(oSymTable->keys,key,length+1);
+            return 0;
+        }
+        slot=SymTable_probe(oSymTable,pcKey,hash);
+    }
+
+    memcpy(key,pcKey,length+1);
+    entry=&oSymTable->entries[oSymTable->entrycount];
+    entry->key=key;
+    entry->value=(void*)pvValue;
+    entry->hash=hash;
+    SymTable_setSlot(oSymTable,slot,(long)oSymTable->entrycount);
+    oSymTable->entrycount++;
+    oSymTable->bindings++;
+    return 1;
+}
+
+void *SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue){
+    struct CompactEntry *entry;
+    void *oldval;
+    long index;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    index=SymTable_getSlot(oSymTable,
+        SymTable_probe(oSymTable,pcKey,SymTable_hash(oSymTable,pcKey,strlen(pcKey))));
+    if (index<0)
+    {
+        return NULL;
+    }
+
+    entry=&oSymTable->entries[index];
+    oldval=entry->value;
+    entry->value=(void*)pvValue;
+    return oldval;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    return SymTable_getSlot(oSymTable,
+        SymTable_probe(oSymTable,pcKey,SymTable_hash(oSymTable,pcKey,strlen(pcKey))))>=0;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+    long index;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    index=SymTable_getSlot(oSymTable,
+        SymTable_probe(oSymTable,pcKey,SymTable_hash(oSymTable,pcKey,strlen(pcKey))));
+    if (index<0)
+    {
+        return NULL;
+    }
+    return oSymTable->entries[index].value;
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+    struct CompactEntry *entry;
+    void *returni;
+    size_t slot;
+    long index;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    slot=SymTable_probe(oSymTable,pcKey,SymTable_hash(oSymTable,pcKey,strlen(pcKey)));
+    index=SymTable_getSlot(oSymTable,slot);
+    if (index<0)
+    {
+        return NULL;
+    }
+
+    entry=&oSymTable->entries[index];
+    returni=entry->value;
+    Slab_release(oSymTable->keys,(void*)entry->key,strlen(entry->key)+1);
+    entry->key=NULL;
+    SymTable_setSlot(oSymTable,slot,SLOT_DUMMY);
+    oSymTable->bindings--;
+
+    /* The entry stays counted in entrycount until the next resize. That
+       keeps the EMPTY and DUMMY slots from ever outnumbering the free
+       entries, so every probe sequence reaches an EMPTY slot. */
+    return returni;
+}
+
+/* The bindings are visited in the order they were put. */
+void SymTable_map(SymTable_T oSymTable,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+
+    struct CompactEntry *entry;
+    struct CompactEntry *end;
+
+    assert(oSymTable!=NULL);
+    assert(pfApply!=NULL);
+
+    end=oSymTable->entries+oSymTable->entrycount;
+    for (entry = oSymTable->entries; entry < end; entry++) {
+        if (entry->key!=NULL)
+            (*pfApply)(entry->key,entry->value,(void*)pvExtra);
+    }
+}
@@ -0,0 +1,469 @@
+/*--------------------------------------------------------------------*/
+/* symtableconcurrent.c                                               */
+/* Author: Kevin Castro                                               */
+/*--------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include "symtable.h"
+#include "slab.h"
+#include "hashfn.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <pthread.h>
+
+/* A hash table that several threads may use at once. Every function
+   except SymTable_free may be called concurrently with any other on
+   the same table; SymTable_free must be the last call.
+
+   The buckets are guarded by STRIPE_COUNT locks: bucket b belongs to
+   stripe b % STRIPE_COUNT. The bucket count is a power of two no
+   smaller than STRIPE_COUNT, so that stripe is just the low bits of
+   the key's hash and a key keeps its stripe across resizes. Calls on
+   keys of different stripes never wait for each other. A resize takes
+   every stripe in order, so a thread holding any one stripe always
+   sees a consistent bucket array. */
+
+/* Number of locks the buckets are split between. A power of two. */
+enum {STRIPE_COUNT = 64};
+
+/* Number of buckets in a new SymTable. A power of two, and a multiple
+   of STRIPE_COUNT. */
+enum {INITIAL_BUCKETS = 512};
+
+/* Bytes set aside for each stripe, so that two stripes never share a
+   cache line, nor the line the hardware prefetches next to it. */
+enum {STRIPE_SPACING = 128};
+
+/* Each binding is stored in a HashTablenode, and the nodes of a bucket
+   are linked to form a chain. The bytes of the key, with their '\0',
+   follow the node in the same slab block; see SymTable_key. */
+struct HashTablenode{
+    /* The value*/
+    void *value;
+    /* The address of the next HashTablenode. */
+    struct HashTablenode *next;
+    /* The full hash of the key, so resizing never rereads the key*/
+    size_t hash;
+    /* The length of the key, not counting the '\0'*/
+    size_t length;
+};
+
+/* The lock of a stripe and the state it guards. */
+struct Stripe {
+    /*Held while reading or writing any chain of the stripe*/
+    pthread_mutex_t lock;
+    /*Allocator for the stripe's nodes. A node never changes stripe,
+    so it is always released to the slab it came from*/
+    Slab_T slab;
+    /*Number of bindings in the stripe's chains*/
+    size_t bindings;
+};
+
+/* A Stripe, padded out to STRIPE_SPACING bytes. */
+union StripeSlot {
+    struct Stripe stripe;
+    char padding[STRIPE_SPACING];
+};
+
+/*A stack is the bucket array together with the stripes that guard
+it. bucketcount and hashbuckets change only while every stripe is
+held.*/
+struct Stack {
+    /*Current number of buckets in SymTable, a power of two*/
+    size_t bucketcount;
+    /*The address of the first HashTableNode* in the array*/
+    struct HashTablenode **hashbuckets;
+    /*The stripes*/
+    union StripeSlot stripes[STRIPE_COUNT];
+    /*Caller's hash function, or NULL for HashFn_words*/
+    SymTable_HashFunction hashfn;
+};
+
+/* Return the key stored inline after poNode. */
+static const char *SymTable_key(const struct HashTablenode *poNode) {
+    return (const char*)(poNode + 1);
+}
+
+/* Return the size of the slab block that holds a node with a key of
+   length uLength. */
+static size_t SymTable_nodeSize(size_t uLength) {
+    return sizeof(struct HashTablenode) + uLength + 1;
+}
+
+/* Return the hash code oSymTable uses for the uLength bytes at
+   pcKey. */
+static size_t SymTable_hash(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength) {
+    assert(pcKey != NULL);
+
+    if (oSymTable->hashfn == NULL)
+    {
+        return HashFn_words(pcKey, uLength);
+    }
+    return HashFn_mix((*oSymTable->hashfn)(pcKey, uLength));
+}
+
+/* Return the stripe of oSymTable that guards keys with hash uHash. */
+static struct Stripe *SymTable_stripe(SymTable_T oSymTable,
+    size_t uHash) {
+    return &oSymTable->stripes[uHash & (STRIPE_COUNT - 1)].stripe;
+}
+
+/* Return the address of the head pointer of the chain that holds, or
+   would hold, a key with hash uHash. The caller must hold the key's
+   stripe. */
+static struct HashTablenode **SymTable_chain(SymTable_T oSymTable,
+    size_t uHash) {
+    return &oSymTable->hashbuckets[uHash & (oSymTable->bucketcount - 1)];
+}
+
+/* Return the address of the link that points to the node holding
+   pcKey, whose hash is uHash and length is uLength. If there is no
+   such node, return the address of the NULL link ending its chain.
+   The caller must hold the key's stripe. */
+static struct HashTablenode **SymTable_find(SymTable_T oSymTable,
+    const char *pcKey, size_t uHash, size_t uLength) {
+    struct HashTablenode **link;
+    struct HashTablenode *currnode;
+
+    link=SymTable_chain(oSymTable,uHash);
+    for (currnode=*link; currnode!=NULL; currnode=*link)
+    {
+        if (currnode->hash==uHash&&currnode->length==uLength&&
+            memcmp(SymTable_key(currnode),pcKey,uLength)==0)
+        {
+            break;
+        }
+        link=&currnode->next;
+    }
+    return link;
+}
+
+/* Acquire every stripe of oSymTable, always in the same order so that
+   two threads doing so cannot deadlock. */
+static void SymTable_lockAll(SymTable_T oSymTable) {
+    size_t index;
+
+    for (index = 0; index < STRIPE_COUNT; index++)
+        pthread_mutex_lock(&oSymTable->stripes[index].stripe.lock);
+}
+
+/* Release every stripe of oSymTable. */
+static void SymTable_unlockAll(SymTable_T oSymTable) {
+    size_t index;
+
+    for (index = STRIPE_COUNT; index > 0; index--)
+        pthread_mutex_unlock(&oSymTable->stripes[index-1].stripe.lock);
+}
+
+/* Free the first uCount stripes of oSymTable and the table itself. */
+static void SymTable_destroy(SymTable_T oSymTable, size_t uCount) {
+    size_t index;
+
+    for (index = 0; index < uCount; index++) {
+        pthread_mutex_destroy(&oSymTable->stripes[index].stripe.lock);
+        Slab_free(oSymTable->stripes[index].stripe.slab);
+    }
+    free(oSymTable->hashbuckets);
+    free(oSymTable);
+}
+
+SymTable_T SymTable_newWithHash(SymTable_HashFunction pfHash){
+    SymTable_T symtablenew;
+    struct Stripe *stripe;
+    size_t index;
+
+    symtablenew =(SymTable_T)malloc(sizeof(struct Stack));
+    if (symtablenew==NULL)
+    {
+        return NULL;
+    }
+
+    symtablenew->hashbuckets=(struct HashTablenode**)calloc(INITIAL_BUCKETS,sizeof(struct HashTablenode*));
+    if (symtablenew->hashbuckets==NULL)
+    {
+        free(symtablenew);
+        return NULL;
+    }
+
+    for (index = 0; index < STRIPE_COUNT; index++) {
+        stripe=&symtablenew->stripes[index].stripe;
+        stripe->bindings=0;
+        stripe->slab=Slab_new();
+        if (stripe->slab==NULL)
+        {
+            SymTable_destroy(symtablenew,index);
+            return NULL;
+        }
+        if (pthread_mutex_init(&stripe->lock,NULL)!=0)
+        {
+            Slab_free(stripe->slab);
+            SymTable_destroy(symtablenew,index);
+            return NULL;
+        }
+    }
+
+    symtablenew->bucketcount=INITIAL_BUCKETS;
+    symtablenew->hashfn=pfHash;
+    return symtablenew;
+}
+
+SymTable_T SymTable_new(void){
+    return SymTable_newWithHash(NULL);
+}
+
+void SymTable_free(SymTable_T oSymTable){
+
+    assert(oSymTable!=NULL);
+
+    /* Every node lives in a stripe's slab, so no chain needs to be
+       walked. */
+    SymTable_destroy(oSymTable,STRIPE_COUNT);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+    struct Stripe *stripe;
+    size_t bindings=0;
+    size_t index;
+
+    assert(oSymTable!=NULL);
+
+    /* Each stripe is counted at a slightly different moment, so while
+       other threads are putting or removing, the total is only
+       approximate. */
+    for (index = 0; index < STRIPE_COUNT; index++) {
+        stripe=&oSymTable->stripes[index].stripe;
+        pthread_mutex_lock(&stripe->lock);
+        bindings+=stripe->bindings;
+        pthread_mutex_unlock(&stripe->lock);
+    }
+    return bindings;
+}
+
+/*Doubles the bucket count of oSymTable if its bindings still
+outnumber its buckets once every stripe is held; another thread may
+have grown it first. The caller must hold no stripe. Leaves oSymTable
+unchanged if memory allocation fails. */
+static void SymTable_grow(SymTable_T oSymTable) {
+    struct HashTablenode **newbuckets;
+    struct HashTablenode *currnode;
+    struct HashTablenode *nextnode;
+    size_t bindings=0;
+    size_t newsize;
+    size_t hashnum;
+    size_t index;
+
+    SymTable_lockAll(oSymTable);
+
+    for (index = 0; index < STRIPE_COUNT; index++)
+        bindings+=oSymTable->stripes[index].stripe.bindings;
+    newsize=oSymTable->bucketcount*2;
+    if (bindings<=oSymTable->bucketcount||newsize/2!=oSymTable->bucketcount||
+        newsize>(size_t)-1/sizeof(struct HashTablenode*))
+    {
+        SymTable_unlockAll(oSymTable);
+        return;
+    }
+
+    newbuckets=(struct HashTablenode**)calloc(newsize,sizeof(struct HashTablenode*));
+    if (newbuckets==NULL)
+    {
+        SymTable_unlockAll(oSymTable);
+        return;
+    }
+
+    for (index = 0; index < oSymTable->bucketcount; index++) {
+        for (currnode=oSymTable->hashbuckets[index]; currnode!=NULL; currnode=nextnode){
+            nextnode=currnode->next;
+
+            hashnum=currnode->hash&(newsize-1);
+            currnode->next=newbuckets[hashnum];
+            newbuckets[hashnum]=currnode;
+        }
+    }
+
+    free(oSymTable->hashbuckets);
+    oSymTable->hashbuckets=newbuckets;
+    oSymTable->bucketcount=newsize;
+
+    SymTable_unlockAll(oSymTable);
+}
+
+int SymTable_put(SymTable_T oSymTable, const char *pcKey, const void *pvValue){
+    struct HashTablenode *new;
+    struct HashTablenode **link;
+    struct Stripe *stripe;
+    size_t length;
+    size_t hash;
+    int crowded;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    length=strlen(pcKey);
+    hash=SymTable_hash(oSymTable,pcKey,length);
+    stripe=SymTable_stripe(oSymTable,hash);
+
+    pthread_mutex_lock(&stripe->lock);
+
+    link=SymTable_find(oSymTable,pcKey,hash,length);
+    if (*link!=NULL)
+    {
+        pthread_mutex_unlock(&stripe->lock);
+        return 0;
+    }
+
+    new=(struct HashTablenode*)Slab_alloc(stripe->slab,SymTable_nodeSize(length));
+    if (new==NULL)
+    {
+        pthread_mutex_unlock(&stripe->lock);
+        return 0;
+    }
+
+    memcpy((char*)SymTable_key(new),pcKey,length+1);
+    new->hash=hash;
+    new->length=length;
+    new->value=(void*)pvValue;
+    new->next=NULL;
+    *link=new;
+
+    stripe->bindings++;
+    /* A good hash spreads the bindings evenly over the stripes, so one
+       stripe holding more than its share of buckets means the whole
+       table is about to. Growing takes every stripe, so it has to wait
+       until this one is released. */
+    crowded=stripe->bindings>oSymTable->bucketcount/STRIPE_COUNT;
+
+    pthread_mutex_unlock(&stripe->lock);
+
+    if (crowded)
+        SymTable_grow(oSymTable);
+    return 1;
+}
+
+void *SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue){
+    struct HashTablenode *currnode;
+    struct Stripe *stripe;
+    void *oldval=NULL;
+    size_t length;
+    size_t hash;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    length=strlen(pcKey);
+    hash=SymTable_hash(oSymTable,pcKey,length);
+    stripe=SymTable_stripe(oSymTable,hash);
+
+    pthread_mutex_lock(&stripe->lock);
+    currnode=*SymTable_find(oSymTable,pcKey,hash,length);
+    if (currnode!=NULL)
+    {
+        oldval=currnode->value;
+        currnode->value=(void*)pvValue;
+    }
+    pthread_mutex_unlock(&stripe->lock);
+
+    return oldval;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+    struct Stripe *stripe;
+    size_t length;
+    size_t hash;
+    int found;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    length=strlen(pcKey);
+    hash=SymTable_hash(oSymTable,pcKey,length);
+    stripe=SymTable_stripe(oSymTable,hash);
+
+    pthread_mutex_lock(&stripe->lock);
+    found=*SymTable_find(oSymTable,pcKey,hash,length)!=NULL;
+    pthread_mutex_unlock(&stripe->lock);
+
+    return found;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+    struct HashTablenode *currnode;
+    struct Stripe *stripe;
+    void *value=NULL;
+    size_t length;
+    size_t hash;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    length=strlen(pcKey);
+    hash=SymTable_hash(oSymTable,pcKey,length);
+    stripe=SymTable_stripe(oSymTable,hash);
+
+    pthread_mutex_lock(&stripe->lock);
+    currnode=*SymTable_find(oSymTable,pcKey,hash,length);
+    if (currnode!=NULL)
+        value=currnode->value;
+    pthread_mutex_unlock(&stripe->lock);
+
+    return value;
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+    struct HashTablenode *currnode;
+    struct HashTablenode **link;
+    struct Stripe *stripe;
+    void *returni=NULL;
+    size_t length;
+    size_t hash;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    length=strlen(pcKey);
+    hash=SymTable_hash(oSymTable,pcKey,length);
+    stripe=SymTable_stripe(oSymTable,hash);
+
+    pthread_mutex_lock(&stripe->lock);
+    link=SymTable_find(oSymTable,pcKey,hash,length);
+    currnode=*link;
+    if (currnode!=NULL)
+    {
+        *link=currnode->next;
+        returni=currnode->value;
+        stripe->bindings--;
+        Slab_release(stripe->slab,currnode,SymTable_nodeSize(currnode->length));
+    }
+    pthread_mutex_unlock(&stripe->lock);
+
+    /* The table never shrinks: deciding to would need the total
+       binding count, which only a pass over every stripe can give. */
+    return returni;
+}
+
+/* Every stripe is held while pfApply runs, so pfApply must not call
+   any function on oSymTable. */
+void SymTable_map(SymTable_T oSymTable,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+
+    struct HashTablenode *currnode;
+    size_t index;
+
+    assert(oSymTable!=NULL);
+    assert(pfApply!=NULL);
+
+    SymTable_lockAll(oSymTable);
+
+    for (index = 0; index < oSymTable->bucketcount; index++) {
+        for ( currnode=oSymTable->hashbuckets[index]; currnode!=NULL; currnode=currnode->next){
+        (*pfApply)(SymTable_key(currnode),(void*)currnode->value,(void*)pvExtra);
+        }
+    }
+
+    SymTable_unlockAll(oSymTable);
+}
@@ -0,0 +1,424 @@
+/*--------------------------------------------------------------------*/
+/* symtableflat.c                                                     */
+/* Author: Kevin Castro                                               */
+/*--------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include "symtable.h"
+#include "hashfn.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* Number of control bytes that are probed together. */
+enum {GROUP_WIDTH = 16};
+
+/* Number of slots in a newly created table. Must be a power of two
+   and a multiple of GROUP_WIDTH. */
+enum {INITIAL_SLOTS = 64};
+
+/* Control byte values. A full slot stores the low 7 bits of its
+   key's hash, so full control bytes are never negative. */
+enum {CTRL_EMPTY = -128, CTRL_DELETED = -2};
+
+/* Each binding lives directly in a FlatSlot of the slot array. */
+struct FlatSlot {
+    /* The key*/
+    const char *string;
+    /* The value*/
+    void *value;
+    /* The full hash of the key, kept so that growing never rehashes */
+    size_t hash;
+};
+
+/* An open-addressed table. ctrl[i] describes slots[i]. */
+struct Stack {
+    /*Number of slots in the table, a power of two*/
+    size_t slotcount;
+    /*One control byte per slot*/
+    signed char *ctrl;
+    /*The slot array*/
+    struct FlatSlot *slots;
+    /*Number of bindings in the table*/
+    size_t bindings;
+    /*Number of slots marked CTRL_DELETED*/
+    size_t tombstones;
+    /*Caller's hash function, or NULL for HashFn_words*/
+    SymTable_HashFunction hashfn;
+};
+
+/* Return the hash code oSymTable uses for pcKey. Every bit depends on
+   every byte of pcKey, so both the slot index and the 7-bit fingerprint
+   are usable. */
+static size_t SymTable_hash(SymTable_T oSymTable, const char *pcKey) {
+    assert(pcKey != NULL);
+
+    if (oSymTable->hashfn == NULL)
+    {
+        return HashFn_words(pcKey, strlen(pcKey));
+    }
+    return HashFn_mix((*oSymTable->hashfn)(pcKey, strlen(pcKey)));
+}
+
+/* Return the 7-bit fingerprint stored in the control byte for a key
+   with hash uHash. */
+static signed char SymTable_fingerprint(size_t uHash) {
+    return (signed char)(uHash & 0x7F);
+}
+
+/* Return a bit mask with bit i set if ctrl[i] equals cByte, for the
+   GROUP_WIDTH control bytes starting at pcCtrl. */
+static unsigned SymTable_matchByte(const signed char *pcCtrl,
+    signed char cByte) {
+#ifdef __SSE2__
+    __m128i group = _mm_loadu_si128((const __m128i *)(const void *)pcCtrl);
+    __m128i match = _mm_cmpeq_epi8(group, _mm_set1_epi8((char)cByte));
+    return (unsigned)_mm_movemask_epi8(match);
+#else
+    unsigned mask = 0;
+    int i;
+    for (i = 0; i < GROUP_WIDTH; i++){
+        if (pcCtrl[i] == cByte)
+            mask |= 1U << i;
+    }
+    return mask;
+#endif
+}
+
+/* Return a bit mask with bit i set if ctrl[i] is empty or deleted, for
+   the GROUP_WIDTH control bytes starting at pcCtrl. */
+static unsigned SymTable_matchFree(const signed char *pcCtrl) {
+#ifdef __SSE2__
+    __m128i group = _mm_loadu_si128((const __m128i *)(const void *)pcCtrl);
+    return (unsigned)_mm_movemask_epi8(group);
+#else
+    unsigned mask = 0;
+    int i;
+    for (i = 0; i < GROUP_WIDTH; i++){
+        if (pcCtrl[i] < 0)
+            mask |= 1U << i;
+    }
+    return mask;
+#endif
+}
+
+/* Return the index of the lowest set bit of the nonzero uMask. */
+static size_t SymTable_lowestBit(unsigned uMask) {
+    size_t u = 0;
+
+    assert(uMask != 0);
+
+    while ((uMask & 1U) == 0){
+        uMask >>= 1;
+        u++;
+    }
+    return u;
+}
+
+/* Return the slot index holding pcKey, whose hash is uHash, in
+   oSymTable, or oSymTable->slotcount if there is no such binding. */
+static size_t SymTable_find(SymTable_T oSymTable, const char *pcKey,
+    size_t uHash) {
+    size_t groupmask = oSymTable->slotcount / GROUP_WIDTH - 1;
+    size_t group = (uHash >> 7) & groupmask;
+    size_t step = 0;
+    signed char fingerprint = SymTable_fingerprint(uHash);
+
+    for (;;){
+        const signed char *ctrl = oSymTable->ctrl + group * GROUP_WIDTH;
+        unsigned match = SymTable_matchByte(ctrl, fingerprint);
+
+        while (match != 0){
+            size_t index = group * GROUP_WIDTH + SymTable_lowestBit(match);
+            struct FlatSlot *slot = &oSymTable->slots[index];
+            if (slot->hash == uHash && strcmp(slot->string, pcKey) == 0)
+            {
+                return index;
+            }
+            match &= match - 1;
+        }
+
+        /* An empty slot ends the probe sequence. */
+        if (SymTable_matchByte(ctrl, (signed char)CTRL_EMPTY) != 0)
+        {
+            return oSymTable->slotcount;
+        }
+
+        step++;
+        if (step > groupmask)
+        {
+            return oSymTable->slotcount;
+        }
+        group = (group + step) & groupmask;
+    }
+}
+
+/* Return the index of the first empty or deleted slot on the probe
+   sequence for a key with hash uHash. The table must not be full. */
+static size_t SymTable_findFree(signed char *pcCtrl, size_t uSlotCount,
+    size_t uHash) {
+    size_t groupmask = uSlotCount / GROUP_WIDTH - 1;
+    size_t group = (uHash >> 7) & groupmask;
+    size_t step = 0;
+
+    for (;;){
+        unsigned match = SymTable_matchFree(pcCtrl + group * GROUP_WIDTH);
+        if (match != 0)
+        {
+            return group * GROUP_WIDTH + SymTable_lowestBit(match);
+        }
+        step++;
+        group = (group + step) & groupmask;
+    }
+}
+
+/* Allocate control bytes and slots for uSlotCount slots into oSymTable,
+   all marked empty. Returns 1 on success, 0 if memory allocation
+   fails, in which case oSymTable is unchanged. */
+static int SymTable_allocSlots(SymTable_T oSymTable, size_t uSlotCount) {
+    signed char *ctrl;
+    struct FlatSlot *slots;
+
+    ctrl = (signed char*)malloc(uSlotCount);
+    if (ctrl == NULL)
+    {
+        return 0;
+    }
+    slots = (struct FlatSlot*)malloc(uSlotCount * sizeof(struct FlatSlot));
+    if (slots == NULL)
+    {
+        free(ctrl);
+        return 0;
+    }
+    memset(ctrl, CTRL_EMPTY, uSlotCount);
+
+    oSymTable->ctrl = ctrl;
+    oSymTable->slots = slots;
+    oSymTable->slotcount = uSlotCount;
+    oSymTable->tombstones = 0;
+    return 1;
+}
+
+/* Move every binding of oSymTable into a fresh slot array with
+   uSlotCount slots, dropping tombstones. Returns 1 on success, 0 and
+   leaves oSymTable unchanged if memory allocation fails. */
+static int SymTable_resize(SymTable_T oSymTable, size_t uSlotCount) {
+    signed char *oldctrl = oSymTable->ctrl;
+    struct FlatSlot *oldslots = oSymTable->slots;
+    size_t oldcount = oSymTable->slotcount;
+    size_t index;
+
+    if (!SymTable_allocSlots(oSymTable, uSlotCount))
+    {
+        return 0;
+    }
+
+    for (index = 0; index < oldcount; index++){
+        if (oldctrl[index] >= 0)
+        {
+            size_t hash = oldslots[index].hash;
+            size_t newindex = SymTable_findFree(oSymTable->ctrl,
+                uSlotCount, hash);
+            oSymTable->ctrl[newindex] = SymTable_fingerprint(hash);
+            oSymTable->slots[newindex] = oldslots[index];
+        }
+    }
+
+    free(oldctrl);
+    free(oldslots);
+    return 1;
+}
+
+SymTable_T SymTable_new(void){
+    return SymTable_newWithHash(NULL);
+}
+
+SymTable_T SymTable_newWithHash(SymTable_HashFunction pfHash){
+    SymTable_T symtablenew;
+
+    symtablenew = (SymTable_T)malloc(sizeof(struct Stack));
+    if (symtablenew == NULL)
+    {
+        return NULL;
+    }
+
+    if (!SymTable_allocSlots(symtablenew, INITIAL_SLOTS))
+    {
+        free(symtablenew);
+        return NULL;
+    }
+    symtablenew->bindings = 0;
+    symtablenew->hashfn = pfHash;
+    return symtablenew;
+}
+
+void SymTable_free(SymTable_T oSymTable){
+    size_t index;
+
+    assert(oSymTable != NULL);
+
+    for (index = 0; index < oSymTable->slotcount; index++){
+        if (oSymTable->ctrl[index] >= 0)
+        {
+            free((void*)oSymTable->slots[index].string);
+        }
+    }
+    free(oSymTable->ctrl);
+    free(oSymTable->slots);
+    free(oSymTable);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+
+    assert(oSymTable != NULL);
+
+    return oSymTable->bindings;
+}
+
+int SymTable_put(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue){
+    size_t hash;
+    size_t index;
+    char *string;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    hash = SymTable_hash(oSymTable, pcKey);
+    if (SymTable_find(oSymTable, pcKey, hash) != oSymTable->slotcount)
+    {
+        return 0;
+    }
+
+    /* Keep at least one slot in eight free so probe sequences stay
+       short. Grow when live bindings dominate, otherwise just sweep
+       the tombstones away at the same size. */
+    if ((oSymTable->bindings + oSymTable->tombstones + 1) * 8 >
+        oSymTable->slotcount * 7)
+    {
+        size_t newcount = oSymTable->slotcount;
+        if (oSymTable->bindings * 2 >= oSymTable->slotcount)
+            newcount *= 2;
+        if (!SymTable_resize(oSymTable, newcount))
+        {
+            return 0;
+        }
+    }
+
+    string = (char*)malloc(strlen(pcKey) + 1);
+    if (string == NULL)
+    {
+        return 0;
+    }
+    strcpy(string, pcKey);
+
+    index = SymTable_findFree(oSymTable->ctrl, oSymTable->slotcount, hash);
+    if (oSymTable->ctrl[index] == CTRL_DELETED)
+        oSymTable->tombstones--;
+    oSymTable->ctrl[index] = SymTable_fingerprint(hash);
+    oSymTable->slots[index].string = string;
+    oSymTable->slots[index].value = (void*)pvValue;
+    oSymTable->slots[index].hash = hash;
+    oSymTable->bindings++;
+
+    return 1;
+}
+
+void *SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue){
+    size_t index;
+    void *oldval;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    index = SymTable_find(oSymTable, pcKey, SymTable_hash(oSymTable, pcKey));
+    if (index == oSymTable->slotcount)
+    {
+        return NULL;
+    }
+
+    oldval = oSymTable->slots[index].value;
+    oSymTable->slots[index].value = (void*)pvValue;
+    return oldval;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    return SymTable_find(oSymTable, pcKey, SymTable_hash(oSymTable, pcKey))
+        != oSymTable->slotcount;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+    size_t index;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    index = SymTable_find(oSymTable, pcKey, SymTable_hash(oSymTable, pcKey));
+    if (index == oSymTable->slotcount)
+    {
+        return NULL;
+    }
+    return oSymTable->slots[index].value;
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+    size_t index;
+    void *returni;
+    const signed char *group;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    index = SymTable_find(oSymTable, pcKey, SymTable_hash(oSymTable, pcKey));
+    if (index == oSymTable->slotcount)
+    {
+        return NULL;
+    }
+
+    returni = oSymTable->slots[index].value;
+    free((void*)oSymTable->slots[index].string);
+    oSymTable->bindings--;
+
+    /* A group that still has an empty slot never made a probe
+       sequence continue past it, so the slot can become empty again.
+       Otherwise leave a tombstone. */
+    group = oSymTable->ctrl + index / GROUP_WIDTH * GROUP_WIDTH;
+    if (SymTable_matchByte(group, (signed char)CTRL_EMPTY) != 0)
+    {
+        oSymTable->ctrl[index] = CTRL_EMPTY;
+    }
+    else
+    {
+        oSymTable->ctrl[index] = CTRL_DELETED;
+        oSymTable->tombstones++;
+    }
+
+    return returni;
+}
+
+void SymTable_map(SymTable_T oSymTable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    size_t index;
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    for (index = 0; index < oSymTable->slotcount; index++){
+        if (oSymTable->ctrl[index] >= 0)
+        {
+            (*pfApply)(oSymTable->slots[index].string,
+                oSymTable->slots[index].value, (void*)pvExtra);
+        }
+    }
+}
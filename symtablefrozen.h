@@ -0,0 +1,36 @@
+/*--------------------------------------------------------------------*/
+/* symtablefrozen.h                                                   */
+/* Author: Kevin Castro                                               */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLEFROZEN_INCLUDED
+#define SYMTABLEFROZEN_INCLUDED
+
+#include "symtable.h"
+
+/* The function below is provided by the hash table implementation. A
+   frozen table is for bindings that no longer change. It is built
+   around a minimal perfect hash function, which sends each of its keys
+   to a slot of its own, so it has no chains and no empty slots. A slot
+   is a 32-bit fingerprint of the key's hash, the 32-bit offset of the
+   key in one block holding every key, each ending where the next
+   begins, and the value: 16 bytes with a 64-bit pointer. With the keys'
+   bytes and the displacements, under two bytes per key, that is the
+   whole table. A lookup reads its bucket's displacement, likely cached,
+   then exactly one slot and, if the fingerprint matches, one key. Keys
+   whose hash some other key already has cannot be given slots of their
+   own; they overflow into slots after the rest, which only a lookup
+   that lands on a slot marked as sharing its hash goes on to search. */
+
+/* Returns a frozen table holding the bindings of oSymTable that the
+   other functions see, each in the outermost scope. oSymTable is left
+   as it was. Keys are hashed with the default hash, whatever hash
+   function oSymTable uses. Only the functions that do not change a
+   table may be called on the frozen table, other than SymTable_clone.
+   SymTable_map and iteration visit its bindings in slot order. Building
+   takes time roughly proportional to the number of bindings. Returns
+   NULL if memory allocation fails. oSymTable must not come from
+   SymTable_openMapped. */
+SymTable_T SymTable_freeze(SymTable_T oSymTable);
+
+#endif
@@ -0,0 +1,898 @@
+/*--------------------------------------------------------------------*/
+/* symtablehamt.c                                                     */
+/* Author: Kevin Castro                                               */
+/*--------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include "symtable.h"
+#include "symtablehamt.h"
+#include "hashfn.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#ifndef __GNUC__
+#include <pthread.h>
+#endif
+
+/* A persistent hash array mapped trie. Each level of the trie uses
+   BITS_PER_LEVEL bits of the hash to pick one of BRANCHES slots, and a
+   node stores only its occupied slots: datamap marks the slots that
+   hold a binding and nodemap those that hold a deeper node, and the
+   node's entries are its bindings in slot order followed by its
+   deeper nodes in slot order. Keys whose whole hashes are equal end
+   up in a collision node below the last level.
+
+   Nodes and leaves are shared between a table and its snapshots, and
+   each carries a count of the references to it. A change copies the
+   nodes on its path that are shared, leaving the old versions intact
+   for whoever else holds them, and changes in place the nodes that
+   only it can reach. A node is only reachable from one table if its
+   count is 1 and so are the counts of every node above it.
+
+   Counts are changed atomically, so a snapshot may be freed in one
+   thread while the table it was taken from changes in another. GCC's
+   atomic builtins do this where the compiler has them; elsewhere one
+   lock guards every count. */
+
+/* Hash bits used per level, and slots per node. */
+enum {BITS_PER_LEVEL = 5, BRANCHES = 1 << BITS_PER_LEVEL};
+
+/* Number of hash bits. A node at this shift or deeper is a collision
+   node. */
+enum {HASH_BITS = CHAR_BIT * sizeof(size_t)};
+
+/* A binding. The bytes of the key, with their '\0', follow the leaf. */
+struct HamtLeaf {
+    /* Number of references to the leaf*/
+    size_t refs;
+    /* The full hash of the key*/
+    size_t hash;
+    /* The length of the key, not counting the '\0'*/
+    size_t length;
+    /* The value*/
+    void *value;
+};
+
+/* A trie node. Its entries follow it: first the leaves, then the
+   nodes. A collision node has only leaves, and keeps their number in
+   datamap. */
+struct HamtNode {
+    /* Number of references to the node*/
+    size_t refs;
+    /* Slots holding a leaf*/
+    unsigned long datamap;
+    /* Slots holding a deeper node*/
+    unsigned long nodemap;
+};
+
+/*A stack is one version of the trie.*/
+struct Stack {
+    /*The root node, which may have no entries*/
+    struct HamtNode *root;
+    /*Number of bindings in this version*/
+    size_t bindings;
+    /*Caller's hash function, or NULL for HashFn_words*/
+    SymTable_HashFunction hashfn;
+};
+
+/* Return the number of bits set in ulBits. */
+static size_t SymTable_popcount(unsigned long ulBits) {
+#ifdef __GNUC__
+    return (size_t)__builtin_popcountl(ulBits);
+#else
+    size_t count=0;
+
+    for (; ulBits != 0; ulBits &= ulBits - 1)
+        count++;
+    return count;
+#endif
+}
+
+/* Return the key stored inline after poLeaf. */
+static const char *SymTable_key(const struct HamtLeaf *poLeaf) {
+    return (const char*)(poLeaf + 1);
+}
+
+/* Return the entries of poNode. */
+static void **SymTable_entries(struct HamtNode *poNode) {
+    return (void**)(poNode + 1);
+}
+
+/* Return the number of leaves of poNode, which is at shift uShift. */
+static size_t SymTable_leafCount(const struct HamtNode *poNode,
+    size_t uShift) {
+    if (uShift>=HASH_BITS)
+        return (size_t)poNode->datamap;
+    return SymTable_popcount(poNode->datamap);
+}
+
+/* Return the number of deeper nodes of poNode. */
+static size_t SymTable_nodeCount(const struct HamtNode *poNode) {
+    return SymTable_popcount(poNode->nodemap);
+}
+
+/* Return the bit for the slot a key with hash uHash takes in a node at
+   shift uShift. */
+static unsigned long SymTable_bit(size_t uHash, size_t uShift) {
+    return 1UL << ((uHash >> uShift) & (BRANCHES - 1));
+}
+
+/* Return the hash code oSymTable uses for the uLength bytes at pcKey. */
+static size_t SymTable_hash(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength) {
+    if (oSymTable->hashfn == NULL)
+    {
+        return HashFn_words(pcKey, uLength);
+    }
+    return HashFn_mix((*oSymTable->hashfn)(pcKey, uLength));
+}
+
+#ifndef __GNUC__
+/* The lock that guards every reference count, without GCC's atomic
+   builtins. */
+static pthread_mutex_t refsLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* Add 1 to the reference count *puRefs if iAdd, and subtract 1
+   otherwise. Returns the new count. */
+static size_t SymTable_countRef(size_t *puRefs, int iAdd) {
+#ifdef __GNUC__
+    if (iAdd)
+        return __atomic_add_fetch(puRefs,1,__ATOMIC_RELAXED);
+    return __atomic_sub_fetch(puRefs,1,__ATOMIC_ACQ_REL);
+#else
+    size_t refs;
+
+    pthread_mutex_lock(&refsLock);
+    if (iAdd)
+        (*puRefs)++;
+    else
+        (*puRefs)--;
+    refs=*puRefs;
+    pthread_mutex_unlock(&refsLock);
+    return refs;
+#endif
+}
+
+/* Return the reference count *puRefs. */
+static size_t SymTable_loadRefs(size_t *puRefs) {
+#ifdef __GNUC__
+    return __atomic_load_n(puRefs,__ATOMIC_ACQUIRE);
+#else
+    size_t refs;
+
+    pthread_mutex_lock(&refsLock);
+    refs=*puRefs;
+    pthread_mutex_unlock(&refsLock);
+    return refs;
+#endif
+}
+
+/* Add a reference to pvEntry, a node or leaf. Both start with their
+   reference count. */
+static void SymTable_retain(void *pvEntry) {
+    SymTable_countRef((size_t*)pvEntry,1);
+}
+
+/* Return 1 if pvEntry, a node or leaf, can be reached only through the
+   reference the caller followed, and 0 otherwise. iShared says whether
+   a node above it is shared, which makes it shared too. */
+static int SymTable_isOwned(void *pvEntry, int iShared) {
+    return !iShared&&SymTable_loadRefs((size_t*)pvEntry)==1;
+}
+
+/* Drop a reference to poLeaf, freeing it if it was the last. */
+static void SymTable_releaseLeaf(struct HamtLeaf *poLeaf) {
+    if (SymTable_countRef(&poLeaf->refs,0)==0)
+        free(poLeaf);
+}
+
+/* Drop a reference to poNode, at shift uShift, freeing it and
+   dropping its references to its entries if it was the last. */
+static void SymTable_releaseNode(struct HamtNode *poNode, size_t uShift) {
+    size_t leaves;
+    size_t index;
+
+    if (SymTable_countRef(&poNode->refs,0)!=0)
+        return;
+
+    leaves=SymTable_leafCount(poNode,uShift);
+    for (index = 0; index < leaves; index++)
+        SymTable_releaseLeaf((struct HamtLeaf*)SymTable_entries(poNode)[index]);
+    for (index = 0; index < SymTable_nodeCount(poNode); index++)
+        SymTable_releaseNode((struct HamtNode*)SymTable_entries(poNode)[leaves+index],
+            uShift+BITS_PER_LEVEL);
+    free(poNode);
+}
+
+/* Return a new node with room for uEntries entries and none in use, or
+   NULL if memory allocation fails. */
+static struct HamtNode *SymTable_newNode(size_t uEntries) {
+    struct HamtNode *node;
+
+    if (uEntries>((size_t)-1-sizeof(struct HamtNode))/sizeof(void*))
+    {
+        return NULL;
+    }
+    node=(struct HamtNode*)malloc(sizeof(struct HamtNode)+uEntries*sizeof(void*));
+    if (node==NULL)
+    {
+        return NULL;
+    }
+    node->refs=1;
+    node->datamap=0;
+    node->nodemap=0;
+    return node;
+}
+
+/* Return a new leaf binding the uLength bytes at pcKey, whose hash is
+   uHash, to pvValue, or NULL if memory allocation fails. */
+static struct HamtLeaf *SymTable_newLeaf(const char *pcKey, size_t uLength,
+    size_t uHash, const void *pvValue) {
+    struct HamtLeaf *leaf;
+
+    if (uLength>(size_t)-1-sizeof(struct HamtLeaf)-1)
+    {
+        return NULL;
+    }
+    leaf=(struct HamtLeaf*)malloc(sizeof(struct HamtLeaf)+uLength+1);
+    if (leaf==NULL)
+    {
+        return NULL;
+    }
+    leaf->refs=1;
+    leaf->hash=uHash;
+    leaf->length=uLength;
+    leaf->value=(void*)pvValue;
+    memcpy((char*)SymTable_key(leaf),pcKey,uLength);
+    ((char*)SymTable_key(leaf))[uLength]='\0';
+    return leaf;
+}
+
+/* Return 1 if poLeaf has the key of uLength bytes at pcKey, whose hash
+   is uHash, and 0 otherwise. */
+static int SymTable_matches(const struct HamtLeaf *poLeaf, const char *pcKey,
+    size_t uLength, size_t uHash) {
+    return poLeaf->hash==uHash&&poLeaf->length==uLength&&
+        memcmp(SymTable_key(poLeaf),pcKey,uLength)==0;
+}
+
+/* Return a copy of poNode, at shift uShift, with room for uExtra more
+   entries, holding a new reference to each entry of poNode. Returns
+   NULL if memory allocation fails. */
+static struct HamtNode *SymTable_copyNode(struct HamtNode *poNode,
+    size_t uShift, size_t uExtra) {
+    size_t entries=SymTable_leafCount(poNode,uShift)+SymTable_nodeCount(poNode);
+    struct HamtNode *copy;
+    size_t index;
+
+    copy=SymTable_newNode(entries+uExtra);
+    if (copy==NULL)
+    {
+        return NULL;
+    }
+    copy->datamap=poNode->datamap;
+    copy->nodemap=poNode->nodemap;
+    memcpy(SymTable_entries(copy),SymTable_entries(poNode),entries*sizeof(void*));
+    for (index = 0; index < entries; index++)
+        SymTable_retain(SymTable_entries(copy)[index]);
+    return copy;
+}
+
+/* Return a new node, at shift uShift, holding the leaves poFirst and
+   poSecond, whose keys differ, and the references passed with them.
+   Where their hashes agree on a level's bits, the node has a single
+   deeper node instead. Returns NULL if memory allocation fails. */
+static struct HamtNode *SymTable_pair(struct HamtLeaf *poFirst,
+    struct HamtLeaf *poSecond, size_t uShift) {
+    struct HamtNode *node;
+    struct HamtNode *below;
+    unsigned long firstbit;
+    unsigned long secondbit;
+
+    if (uShift>=HASH_BITS)
+    {
+        node=SymTable_newNode(2);
+        if (node==NULL)
+        {
+            return NULL;
+        }
+        node->datamap=2;
+        SymTable_entries(node)[0]=poFirst;
+        SymTable_entries(node)[1]=poSecond;
+        return node;
+    }
+
+    firstbit=SymTable_bit(poFirst->hash,uShift);
+    secondbit=SymTable_bit(poSecond->hash,uShift);
+    if (firstbit!=secondbit)
+    {
+        node=SymTable_newNode(2);
+        if (node==NULL)
+        {
+            return NULL;
+        }
+        node->datamap=firstbit|secondbit;
+        SymTable_entries(node)[firstbit<secondbit?0:1]=poFirst;
+        SymTable_entries(node)[firstbit<secondbit?1:0]=poSecond;
+        return node;
+    }
+
+    node=SymTable_newNode(1);
+    if (node==NULL)
+    {
+        return NULL;
+    }
+    below=SymTable_pair(poFirst,poSecond,uShift+BITS_PER_LEVEL);
+    if (below==NULL)
+    {
+        free(node);
+        return NULL;
+    }
+    node->nodemap=firstbit;
+    SymTable_entries(node)[0]=below;
+    return node;
+}
+
+/* How SymTable_assoc treats a key that is already bound. */
+enum AssocMode {ASSOC_ADD, ASSOC_REPLACE};
+
+/* Results of SymTable_assoc and SymTable_dissoc. */
+enum {ASSOC_FAILED = -1, ASSOC_UNCHANGED = 0, ASSOC_ADDED = 1,
+      ASSOC_REPLACED = 2};
+
+/* Bind the uLength bytes at pcKey, whose hash is uHash, to pvValue in
+   the trie poNode at shift uShift. In ASSOC_ADD mode an existing
+   binding is left alone; in ASSOC_REPLACE mode a missing one is not
+   added, and the old value of an existing one is stored in *ppvOld.
+   iShared says whether a node above poNode is shared.
+
+   Sets *piResult to one of the results above, and returns the node that
+   should take poNode's place: poNode itself if it was changed in place
+   or not at all, or a new node. A new node holds its own reference.
+   If poNode was owned, its references have moved to the new node and
+   it has been freed; otherwise the caller still holds its reference
+   to poNode. Returns NULL if memory allocation fails, in which case
+   nothing has changed. */
+static struct HamtNode *SymTable_assoc(struct HamtNode *poNode,
+    size_t uShift, int iShared, enum AssocMode eMode, const char *pcKey,
+    size_t uLength, size_t uHash, const void *pvValue, void **ppvOld,
+    int *piResult) {
+    int owned=SymTable_isOwned(poNode,iShared);
+    size_t leaves=SymTable_leafCount(poNode,uShift);
+    size_t nodes=SymTable_nodeCount(poNode);
+    struct HamtLeaf *leaf=NULL;
+    struct HamtLeaf *newleaf;
+    struct HamtNode *result;
+    unsigned long bit=0;
+    size_t index;
+
+    *piResult=ASSOC_UNCHANGED;
+
+    /* Find the leaf for the key, if there is one. */
+    if (uShift>=HASH_BITS)
+    {
+        for (index = 0; index < leaves; index++) {
+            leaf=(struct HamtLeaf*)SymTable_entries(poNode)[index];
+            if (SymTable_matches(leaf,pcKey,uLength,uHash))
+                break;
+        }
+        if (index==leaves)
+            leaf=NULL;
+    }
+    else
+    {
+        bit=SymTable_bit(uHash,uShift);
+        if (poNode->nodemap&bit)
+        {
+            struct HamtNode *child;
+            struct HamtNode *newchild;
+            int childowned;
+
+            index=leaves+SymTable_popcount(poNode->nodemap&(bit-1));
+            child=(struct HamtNode*)SymTable_entries(poNode)[index];
+            childowned=owned&&SymTable_isOwned(child,0);
+            newchild=SymTable_assoc(child,uShift+BITS_PER_LEVEL,!owned,eMode,
+                pcKey,uLength,uHash,pvValue,ppvOld,piResult);
+            if (newchild==NULL||newchild==child)
+            {
+                return newchild==NULL?NULL:poNode;
+            }
+            if (owned)
+            {
+                SymTable_entries(poNode)[index]=newchild;
+                if (!childowned)
+                    SymTable_releaseNode(child,uShift+BITS_PER_LEVEL);
+                return poNode;
+            }
+            result=SymTable_copyNode(poNode,uShift,0);
+            if (result==NULL)
+            {
+                SymTable_releaseNode(newchild,uShift+BITS_PER_LEVEL);
+                *piResult=ASSOC_FAILED;
+                return NULL;
+            }
+            SymTable_releaseNode(child,uShift+BITS_PER_LEVEL);
+            SymTable_entries(result)[index]=newchild;
+            return result;
+        }
+        index=SymTable_popcount(poNode->datamap&(bit-1));
+        if (poNode->datamap&bit)
+            leaf=(struct HamtLeaf*)SymTable_entries(poNode)[index];
+    }
+
+    if (leaf!=NULL&&SymTable_matches(leaf,pcKey,uLength,uHash))
+    {
+        if (eMode!=ASSOC_REPLACE)
+        {
+            return poNode;
+        }
+        *ppvOld=leaf->value;
+        if (owned&&SymTable_isOwned(leaf,0))
+        {
+            leaf->value=(void*)pvValue;
+            *piResult=ASSOC_REPLACED;
+            return poNode;
+        }
+        newleaf=SymTable_newLeaf(pcKey,uLength,uHash,pvValue);
+        if (newleaf==NULL)
+        {
+            *piResult=ASSOC_FAILED;
+            return NULL;
+        }
+        result=owned?poNode:SymTable_copyNode(poNode,uShift,0);
+        if (result==NULL)
+        {
+            free(newleaf);
+            *piResult=ASSOC_FAILED;
+            return NULL;
+        }
+        SymTable_entries(result)[index]=newleaf;
+        SymTable_releaseLeaf(leaf);
+        *piResult=ASSOC_REPLACED;
+        return result;
+    }
+    if (eMode==ASSOC_REPLACE)
+    {
+        return poNode;
+    }
+
+    newleaf=SymTable_newLeaf(pcKey,uLength,uHash,pvValue);
+    if (newleaf==NULL)
+    {
+        *piResult=ASSOC_FAILED;
+        return NULL;
+    }
+
+    if (leaf!=NULL)
+    {
+        struct HamtNode *below;
+        size_t slot;
+
+        /* Another key has the slot: both move into a deeper node,
+           which takes the slot over. The number of entries stays the
+           same. */
+        result=owned?poNode:SymTable_copyNode(poNode,uShift,0);
+        if (result==NULL)
+        {
+            free(newleaf);
+            *piResult=ASSOC_FAILED;
+            return NULL;
+        }
+        below=SymTable_pair(leaf,newleaf,uShift+BITS_PER_LEVEL);
+        if (below==NULL)
+        {
+            if (result!=poNode)
+                SymTable_releaseNode(result,uShift);
+            free(newleaf);
+            *piResult=ASSOC_FAILED;
+            return NULL;
+        }
+        /* The copy's reference to the leaf is now below's. */
+        result->datamap&=~bit;
+        result->nodemap|=bit;
+        slot=leaves-1+SymTable_popcount(result->nodemap&(bit-1));
+        memmove(&SymTable_entries(result)[index],&SymTable_entries(result)[index+1],
+            (slot-index)*sizeof(void*));
+        SymTable_entries(result)[slot]=below;
+        *piResult=ASSOC_ADDED;
+        return result;
+    }
+
+    /* The slot is free, or this is a collision node: the node grows by
+       one entry. */
+    result=SymTable_newNode(leaves+nodes+1);
+    if (result==NULL)
+    {
+        free(newleaf);
+        *piResult=ASSOC_FAILED;
+        return NULL;
+    }
+    if (uShift>=HASH_BITS)
+    {
+        index=leaves;
+        result->datamap=poNode->datamap+1;
+    }
+    else
+    {
+        result->datamap=poNode->datamap|bit;
+    }
+    result->nodemap=poNode->nodemap;
+    memcpy(SymTable_entries(result),SymTable_entries(poNode),index*sizeof(void*));
+    SymTable_entries(result)[index]=newleaf;
+    memcpy(&SymTable_entries(result)[index+1],&SymTable_entries(poNode)[index],
+        (leaves+nodes-index)*sizeof(void*));
+    if (owned)
+    {
+        free(poNode);
+    }
+    else
+    {
+        for (index = 0; index < leaves+nodes+1; index++)
+            if (SymTable_entries(result)[index]!=newleaf)
+                SymTable_retain(SymTable_entries(result)[index]);
+    }
+    *piResult=ASSOC_ADDED;
+    return result;
+}
+
+/* Remove the binding of the uLength bytes at pcKey, whose hash is
+   uHash, from the trie poNode at shift uShift, storing its value in
+   *ppvValue. Sets *piResult and returns the node that should take
+   poNode's place as SymTable_assoc does, with ASSOC_ADDED meaning
+   that the binding was removed. */
+static struct HamtNode *SymTable_dissoc(struct HamtNode *poNode,
+    size_t uShift, int iShared, const char *pcKey, size_t uLength,
+    size_t uHash, void **ppvValue, int *piResult) {
+    int owned=SymTable_isOwned(poNode,iShared);
+    size_t leaves=SymTable_leafCount(poNode,uShift);
+    size_t nodes=SymTable_nodeCount(poNode);
+    struct HamtLeaf *leaf;
+    struct HamtNode *result;
+    unsigned long bit=0;
+    size_t index;
+
+    *piResult=ASSOC_UNCHANGED;
+
+    if (uShift>=HASH_BITS)
+    {
+        for (index = 0; index < leaves; index++)
+            if (SymTable_matches((struct HamtLeaf*)SymTable_entries(poNode)[index],
+                pcKey,uLength,uHash))
+                break;
+        if (index==leaves)
+        {
+            return poNode;
+        }
+    }
+    else
+    {
+        bit=SymTable_bit(uHash,uShift);
+        if (poNode->nodemap&bit)
+        {
+            struct HamtNode *child;
+            struct HamtNode *newchild;
+            size_t slot;
+            int childowned;
+
+            slot=leaves+SymTable_popcount(poNode->nodemap&(bit-1));
+            child=(struct HamtNode*)SymTable_entries(poNode)[slot];
+            childowned=owned&&SymTable_isOwned(child,0);
+            newchild=SymTable_dissoc(child,uShift+BITS_PER_LEVEL,!owned,
+                pcKey,uLength,uHash,ppvValue,piResult);
+            if (newchild==NULL||*piResult!=ASSOC_ADDED)
+            {
+                return newchild==NULL?NULL:poNode;
+            }
+
+            if (SymTable_leafCount(newchild,uShift+BITS_PER_LEVEL)!=1||
+                SymTable_nodeCount(newchild)!=0)
+            {
+                if (newchild==child)
+                {
+                    return poNode;
+                }
+                result=owned?poNode:SymTable_copyNode(poNode,uShift,0);
+                if (result==NULL)
+                {
+                    SymTable_releaseNode(newchild,uShift+BITS_PER_LEVEL);
+                    *piResult=ASSOC_FAILED;
+                    return NULL;
+                }
+                SymTable_entries(result)[slot]=newchild;
+                if (result!=poNode||!childowned)
+                    SymTable_releaseNode(child,uShift+BITS_PER_LEVEL);
+                return result;
+            }
+
+            /* The deeper node is down to one leaf, which moves up into
+               this node's slot so that the trie stays as shallow as it
+               can be. newchild is this call's alone, so its reference
+               to the leaf is taken over and its shell freed. */
+            result=owned?poNode:SymTable_copyNode(poNode,uShift,0);
+            if (result==NULL)
+            {
+                SymTable_releaseNode(newchild,uShift+BITS_PER_LEVEL);
+                *piResult=ASSOC_FAILED;
+                return NULL;
+            }
+            leaf=(struct HamtLeaf*)SymTable_entries(newchild)[0];
+            free(newchild);
+            if (newchild!=child&&(result!=poNode||!childowned))
+                SymTable_releaseNode(child,uShift+BITS_PER_LEVEL);
+            index=SymTable_popcount(result->datamap&(bit-1));
+            memmove(&SymTable_entries(result)[index+1],&SymTable_entries(result)[index],
+                (slot-index)*sizeof(void*));
+            SymTable_entries(result)[index]=leaf;
+            result->datamap|=bit;
+            result->nodemap&=~bit;
+            return result;
+        }
+        if (!(poNode->datamap&bit))
+        {
+            return poNode;
+        }
+        index=SymTable_popcount(poNode->datamap&(bit-1));
+        if (!SymTable_matches((struct HamtLeaf*)SymTable_entries(poNode)[index],
+            pcKey,uLength,uHash))
+        {
+            return poNode;
+        }
+    }
+
+    leaf=(struct HamtLeaf*)SymTable_entries(poNode)[index];
+    *ppvValue=leaf->value;
+    if (owned)
+    {
+        result=poNode;
+        SymTable_releaseLeaf(leaf);
+    }
+    else
+    {
+        result=SymTable_copyNode(poNode,uShift,0);
+        if (result==NULL)
+        {
+            *piResult=ASSOC_FAILED;
+            return NULL;
+        }
+        SymTable_releaseLeaf(leaf);
+    }
+    memmove(&SymTable_entries(result)[index],&SymTable_entries(result)[index+1],
+        (leaves+nodes-index-1)*sizeof(void*));
+    if (uShift>=HASH_BITS)
+        result->datamap--;
+    else
+        result->datamap&=~bit;
+    *piResult=ASSOC_ADDED;
+    return result;
+}
+
+/* Return a new table with no bindings that hashes keys with pfHash, or
+   NULL if memory allocation fails. */
+static SymTable_T SymTable_create(SymTable_HashFunction pfHash) {
+    SymTable_T symtablenew;
+
+    symtablenew =(SymTable_T)malloc(sizeof(struct Stack));
+    if (symtablenew==NULL)
+    {
+        return NULL;
+    }
+
+    symtablenew->root=SymTable_newNode(0);
+    if (symtablenew->root==NULL)
+    {
+        free(symtablenew);
+        return NULL;
+    }
+    symtablenew->bindings=0;
+    symtablenew->hashfn=pfHash;
+    return symtablenew;
+}
+
+SymTable_T SymTable_new(void){
+    return SymTable_create(NULL);
+}
+
+SymTable_T SymTable_newWithHash(SymTable_HashFunction pfHash){
+    return SymTable_create(pfHash);
+}
+
+SymTable_T SymTable_snapshot(SymTable_T oSymTable){
+    SymTable_T snapshot;
+
+    assert(oSymTable!=NULL);
+
+    snapshot=(SymTable_T)malloc(sizeof(struct Stack));
+    if (snapshot==NULL)
+    {
+        return NULL;
+    }
+    SymTable_retain(oSymTable->root);
+    snapshot->root=oSymTable->root;
+    snapshot->bindings=oSymTable->bindings;
+    snapshot->hashfn=oSymTable->hashfn;
+    return snapshot;
+}
+
+void SymTable_free(SymTable_T oSymTable){
+
+    assert(oSymTable!=NULL);
+
+    SymTable_releaseNode(oSymTable->root,0);
+    free(oSymTable);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+
+    assert(oSymTable!=NULL);
+
+    return oSymTable->bindings;
+}
+
+/* Make poRoot, returned by SymTable_assoc or SymTable_dissoc for the
+   root of oSymTable, the new root. iOwned says whether the old root was
+   owned by oSymTable when the call began. */
+static void SymTable_setRoot(SymTable_T oSymTable, struct HamtNode *poRoot,
+    int iOwned) {
+    if (poRoot==NULL||poRoot==oSymTable->root)
+        return;
+    /* An owned root was freed when its entries moved; a shared one
+       still holds this table's reference. */
+    if (!iOwned)
+        SymTable_releaseNode(oSymTable->root,0);
+    oSymTable->root=poRoot;
+}
+
+/* Apply SymTable_assoc to the root of oSymTable, and return the result
+   it gave. */
+static int SymTable_update(SymTable_T oSymTable, enum AssocMode eMode,
+    const char *pcKey, const void *pvValue, void **ppvOld) {
+    struct HamtNode *root;
+    size_t length;
+    int owned;
+    int result;
+
+    length=strlen(pcKey);
+    owned=SymTable_isOwned(oSymTable->root,0);
+    root=SymTable_assoc(oSymTable->root,0,0,eMode,pcKey,length,
+        SymTable_hash(oSymTable,pcKey,length),pvValue,ppvOld,&result);
+    SymTable_setRoot(oSymTable,root,owned);
+    return result;
+}
+
+int SymTable_put(SymTable_T oSymTable, const char *pcKey, const void *pvValue){
+    void *unused;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    if (SymTable_update(oSymTable,ASSOC_ADD,pcKey,pvValue,&unused)!=ASSOC_ADDED)
+    {
+        return 0;
+    }
+    oSymTable->bindings++;
+    return 1;
+}
+
+void *SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue){
+    void *old;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    if (SymTable_update(oSymTable,ASSOC_REPLACE,pcKey,pvValue,&old)!=ASSOC_REPLACED)
+    {
+        return NULL;
+    }
+    return old;
+}
+
+/* Return the leaf of oSymTable with key pcKey, or NULL if there is
+   none. */
+static struct HamtLeaf *SymTable_find(SymTable_T oSymTable, const char *pcKey) {
+    struct HamtNode *node=oSymTable->root;
+    struct HamtLeaf *leaf;
+    size_t length=strlen(pcKey);
+    size_t hash=SymTable_hash(oSymTable,pcKey,length);
+    size_t shift;
+    size_t index;
+    unsigned long bit;
+
+    for (shift = 0; shift < HASH_BITS; shift += BITS_PER_LEVEL) {
+        bit=SymTable_bit(hash,shift);
+        if (node->datamap&bit)
+        {
+            leaf=(struct HamtLeaf*)SymTable_entries(node)[SymTable_popcount(node->datamap&(bit-1))];
+            return SymTable_matches(leaf,pcKey,length,hash)?leaf:NULL;
+        }
+        if (!(node->nodemap&bit))
+            return NULL;
+        node=(struct HamtNode*)SymTable_entries(node)[SymTable_popcount(node->datamap)+
+            SymTable_popcount(node->nodemap&(bit-1))];
+    }
+
+    for (index = 0; index < (size_t)node->datamap; index++) {
+        leaf=(struct HamtLeaf*)SymTable_entries(node)[index];
+        if (SymTable_matches(leaf,pcKey,length,hash))
+            return leaf;
+    }
+    return NULL;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    return SymTable_find(oSymTable,pcKey)!=NULL;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+    struct HamtLeaf *leaf;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    leaf=SymTable_find(oSymTable,pcKey);
+    if (leaf==NULL)
+    {
+        return NULL;
+    }
+    return leaf->value;
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+    struct HamtNode *root;
+    void *value;
+    size_t length;
+    int owned;
+    int result;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    length=strlen(pcKey);
+    owned=SymTable_isOwned(oSymTable->root,0);
+    root=SymTable_dissoc(oSymTable->root,0,0,pcKey,length,
+        SymTable_hash(oSymTable,pcKey,length),&value,&result);
+    SymTable_setRoot(oSymTable,root,owned);
+    /* If copying a shared node fails the binding stays, and the caller
+       sees the same NULL as for a missing key. */
+    if (result!=ASSOC_ADDED)
+    {
+        return NULL;
+    }
+    oSymTable->bindings--;
+    return value;
+}
+
+/* Apply *pfApply to every binding in the trie poNode at shift
+   uShift. */
+static void SymTable_walk(struct HamtNode *poNode, size_t uShift,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    size_t leaves=SymTable_leafCount(poNode,uShift);
+    struct HamtLeaf *leaf;
+    size_t index;
+
+    for (index = 0; index < leaves; index++) {
+        leaf=(struct HamtLeaf*)SymTable_entries(poNode)[index];
+        (*pfApply)(SymTable_key(leaf),leaf->value,(void*)pvExtra);
+    }
+    for (index = 0; index < SymTable_nodeCount(poNode); index++)
+        SymTable_walk((struct HamtNode*)SymTable_entries(poNode)[leaves+index],
+            uShift+BITS_PER_LEVEL,pfApply,pvExtra);
+}
+
+void SymTable_map(SymTable_T oSymTable,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra){
+
+    assert(oSymTable!=NULL);
+    assert(pfApply!=NULL);
+
+    SymTable_walk(oSymTable->root,0,pfApply,pvExtra);
+}
@@ -0,0 +1,28 @@
+/*--------------------------------------------------------------------*/
+/* symtablehamt.h                                                     */
+/* Author: Kevin Castro                                               */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLEHAMT_INCLUDED
+#define SYMTABLEHAMT_INCLUDED
+
+#include "symtable.h"
+
+/* The function below is provided by the persistent implementation,
+   whose tables share structure with their snapshots. A change to a
+   table copies only the nodes on the key's path that it still shares,
+   about log n of them, so many versions of a table can be kept for
+   little more than the memory their differences take. */
+
+/* Returns a snapshot of oSymTable: a new SymTable_T holding the same
+   bindings, made in constant time. Later changes to oSymTable are not
+   seen in the snapshot, and changes to the snapshot are not seen in
+   oSymTable, so a snapshot that is never changed is an immutable view
+   of oSymTable as it was. Each table and snapshot must be used by one
+   thread at a time, but different ones may be used by different
+   threads even though they share memory. Free the snapshot with
+   SymTable_free, in any order with respect to oSymTable. Returns NULL
+   if memory allocation fails. */
+SymTable_T SymTable_snapshot(SymTable_T oSymTable);
+
+#endif
@@ -3,53 +3,371 @@
 /* Author: Kevin Castro                                               */
 /*--------------------------------------------------------------------*/
 
+/* For mmap and the file functions SymTable_openMapped uses. */
+#define _POSIX_C_SOURCE 200112L
 
 #include <stdio.h>
 #include "symtable.h"
+#include "symtablemapped.h"
+#include "symtablefrozen.h"
+#include "slab.h"
+#include "hashfn.h"
 #include <assert.h>
+#include <limits.h>
 #include <stdlib.h> 
 #include <string.h>
 #include <stddef.h>
-
-/*different bucket sizes for  rsizing the hash table*/
-static const size_t auBucketCounts[] = {509, 1021,2039,4093,8191,16381,32749,65521};
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Number of buckets in a new SymTable. The bucket count is always a
+   power of two, so a bucket index is the low bits of the hash. */
+enum {INITIAL_BUCKETS = 512};
+
+/* Number of old buckets moved into the new bucket array by each put or
+   remove while the table is being resized. */
+enum {MIGRATE_BUCKETS = 16};
+
+/* Number of keys whose lookups are overlapped by the batch
+   operations. */
+enum {BATCH_WINDOW = 16};
+
+/* Hint that *p will be read soon, where the compiler supports it. */
+#ifdef __GNUC__
+#define SymTable_prefetch(p) __builtin_prefetch(p)
+#else
+#define SymTable_prefetch(p) ((void)(p))
+#endif
+
+/* Most threads SymTable_putBatch or SymTable_mapParallel runs. */
+enum {MAX_THREADS = 64};
+
+/* Fewest keys per thread SymTable_putBatch bothers starting a thread
+   for. Smaller batches are put serially. */
+enum {MIN_KEYS_PER_THREAD = 4096};
+
+/* Number of buckets a SymTable_mapParallel worker claims at a time. */
+enum {MAP_CHUNK = 256};
+
+/* Initial number of entries in the undo log and in the array of scope
+   starts. Both double when full. */
+enum {INITIAL_SCOPE_ENTRIES = 16};
+
+/* Most keys per bucket of the perfect hash that SymTable_freeze
+   builds. The bucket count is the power of 2 that puts between half
+   this many and this many keys in each. Each bucket costs one unsigned
+   int. */
+enum {FROZEN_LOAD = 5};
+
+/* Multiplier that spreads the displacements a bucket of the perfect
+   hash tries over the whole range of hashes. */
+#define FROZEN_STEP ((size_t)0x9E3779B9UL)
+
+/* Odd multiplier that carries every bit of a displaced hash into its
+   high half. */
+#define FROZEN_MULTIPLIER ((size_t)0xBF58476DUL)
+
+/* The table shrinks once its bindings fall below one per this many
+   buckets. It never shrinks below INITIAL_BUCKETS, or below the size
+   reserved with SymTable_newWithCapacity or SymTable_reserve. */
+enum {SHRINK_LOAD_DIVISOR = 8};
 
 /* Each item is stored in a HashTableNode.  HashTableNodes are linked to
-   form a list.  */
+   form a list. The bytes of the key, with their '\0', follow the node
+   in the same slab block; see SymTable_key. */
 struct HashTablenode{
-    /* The key*/
-    const char *string;
     /* The value*/
     void *value;
     /* The address of the next HashTablenode. */
     struct HashTablenode *next;
+    /* The full hash of the key, so resizing never rereads the key*/
+    size_t hash;
+    /* The length of the key, not counting the '\0'*/
+    size_t length;
+    /* One more than the index of the binding's undo log entry, or 0
+    for a binding of the outermost scope*/
+    size_t undoslot;
+    /* The binding of the same key from an outer scope that this one
+    hides, kept out of the chain until this one is gone*/
+    struct HashTablenode *shadow;
 };
 
-/*A stack is a node that points to the first HashTableNode* . */
+/*A stack is a node that points to the first HashTableNode* . While the
+table is being resized, the bindings are split between the old bucket
+array and the new one: old buckets below migrated have already been
+moved into hashbuckets, the rest are still in oldbuckets. */
 struct Stack {
-    /*Current size of the buckets in SymTable*/
-    size_t bucketnum;
+    /*Current number of buckets in SymTable, a power of two*/
+    size_t bucketcount;
     /*The address of the first HashTableNode* in the array*/
     struct HashTablenode **hashbuckets;
     /*Number of bindings in the Hash table*/
     size_t bindings;
+    /*Bucket array being migrated away from, or NULL if not resizing*/
+    struct HashTablenode **oldbuckets;
+    /*Number of buckets in oldbuckets*/
+    size_t oldcount;
+    /*Number of leading old buckets already moved into hashbuckets*/
+    size_t migrated;
+    /*Allocator for the nodes*/
+    Slab_T slab;
+    /*Caller's hash function, or NULL for HashFn_words*/
+    SymTable_HashFunction hashfn;
+    /*Bucket count the table never shrinks below*/
+    size_t minbuckets;
+    /*Number of scopes pushed and not yet popped*/
+    size_t depth;
+    /*Undo log: the nodes put by SymTable_putScoped, innermost scope
+    last, with NULL in place of any since removed*/
+    struct HashTablenode **undo;
+    size_t undocount;
+    size_t undocapacity;
+    /*For each pushed scope, the undo count when it was pushed*/
+    size_t *scopestarts;
+    size_t scopecapacity;
+    /*The file mapped by SymTable_openMapped, which serves every lookup,
+    or NULL for a table held in the buckets*/
+    const char *mapped;
+    size_t mappedsize;
+    /*For a table made by SymTable_freeze, a slot for each binding, NULL
+    otherwise. The first frozencount are the slots of the perfect hash;
+    the rest hold the bindings whose hash another key already has,
+    sorted by the slot of that key, which frozenhomes gives*/
+    struct FrozenSlot *frozenslots;
+    size_t frozencount;
+    size_t *frozenhomes;
+    /*The keys of the slots, in slot order, each with its '\0'; the
+    total size of the keys; and, if that is more than UINT_MAX, the
+    offset of each slot's key in place of the one in the slot*/
+    char *frozenkeys;
+    size_t frozenkeysize;
+    size_t *frozenoffsets;
+    /*The displacement of each bucket of the perfect hash*/
+    unsigned int *displacements;
+    size_t displacementcount;
+};
+
+/* A file written by SymTable_save starts with a MappedHeader. Then come
+   the start of each bucket's run of entries, bucketcount+1 size_ts with
+   the last one equal to bindings; the entries, grouped by bucket; the
+   keys, each with its '\0'; and the values, each aligned to
+   MAPPED_ALIGN. Keys are indexed under HashFn_words. */
+struct MappedHeader {
+    /*MAPPED_MAGIC*/
+    size_t magic;
+    /*Size of the whole file in bytes*/
+    size_t filesize;
+    size_t bindings;
+    /*Number of buckets, a power of two*/
+    size_t bucketcount;
+};
+
+/* One binding of a file written by SymTable_save. */
+struct MappedEntry {
+    /*The key's hash under HashFn_words*/
+    size_t hash;
+    /*The length of the key, not counting the '\0'*/
+    size_t length;
+    /*Offsets from the start of the file of the key and the value*/
+    size_t key;
+    size_t value;
+};
+
+/* One binding of a table made by SymTable_freeze. The key's length is
+   not kept: keys sit in slot order, so the next slot's key starts
+   right after this one's '\0'. */
+struct FrozenSlot {
+    /*SymTable_fingerprint of the key's hash, with FROZEN_SHARED set if
+    some binding that overflowed has this slot as its home*/
+    unsigned int check;
+    /*Offset of the key in the table's frozenkeys*/
+    unsigned int key;
+    void *value;
+};
+
+/* Bit of a frozen slot's check that marks it as the home of bindings
+   that overflowed. */
+enum {FROZEN_SHARED = 1};
+
+/* One binding of a table as SymTable_save and SymTable_freeze read it,
+   whichever way the table holds it. */
+struct Binding {
+    /*The key's hash under HashFn_words*/
+    size_t hash;
+    size_t length;
+    const char *key;
+    void *value;
 };
-/* Return a hash code for pcKey that is between 0 and uBucketCount-1,
-        inclusive. */
-static size_t SymTable_hash(const char *pcKey, size_t uBucketCount) {
-    const size_t HASH_MULTIPLIER = 65599;
-    size_t u;
-    size_t uHash = 0;
 
+/* First word of a file written by SymTable_save: "Sym" followed by the
+   width of a size_t. */
+#define MAPPED_MAGIC ((size_t)0x53796dUL << 8 | sizeof(size_t))
+
+/* Alignment of every value in a file written by SymTable_save. */
+enum {MAPPED_ALIGN = 16};
+
+/* Return the key stored inline after poNode. */
+static const char *SymTable_key(const struct HashTablenode *poNode) {
+    return (const char*)(poNode + 1);
+}
+
+/* Return the size of the slab block that holds a node with a key of
+   length uLength. */
+static size_t SymTable_nodeSize(size_t uLength) {
+    return sizeof(struct HashTablenode) + uLength + 1;
+}
+/* Return the hash code for the uLength bytes at pcKey under the hash
+   function pfHash, or under HashFn_words if pfHash is NULL. */
+static size_t SymTable_hashWith(SymTable_HashFunction pfHash,
+    const char *pcKey, size_t uLength) {
     assert(pcKey != NULL);
 
-    for (u = 0; pcKey[u] != '\0'; u++){
-    uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+    if (pfHash == NULL)
+    {
+        return HashFn_words(pcKey, uLength);
     }
-    return uHash % uBucketCount;
-}    
+    return HashFn_mix((*pfHash)(pcKey, uLength));
+}
 
-SymTable_T SymTable_new(void){
+/* Return the hash code oSymTable uses for the uLength bytes at pcKey.
+   Every bit of the result depends on every byte of the key, so any run
+   of low bits can serve as a bucket index. */
+static size_t SymTable_hash(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength) {
+    return SymTable_hashWith(oSymTable->hashfn, pcKey, uLength);
+}
+
+/* Return the index of the bucket for a key with hash uHash in a table
+   with uBucketCount buckets. */
+static size_t SymTable_bucket(size_t uHash, size_t uBucketCount) {
+    return uHash & (uBucketCount - 1);
+}
+
+/* Return uHash mixed with the displacement uDisplacement of its bucket
+   of a perfect hash. Keys of one bucket share the low bits of their
+   hashes, so their high bits are folded in; the multiply and fold are
+   cheap enough to stay inline on every lookup. */
+static size_t SymTable_frozenMix(size_t uHash, unsigned int uDisplacement) {
+    uHash=(uHash^uDisplacement*FROZEN_STEP)*FROZEN_MULTIPLIER;
+    return uHash^uHash>>(CHAR_BIT*sizeof(size_t)/2);
+}
+
+/* Return the slot of the frozen table oSymTable, which must have
+   bindings, that the perfect hash sends a key with hash uHash to: the
+   key's bucket gives a displacement, which is mixed into the hash. */
+static size_t SymTable_frozenSlot(SymTable_T oSymTable, size_t uHash) {
+    unsigned int displacement;
+
+    displacement=oSymTable->displacements[SymTable_bucket(uHash,
+        oSymTable->displacementcount)];
+    return SymTable_frozenMix(uHash,displacement)%oSymTable->frozencount;
+}
+
+/* Return the bits of uHash that a frozen slot keeps to turn away most
+   other keys without reading them: all of its bits folded into an
+   unsigned int, less FROZEN_SHARED. */
+static unsigned int SymTable_fingerprint(size_t uHash) {
+    uHash^=uHash>>(CHAR_BIT*sizeof(size_t)/2);
+    return (unsigned int)uHash&~(unsigned int)FROZEN_SHARED;
+}
+
+/* Return the offset in frozenkeys of the key of slot uIndex of the
+   frozen table oSymTable, or the size of frozenkeys if uIndex is the
+   number of bindings. */
+static size_t SymTable_frozenOffset(SymTable_T oSymTable, size_t uIndex) {
+    if (uIndex==oSymTable->bindings)
+    {
+        return oSymTable->frozenkeysize;
+    }
+    if (oSymTable->frozenoffsets!=NULL)
+    {
+        return oSymTable->frozenoffsets[uIndex];
+    }
+    return oSymTable->frozenslots[uIndex].key;
+}
+
+/* Return the length, not counting the '\0', of the key of slot uIndex
+   of the frozen table oSymTable. */
+static size_t SymTable_frozenLength(SymTable_T oSymTable, size_t uIndex) {
+    return SymTable_frozenOffset(oSymTable,uIndex+1)
+        -SymTable_frozenOffset(oSymTable,uIndex)-1;
+}
+
+/* Return the address of the head pointer of the chain that holds, or
+   would hold, a key with hash uHash in oSymTable. */
+static struct HashTablenode **SymTable_chain(SymTable_T oSymTable,
+    size_t uHash) {
+    if (oSymTable->oldbuckets!=NULL)
+    {
+        size_t oldnum=SymTable_bucket(uHash,oSymTable->oldcount);
+        if (oldnum>=oSymTable->migrated)
+        {
+            return &oSymTable->oldbuckets[oldnum];
+        }
+    }
+    return &oSymTable->hashbuckets[SymTable_bucket(uHash,oSymTable->bucketcount)];
+}
+
+/* Move up to uBuckets old buckets of oSymTable into the current bucket
+   array, relinking their nodes. Frees the old array once every old
+   bucket has been moved. */
+static void SymTable_migrate(SymTable_T oSymTable, size_t uBuckets) {
+    struct HashTablenode *currnode;
+    struct HashTablenode *nextnode;
+    struct HashTablenode **chain;
+    size_t hashnum;
+
+    assert(oSymTable!=NULL);
+
+    while (oSymTable->oldbuckets!=NULL&&uBuckets>0)
+    {
+        chain=&oSymTable->oldbuckets[oSymTable->migrated];
+        for (currnode=*chain; currnode!=NULL; currnode=nextnode){
+            nextnode=currnode->next;
+
+            hashnum=SymTable_bucket(currnode->hash,oSymTable->bucketcount);
+            currnode->next=oSymTable->hashbuckets[hashnum];
+            oSymTable->hashbuckets[hashnum]=currnode;
+        }
+        *chain=NULL;
+
+        oSymTable->migrated++;
+        uBuckets--;
+        if (oSymTable->migrated==oSymTable->oldcount)
+        {
+            free(oSymTable->oldbuckets);
+            oSymTable->oldbuckets=NULL;
+            oSymTable->oldcount=0;
+            oSymTable->migrated=0;
+        }
+    }
+}
+
+/* Return the smallest power of two that is at least uCapacity and at
+   least INITIAL_BUCKETS, which is the bucket count that holds
+   uCapacity bindings without growing. Returns 0 if there is no such
+   bucket count. */
+static size_t SymTable_bucketsFor(size_t uCapacity) {
+    size_t buckets=INITIAL_BUCKETS;
+
+    while (buckets<uCapacity)
+    {
+        if (buckets>(size_t)-1/2/sizeof(struct HashTablenode*))
+        {
+            return 0;
+        }
+        buckets*=2;
+    }
+    return buckets;
+}
+
+/* Return a new empty SymTable_T with uBuckets buckets that hashes keys
+   with pfHash. Returns NULL if memory allocation fails. */
+static SymTable_T SymTable_create(SymTable_HashFunction pfHash,
+    size_t uBuckets){
     SymTable_T symtablenew;
 
     symtablenew =(SymTable_T)malloc(sizeof(struct Stack));
@@ -59,36 +377,88 @@ SymTable_T SymTable_new(void){
         return NULL;
     }
 
-    symtablenew->hashbuckets=(struct HashTablenode**)calloc(auBucketCounts[0],sizeof(struct HashTablenode*));
+    symtablenew->hashbuckets=(struct HashTablenode**)calloc(uBuckets,sizeof(struct HashTablenode*));
 
     if (symtablenew->hashbuckets==NULL)
     {
+        free(symtablenew);
+        return NULL;
+    }
+
+    symtablenew->slab=Slab_new();
+    if (symtablenew->slab==NULL)
+    {
+        free(symtablenew->hashbuckets);
+        free(symtablenew);
         return NULL;
     }
     
+    symtablenew->hashfn=pfHash;
     symtablenew->bindings=0;
-    symtablenew->bucketnum=0;
+    symtablenew->bucketcount=uBuckets;
+    symtablenew->minbuckets=uBuckets;
+    symtablenew->oldbuckets=NULL;
+    symtablenew->oldcount=0;
+    symtablenew->migrated=0;
+    symtablenew->depth=0;
+    symtablenew->undo=NULL;
+    symtablenew->undocount=0;
+    symtablenew->undocapacity=0;
+    symtablenew->scopestarts=NULL;
+    symtablenew->scopecapacity=0;
+    symtablenew->mapped=NULL;
+    symtablenew->mappedsize=0;
+    symtablenew->frozenslots=NULL;
+    symtablenew->frozencount=0;
+    symtablenew->frozenhomes=NULL;
+    symtablenew->frozenkeys=NULL;
+    symtablenew->frozenkeysize=0;
+    symtablenew->frozenoffsets=NULL;
+    symtablenew->displacements=NULL;
+    symtablenew->displacementcount=0;
     return symtablenew;
 }
 
-void SymTable_free(SymTable_T oSymTable){
-    struct HashTablenode *currnode;
-    struct HashTablenode *nextnode;
-    size_t index;
+SymTable_T SymTable_new(void){
+    return SymTable_create(NULL,INITIAL_BUCKETS);
+}
+
+SymTable_T SymTable_newWithHash(SymTable_HashFunction pfHash){
+    return SymTable_create(pfHash,INITIAL_BUCKETS);
+}
+
+SymTable_T SymTable_newWithCapacity(size_t uCapacity){
+    size_t buckets=SymTable_bucketsFor(uCapacity);
+
+    if (buckets==0)
+    {
+        return NULL;
+    }
+    return SymTable_create(NULL,buckets);
+}
 
-    size_t size=auBucketCounts[oSymTable->bucketnum];
+void SymTable_free(SymTable_T oSymTable){
 
     assert(oSymTable!=NULL);
 
-    for (index = 0; index < size; index++) {
-    
-        for ( currnode=oSymTable->hashbuckets[index]; currnode!=NULL; currnode=nextnode){
-            nextnode=currnode->next;
-            free((void*)currnode->string);
-            free(currnode);
-        }
+    if (oSymTable->mapped!=NULL)
+    {
+        munmap((void*)oSymTable->mapped,oSymTable->mappedsize);
+        free(oSymTable);
+        return;
     }
+
+    /* Every node lives in the slab, so no chain needs to be walked. */
+    free(oSymTable->oldbuckets);
     free(oSymTable->hashbuckets);
+    free(oSymTable->undo);
+    free(oSymTable->scopestarts);
+    free(oSymTable->frozenslots);
+    free(oSymTable->frozenhomes);
+    free(oSymTable->frozenkeys);
+    free(oSymTable->frozenoffsets);
+    free(oSymTable->displacements);
+    Slab_free(oSymTable->slab);
     free(oSymTable);
 }
 
@@ -99,297 +469,2210 @@ size_t SymTable_getLength(SymTable_T oSymTable){
     return oSymTable->bindings;
 }
 
-/*Repositions and rehashes the current bindings in oSymtable given the
-current size of the buckets in SymTable, bnum. Returns a new SymTable_T.
-Returns oSymTable if memory allocation fails. 
+/*Starts resizing oSymTable to uNewSize buckets, a power of two. The
+current bucket array becomes the old array, whose chains are then moved
+over a few buckets at a time by SymTable_migrate. Leaves oSymTable
+unchanged if it is already resizing or if memory allocation fails. 
 */
-static SymTable_T SymTable_reposition(SymTable_T oSymTable,size_t bnum) {
-    SymTable_T newSymTable;
-    struct HashTablenode *new;
-    struct HashTablenode *currnode;
-    
-    size_t index;
-    size_t hashnum;
-    size_t oldsize;
-    size_t newsize;
+static void SymTable_reposition(SymTable_T oSymTable, size_t uNewSize) {
+    struct HashTablenode **newbuckets;
 
     assert(oSymTable!=NULL);
 
-    oldsize=auBucketCounts[bnum];
-    bnum++;
-    newsize=auBucketCounts[bnum];
-
-    
-    newSymTable=(SymTable_T)malloc(sizeof(struct Stack));
-    if (newSymTable==NULL)
+    if (oSymTable->oldbuckets!=NULL)
     {
-        return oSymTable;
+        return;
     }
-    
-    newSymTable->bucketnum=bnum;
-    newSymTable->bindings=oSymTable->bindings;
-
-    newSymTable->hashbuckets=(struct HashTablenode**)calloc(newsize,sizeof(struct HashTablenode*));
 
-    if (newSymTable->hashbuckets==NULL)
+    newbuckets=(struct HashTablenode**)calloc(uNewSize,sizeof(struct HashTablenode*));
+    if (newbuckets==NULL)
     {
-       return oSymTable;
+       return;
     }
 
-    for (index = 0; index < oldsize; index++) {
-        for ( currnode=oSymTable->hashbuckets[index]; currnode!=NULL; currnode=currnode->next){
-
-            hashnum=SymTable_hash(currnode->string,newsize);
-            new=(struct HashTablenode*)malloc(sizeof(struct HashTablenode));
-
-           if (new==NULL)
-           {
-              return oSymTable;
-           }
-           
-            new->next=newSymTable->hashbuckets[hashnum];
-            new->string=currnode->string;
-            new->value=currnode->value;
-
-            newSymTable->hashbuckets[hashnum]=new;
-            
-            free(currnode);
-        }
-     }
-    
-     
-    return newSymTable;
+    oSymTable->oldbuckets=oSymTable->hashbuckets;
+    oSymTable->oldcount=oSymTable->bucketcount;
+    oSymTable->migrated=0;
+    oSymTable->hashbuckets=newbuckets;
+    oSymTable->bucketcount=uNewSize;
 }
 
-int SymTable_put(SymTable_T oSymTable, const char *pcKey, const void *pvValue){
-    SymTable_T newSymTable;
-    struct HashTablenode *new;
-    struct HashTablenode *currnode;
-    size_t bnum;
-    size_t hashnum;
-    size_t maximumbuck=7;
-
-    assert(oSymTable!=NULL);  
-    assert(pcKey!=NULL);
-
-    bnum=oSymTable->bucketnum;
-    hashnum=SymTable_hash(pcKey,auBucketCounts[bnum]);
+int SymTable_reserve(SymTable_T oSymTable, size_t uCapacity){
+    size_t buckets;
 
-    currnode=oSymTable->hashbuckets[hashnum];
+    assert(oSymTable!=NULL);
+    assert(oSymTable->mapped==NULL);
+    assert(oSymTable->frozenslots==NULL);
 
+    buckets=SymTable_bucketsFor(uCapacity);
+    if (buckets==0)
+    {
+        return 0;
+    }
 
-    while (currnode!=NULL)
+    /* Resize all at once: the caller asked for the work up front so
+       that the puts that follow never pay for it. */
+    SymTable_migrate(oSymTable,(size_t)-1);
+    if (buckets>oSymTable->bucketcount)
     {
-        int cmp=strcmp(currnode->string,pcKey);
-        if (cmp==0)
+        SymTable_reposition(oSymTable,buckets);
+        SymTable_migrate(oSymTable,(size_t)-1);
+        if (oSymTable->bucketcount!=buckets)
         {
             return 0;
         }
-        currnode = currnode->next;
     }
+    if (buckets>oSymTable->minbuckets)
+        oSymTable->minbuckets=buckets;
+    return 1;
+}
 
-    new = (struct HashTablenode*)malloc(sizeof(struct HashTablenode));
-    if (new==NULL)
+/*Starts doubling the bucket count of oSymTable if the bindings
+outnumber the buckets, so the average chain is at most one node long.
+Growth stops only when a larger bucket array cannot be allocated. */
+static void SymTable_grow(SymTable_T oSymTable) {
+    size_t newsize;
+
+    assert(oSymTable!=NULL);
+
+    if (oSymTable->bindings<=oSymTable->bucketcount)
     {
-        return 0;
+        return;
     }
-    
-    oSymTable->bindings++;
 
-    if (oSymTable->bindings>auBucketCounts[bnum]&&bnum!=maximumbuck)
+    newsize=oSymTable->bucketcount*2;
+    if (newsize/2!=oSymTable->bucketcount||newsize>(size_t)-1/sizeof(struct HashTablenode*))
     {
-        newSymTable=SymTable_reposition(oSymTable,bnum);
-        free(oSymTable->hashbuckets);
-
-        oSymTable->hashbuckets=newSymTable->hashbuckets;
-        oSymTable->bucketnum=newSymTable->bucketnum;
-        free(newSymTable);
-        
+        return;
     }
-    
+    SymTable_reposition(oSymTable,newsize);
+}
+
+/*Starts halving the bucket count of oSymTable if fewer than one bucket
+in SHRINK_LOAD_DIVISOR holds a binding. The low-water mark sits well
+below the grow threshold, so a table that shrinks has to take on
+several times its bindings again before it grows back. */
+static void SymTable_shrink(SymTable_T oSymTable) {
+    assert(oSymTable!=NULL);
 
-    new->string=(const char*)malloc(strlen(pcKey)+1);
-    if (new->string==NULL)
+    if (oSymTable->bucketcount<=oSymTable->minbuckets||
+        oSymTable->bindings>=oSymTable->bucketcount/SHRINK_LOAD_DIVISOR)
     {
-       return 0;
+        return;
     }
-    
-    bnum=oSymTable->bucketnum;
-    hashnum=SymTable_hash(pcKey,auBucketCounts[bnum]);
-    
-    strcpy((char*)new->string,pcKey);
-    new->next=oSymTable->hashbuckets[hashnum];
-    new->value = (void*)pvValue;
-    oSymTable->hashbuckets[hashnum]=new;
-    
-    return 1;
+    SymTable_reposition(oSymTable,oSymTable->bucketcount/2);
 }
-/* STILL PUT THE NODE INSIDE
-THEY ACT THE SAME!*/
-
-void *SymTable_replace(SymTable_T oSymTable, const char *pcKey,
-const void *pvValue){
 
+/* Return the address of the link that points to the node holding
+   pcKey, whose hash is uHash and length is uLength, in oSymTable. If
+   there is no such node, return the address of the NULL link ending the
+   chain pcKey belongs to. Keys are compared by hash and length first so
+   that memcmp runs only on likely matches. */
+static struct HashTablenode **SymTable_find(SymTable_T oSymTable,
+    const char *pcKey, size_t uHash, size_t uLength) {
+    struct HashTablenode **link;
     struct HashTablenode *currnode;
-    size_t bnum;
-    size_t hashnum;
-    void *oldval;
-    
-    assert(oSymTable!=NULL);  
-    assert(pcKey!=NULL);
-
-    bnum=oSymTable->bucketnum;
-    hashnum=SymTable_hash(pcKey,auBucketCounts[bnum]);
 
-    currnode=oSymTable->hashbuckets[hashnum];
-
-    while (currnode!=NULL)
+    link=SymTable_chain(oSymTable,uHash);
+    for (currnode=*link; currnode!=NULL; currnode=*link)
     {
-        int cmp=strcmp(currnode->string,pcKey);
-        if (cmp==0)
+        if (currnode->hash==uHash&&currnode->length==uLength&&
+            memcmp(SymTable_key(currnode),pcKey,uLength)==0)
         {
-            oldval=currnode->value;
-            currnode->value=(void*)pvValue;
-            return oldval;
+            break;
         }
-
-        currnode = currnode->next;
+        link=&currnode->next;
     }
-    return NULL;
+    return link;
+}
 
-    
+/* Return the header of the file mapped for oSymTable. */
+static const struct MappedHeader *SymTable_header(SymTable_T oSymTable) {
+    return (const struct MappedHeader*)(const void*)oSymTable->mapped;
 }
 
-int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
-    struct HashTablenode *currnode;
-    size_t bnum;
-    size_t hashnum;
-    
-    assert(oSymTable!=NULL);  
-    assert(pcKey!=NULL);
+/* Return the bucket starts of the file mapped for oSymTable. */
+static const size_t *SymTable_mappedStarts(SymTable_T oSymTable) {
+    return (const size_t*)(const void*)(SymTable_header(oSymTable)+1);
+}
 
-    bnum=oSymTable->bucketnum;
-    hashnum=SymTable_hash(pcKey,auBucketCounts[bnum]);
+/* Return the entries of the file mapped for oSymTable. */
+static const struct MappedEntry *SymTable_mappedEntries(SymTable_T oSymTable) {
+    return (const struct MappedEntry*)(const void*)(SymTable_mappedStarts(oSymTable)
+        +SymTable_header(oSymTable)->bucketcount+1);
+}
 
-    currnode=oSymTable->hashbuckets[hashnum];
+/* Return the entry for the uLength bytes at pcKey, whose hash under
+   HashFn_words is uHash, in the file mapped for oSymTable, or NULL if
+   there is none. A bucket's entries sit side by side, so a lookup reads
+   one bucket start and then consecutive entries. */
+static const struct MappedEntry *SymTable_findMapped(SymTable_T oSymTable,
+    const char *pcKey, size_t uLength, size_t uHash) {
+    const size_t *starts=SymTable_mappedStarts(oSymTable);
+    const struct MappedEntry *entries=SymTable_mappedEntries(oSymTable);
+    size_t hashnum=SymTable_bucket(uHash,SymTable_header(oSymTable)->bucketcount);
+    size_t index;
 
-    while (currnode!=NULL)
-    {
-        int cmp=strcmp(currnode->string,pcKey);
-        if (cmp==0)
+    for (index = starts[hashnum]; index < starts[hashnum+1]; index++) {
+        if (entries[index].hash==uHash&&entries[index].length==uLength&&
+            memcmp(oSymTable->mapped+entries[index].key,pcKey,uLength)==0)
         {
-            return 1;
+            return &entries[index];
         }
+    }
+    return NULL;
+}
 
-        currnode = currnode->next;
+/* Return the value bound to the uLength bytes at pcKey, whose hash
+   under HashFn_words is uHash, in the file mapped for oSymTable, or
+   NULL if there is none. Sets *piFound to whether there is one if
+   piFound is not NULL. */
+static void *SymTable_getMapped(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, size_t uHash, int *piFound) {
+    const struct MappedEntry *entry;
+
+    entry=SymTable_findMapped(oSymTable,pcKey,uLength,uHash);
+    if (piFound!=NULL)
+        *piFound=(entry!=NULL);
+    if (entry==NULL)
+    {
+        return NULL;
     }
-    return 0;
+    return (void*)(oSymTable->mapped+entry->value);
 }
 
-void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
-    struct HashTablenode *currnode;
-    size_t bnum;
-    size_t hashnum;
+/* Apply *pfApply to every binding of the file mapped for oSymTable, as
+   SymTable_map does. */
+static void SymTable_mapMapped(SymTable_T oSymTable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    const struct MappedEntry *entries=SymTable_mappedEntries(oSymTable);
+    size_t index;
 
-    assert(oSymTable!=NULL);  
-    assert(pcKey!=NULL);
+    for (index = 0; index < oSymTable->bindings; index++)
+        (*pfApply)(oSymTable->mapped+entries[index].key,
+            (void*)(oSymTable->mapped+entries[index].value),(void*)pvExtra);
+}
 
-    bnum=oSymTable->bucketnum;
-    hashnum=SymTable_hash(pcKey,auBucketCounts[bnum]);
+/* Return 1 if slot uIndex of the frozen table oSymTable holds the
+   uLength bytes at pcKey, whose hash has the fingerprint uFingerprint,
+   and 0 otherwise. The key is read only if the fingerprints match. */
+static int SymTable_frozenMatches(SymTable_T oSymTable, size_t uIndex,
+    unsigned int uFingerprint, const char *pcKey, size_t uLength) {
+    return (oSymTable->frozenslots[uIndex].check&~(unsigned int)FROZEN_SHARED)==uFingerprint&&
+        SymTable_frozenLength(oSymTable,uIndex)==uLength&&
+        memcmp(oSymTable->frozenkeys+SymTable_frozenOffset(oSymTable,uIndex),
+            pcKey,uLength)==0;
+}
 
-    currnode=oSymTable->hashbuckets[hashnum];
+/* Return the slot of the frozen table oSymTable holding the uLength
+   bytes at pcKey, whose hash under HashFn_words is uHash, or NULL if
+   there is none. A lookup reads one displacement, one slot and, if the
+   fingerprints match, the slot's key. Only if the slot is marked as
+   the home of bindings that overflowed are they searched for, by
+   bisecting frozenhomes. */
+static const struct FrozenSlot *SymTable_findFrozen(SymTable_T oSymTable,
+    const char *pcKey, size_t uLength, size_t uHash) {
+    unsigned int fingerprint;
+    size_t home;
+    size_t low=0;
+    size_t high;
+    size_t middle;
+
+    if (oSymTable->frozencount==0)
+    {
+        return NULL;
+    }
+    fingerprint=SymTable_fingerprint(uHash);
+    home=SymTable_frozenSlot(oSymTable,uHash);
+    if (SymTable_frozenMatches(oSymTable,home,fingerprint,pcKey,uLength))
+    {
+        return &oSymTable->frozenslots[home];
+    }
+    if ((oSymTable->frozenslots[home].check&FROZEN_SHARED)==0)
+    {
+        return NULL;
+    }
 
-    while (currnode!=NULL)
+    high=oSymTable->bindings-oSymTable->frozencount;
+    while (low<high)
     {
-        int cmp=strcmp(currnode->string,pcKey);
-        if (cmp==0)
+        middle=low+(high-low)/2;
+        if (oSymTable->frozenhomes[middle]<home)
+            low=middle+1;
+        else
+            high=middle;
+    }
+    for (; low < oSymTable->bindings-oSymTable->frozencount&&
+        oSymTable->frozenhomes[low]==home; low++)
+        if (SymTable_frozenMatches(oSymTable,oSymTable->frozencount+low,
+            fingerprint,pcKey,uLength))
         {
-            return currnode->value;
+            return &oSymTable->frozenslots[oSymTable->frozencount+low];
         }
-        currnode = currnode->next;
-    }
-
     return NULL;
 }
 
-void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
-    struct HashTablenode *currnode;
-    struct HashTablenode *formernode;
-    void *returni;
-    int cmp;
-    size_t bnum;
-    size_t hashnum;
-
-    assert(oSymTable!=NULL);
-    assert(pcKey!=NULL);
+/* Return 1 if oSymTable is a mapped or a frozen table, whose keys are
+   indexed under HashFn_words and are looked up by SymTable_getIndexed,
+   and 0 otherwise. */
+static int SymTable_isIndexed(SymTable_T oSymTable) {
+    return oSymTable->mapped!=NULL||oSymTable->frozenslots!=NULL;
+}
 
-    bnum=oSymTable->bucketnum;
-    hashnum=SymTable_hash(pcKey,auBucketCounts[bnum]);
+/* Return the value bound to the uLength bytes at pcKey, whose hash
+   under HashFn_words is uHash, in the mapped or frozen table oSymTable,
+   or NULL if there is none. Sets *piFound to whether there is one if
+   piFound is not NULL. */
+static void *SymTable_getIndexed(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, size_t uHash, int *piFound) {
+    const struct FrozenSlot *slot;
 
-    formernode=oSymTable->hashbuckets[hashnum];
-    if(formernode==NULL){
+    if (oSymTable->mapped!=NULL)
+    {
+        return SymTable_getMapped(oSymTable,pcKey,uLength,uHash,piFound);
+    }
+    slot=SymTable_findFrozen(oSymTable,pcKey,uLength,uHash);
+    if (piFound!=NULL)
+        *piFound=(slot!=NULL);
+    if (slot==NULL)
+    {
         return NULL;
     }
+    return slot->value;
+}
+
+int SymTable_put(SymTable_T oSymTable, const char *pcKey, const void *pvValue){
+    assert(pcKey!=NULL);
+    return SymTable_putn(oSymTable,pcKey,strlen(pcKey),pvValue);
+}
 
-    currnode = formernode->next;
+/* Fill in poNode as a binding of the uLength bytes at pcKey, whose hash
+   is uHash, to pvValue and push it onto the chain whose head pointer is
+   at ppoChain. */
+static void SymTable_link(struct HashTablenode *poNode,
+    struct HashTablenode **ppoChain, const char *pcKey, size_t uLength,
+    size_t uHash, const void *pvValue){
+    memcpy((char*)SymTable_key(poNode),pcKey,uLength);
+    ((char*)SymTable_key(poNode))[uLength]='\0';
+    poNode->hash=uHash;
+    poNode->length=uLength;
+    poNode->next=*ppoChain;
+    poNode->value=(void*)pvValue;
+    poNode->undoslot=0;
+    poNode->shadow=NULL;
+    *ppoChain=poNode;
+}
 
-    cmp=strcmp(formernode->string,pcKey);
+/* Add a new node binding the uLength bytes at pcKey, whose hash is
+   uHash, to pvValue in oSymTable, which must not already contain the
+   key. Returns the node, or NULL if memory allocation fails. */
+static struct HashTablenode *SymTable_addNode(SymTable_T oSymTable,
+    const char *pcKey, size_t uLength, size_t uHash, const void *pvValue){
+    struct HashTablenode *new;
+    struct HashTablenode **chain;
 
-    if (cmp==0)
+    new = (struct HashTablenode*)Slab_alloc(oSymTable->slab,SymTable_nodeSize(uLength));
+    if (new==NULL)
     {
-        oSymTable->bindings--;
-        returni=formernode->value;
-        free((void*)formernode->string);
-        free(formernode);
-        
-        oSymTable->hashbuckets[hashnum]=currnode;
-        
-        return returni;
-    }
-    else{
-        while (currnode!=NULL)
-        {
-            cmp=strcmp(currnode->string,pcKey);
-            if (cmp==0)
-            {
-                oSymTable->bindings--;
-                returni=currnode->value;
-        
-                formernode->next=currnode->next;
-                free((void*)currnode->string);
-                
-                free(currnode);
-
-                return returni;
-            }
-            currnode = currnode->next;
-            formernode=formernode->next;
-        }
+        return NULL;
     }
-    return NULL;
+    
+    oSymTable->bindings++;
 
+    SymTable_grow(oSymTable);
+    
+    chain=SymTable_chain(oSymTable,uHash);
+    SymTable_link(new,chain,pcKey,uLength,uHash,pvValue);
+    
+    return new;
 }
 
-void SymTable_map(SymTable_T oSymTable,
-void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
-const void *pvExtra) {
+/* Add a binding of the uLength bytes at pcKey, whose hash is uHash, to
+   pvValue in oSymTable, as SymTable_putn does. */
+static int SymTable_insert(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, size_t uHash, const void *pvValue){
 
-    size_t size=auBucketCounts[oSymTable->bucketnum];
-    struct HashTablenode *currnode;
-    size_t index;
+    assert(oSymTable!=NULL);  
+    assert(oSymTable->mapped==NULL);
+    assert(oSymTable->frozenslots==NULL);
+    assert(pcKey!=NULL);
 
-    assert(oSymTable!=NULL);
-    assert(pfApply!=NULL);
+    SymTable_migrate(oSymTable,MIGRATE_BUCKETS);
+
+    if (*SymTable_find(oSymTable,pcKey,uHash,uLength)!=NULL)
+    {
+        return 0;
+    }
 
+    return SymTable_addNode(oSymTable,pcKey,uLength,uHash,pvValue)!=NULL;
+}
+
+int SymTable_putn(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, const void *pvValue){
     assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
 
-    for (index = 0; index < size; index++) {
+    return SymTable_insert(oSymTable,pcKey,uLength,
+        SymTable_hash(oSymTable,pcKey,uLength),pvValue);
+}
 
-        for ( currnode=oSymTable->hashbuckets[index]; currnode!=NULL; currnode=currnode->next){
+void *SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue){
+    assert(pcKey!=NULL);
+    return SymTable_replacen(oSymTable,pcKey,strlen(pcKey),pvValue);
+}
 
-        (*pfApply)(currnode->string,(void*)currnode->value,(void*)pvExtra);
-        }
+void *SymTable_replacen(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, const void *pvValue){
+
+    struct HashTablenode *currnode;
+    size_t hash;
+    void *oldval;
+    
+    assert(oSymTable!=NULL);  
+    assert(oSymTable->mapped==NULL);
+    assert(oSymTable->frozenslots==NULL);
+    assert(pcKey!=NULL);
 
+    hash=SymTable_hash(oSymTable,pcKey,uLength);
+    currnode=*SymTable_find(oSymTable,pcKey,hash,uLength);
+    if (currnode==NULL)
+    {
+        return NULL;
     }
 
+    oldval=currnode->value;
+    currnode->value=(void*)pvValue;
+    return oldval;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+    assert(pcKey!=NULL);
+    return SymTable_containsn(oSymTable,pcKey,strlen(pcKey));
+}
+
+int SymTable_containsn(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength){
+    size_t hash;
+    int found;
+    
+    assert(oSymTable!=NULL);  
+    assert(pcKey!=NULL);
+
+    if (SymTable_isIndexed(oSymTable))
+    {
+        SymTable_getIndexed(oSymTable,pcKey,uLength,
+            HashFn_words(pcKey,uLength),&found);
+        return found;
+    }
+
+    hash=SymTable_hash(oSymTable,pcKey,uLength);
+    return *SymTable_find(oSymTable,pcKey,hash,uLength)!=NULL;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+    assert(pcKey!=NULL);
+    return SymTable_getn(oSymTable,pcKey,strlen(pcKey));
+}
+
+/* Return the value bound to the uLength bytes at pcKey, whose uHash is
+   uHash, in oSymTable, as SymTable_getn does. */
+static void *SymTable_lookup(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, size_t uHash){
+    struct HashTablenode *currnode;
+
+    assert(oSymTable!=NULL);  
+    assert(pcKey!=NULL);
+
+    currnode=*SymTable_find(oSymTable,pcKey,uHash,uLength);
+    if (currnode==NULL)
+    {
+        return NULL;
+    }
+    return currnode->value;
+}
+
+void *SymTable_getn(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength){
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    if (SymTable_isIndexed(oSymTable))
+    {
+        return SymTable_getIndexed(oSymTable,pcKey,uLength,
+            HashFn_words(pcKey,uLength),NULL);
+    }
+
+    return SymTable_lookup(oSymTable,pcKey,uLength,
+        SymTable_hash(oSymTable,pcKey,uLength));
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+    assert(pcKey!=NULL);
+    return SymTable_removen(oSymTable,pcKey,strlen(pcKey));
+}
+
+/* Take the node that *ppoLink points to out of its chain in oSymTable.
+   If the node hides a binding from an outer scope, that binding takes
+   its place. */
+static void SymTable_unlink(SymTable_T oSymTable,
+    struct HashTablenode **ppoLink){
+    struct HashTablenode *node=*ppoLink;
+
+    if (node->shadow!=NULL)
+    {
+        node->shadow->next=node->next;
+        *ppoLink=node->shadow;
+        return;
+    }
+    *ppoLink=node->next;
+    oSymTable->bindings--;
+}
+
+/* Replace the undo log entry of poNode, which SymTable_putScoped put
+   and which is being removed, by NULL so that SymTable_popScope skips
+   it. */
+static void SymTable_forget(SymTable_T oSymTable,
+    const struct HashTablenode *poNode){
+    assert(oSymTable->undo[poNode->undoslot-1]==poNode);
+    oSymTable->undo[poNode->undoslot-1]=NULL;
+}
+
+/* Return the depth of the scope poNode was put in: the number of
+   scopes pushed at or before the point its undo log entry was made.
+   The scope starts never decrease, so they are binary searched. */
+static size_t SymTable_depthOf(SymTable_T oSymTable,
+    const struct HashTablenode *poNode){
+    size_t low=0;
+    size_t high=oSymTable->depth;
+    size_t middle;
+
+    if (poNode->undoslot==0)
+    {
+        return 0;
+    }
+    while (low<high)
+    {
+        middle=low+(high-low)/2;
+        if (oSymTable->scopestarts[middle]<poNode->undoslot)
+            low=middle+1;
+        else
+            high=middle;
+    }
+    return low;
+}
+
+void *SymTable_removen(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength){
+    struct HashTablenode **link;
+    struct HashTablenode *currnode;
+    void *returni;
+    size_t hash;
+
+    assert(oSymTable!=NULL);
+    assert(oSymTable->mapped==NULL);
+    assert(oSymTable->frozenslots==NULL);
+    assert(pcKey!=NULL);
+
+    SymTable_migrate(oSymTable,MIGRATE_BUCKETS);
+
+    hash=SymTable_hash(oSymTable,pcKey,uLength);
+    link=SymTable_find(oSymTable,pcKey,hash,uLength);
+    currnode=*link;
+    if (currnode==NULL)
+    {
+        return NULL;
+    }
+
+    SymTable_unlink(oSymTable,link);
+    returni=currnode->value;
+    if (currnode->undoslot>0)
+        SymTable_forget(oSymTable,currnode);
+    Slab_release(oSymTable->slab,currnode,SymTable_nodeSize(currnode->length));
+
+    SymTable_shrink(oSymTable);
+
+    return returni;
+}
+
+void *SymTable_upsert(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue, int *piAdded){
+    struct HashTablenode *currnode;
+    void *oldval;
+    size_t length;
+    size_t hash;
+
+    assert(oSymTable!=NULL);
+    assert(oSymTable->mapped==NULL);
+    assert(oSymTable->frozenslots==NULL);
+    assert(pcKey!=NULL);
+
+    SymTable_migrate(oSymTable,MIGRATE_BUCKETS);
+
+    length=strlen(pcKey);
+    hash=SymTable_hash(oSymTable,pcKey,length);
+    currnode=*SymTable_find(oSymTable,pcKey,hash,length);
+    if (currnode!=NULL)
+    {
+        oldval=currnode->value;
+        currnode->value=(void*)pvValue;
+        if (piAdded!=NULL)
+            *piAdded=0;
+        return oldval;
+    }
+
+    currnode=SymTable_addNode(oSymTable,pcKey,length,hash,pvValue);
+    if (piAdded!=NULL)
+        *piAdded=(currnode!=NULL)?1:-1;
+    return NULL;
+}
+
+void *SymTable_getOrPut(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue, int *piAdded){
+    struct HashTablenode *currnode;
+    size_t length;
+    size_t hash;
+
+    assert(oSymTable!=NULL);
+    assert(oSymTable->mapped==NULL);
+    assert(oSymTable->frozenslots==NULL);
+    assert(pcKey!=NULL);
+
+    SymTable_migrate(oSymTable,MIGRATE_BUCKETS);
+
+    length=strlen(pcKey);
+    hash=SymTable_hash(oSymTable,pcKey,length);
+    currnode=*SymTable_find(oSymTable,pcKey,hash,length);
+    if (currnode!=NULL)
+    {
+        if (piAdded!=NULL)
+            *piAdded=0;
+        return currnode->value;
+    }
+
+    currnode=SymTable_addNode(oSymTable,pcKey,length,hash,pvValue);
+    if (piAdded!=NULL)
+        *piAdded=(currnode!=NULL)?1:-1;
+    return (currnode!=NULL)?(void*)pvValue:NULL;
+}
+
+/* Look up the uCount keys of apcKeys in oSymTable, storing each value
+   in apvValues if it is not NULL and whether each key was found in
+   aiFound if it is not NULL. Keys are handled BATCH_WINDOW at a time:
+   all of a window's keys are hashed and their buckets prefetched, then
+   their first nodes are prefetched, and only then are the chains
+   walked, so the cache misses of different keys overlap instead of
+   happening one after another. */
+static void SymTable_lookupBatch(SymTable_T oSymTable,
+    const char *const apcKeys[], size_t uCount, void *apvValues[],
+    int aiFound[]){
+    size_t lengths[BATCH_WINDOW];
+    size_t hashes[BATCH_WINDOW];
+    struct HashTablenode **chains[BATCH_WINDOW];
+    struct HashTablenode *currnode;
+    size_t start;
+    size_t window;
+    size_t index;
+
+    assert(oSymTable!=NULL);
+    assert(apcKeys!=NULL||uCount==0);
+
+    if (SymTable_isIndexed(oSymTable))
+    {
+        for (index = 0; index < uCount; index++) {
+            const char *key=apcKeys[index];
+            void *value;
+            int found;
+
+            assert(key!=NULL);
+            value=SymTable_getIndexed(oSymTable,key,strlen(key),
+                HashFn_words(key,strlen(key)),&found);
+            if (apvValues!=NULL)
+                apvValues[index]=value;
+            if (aiFound!=NULL)
+                aiFound[index]=found;
+        }
+        return;
+    }
+
+    for (start = 0; start < uCount; start += window) {
+        window=uCount-start;
+        if (window>BATCH_WINDOW)
+            window=BATCH_WINDOW;
+
+        for (index = 0; index < window; index++) {
+            const char *key=apcKeys[start+index];
+            assert(key!=NULL);
+            lengths[index]=strlen(key);
+            hashes[index]=SymTable_hash(oSymTable,key,lengths[index]);
+            chains[index]=SymTable_chain(oSymTable,hashes[index]);
+            SymTable_prefetch(chains[index]);
+        }
+
+        for (index = 0; index < window; index++) {
+            currnode=*chains[index];
+            if (currnode!=NULL)
+                SymTable_prefetch(currnode);
+        }
+
+        for (index = 0; index < window; index++) {
+            const char *key=apcKeys[start+index];
+            for (currnode=*chains[index]; currnode!=NULL; currnode=currnode->next) {
+                if (currnode->hash==hashes[index]&&currnode->length==lengths[index]&&
+                    memcmp(SymTable_key(currnode),key,lengths[index])==0)
+                {
+                    break;
+                }
+            }
+            if (apvValues!=NULL)
+                apvValues[start+index]=(currnode!=NULL)?currnode->value:NULL;
+            if (aiFound!=NULL)
+                aiFound[start+index]=(currnode!=NULL);
+        }
+    }
+}
+
+void SymTable_getBatch(SymTable_T oSymTable, const char *const apcKeys[],
+    size_t uCount, void *apvValues[]){
+    assert(apvValues!=NULL||uCount==0);
+
+    SymTable_lookupBatch(oSymTable,apcKeys,uCount,apvValues,NULL);
+}
+
+void SymTable_containsBatch(SymTable_T oSymTable,
+    const char *const apcKeys[], size_t uCount, int aiFound[]){
+    assert(aiFound!=NULL||uCount==0);
+
+    SymTable_lookupBatch(oSymTable,apcKeys,uCount,NULL,aiFound);
+}
+
+/* The shared state of one SymTable_putBatch call. The bucket array is
+   cut into nworkers partitions of partwidth consecutive buckets each,
+   and worker w owns every chain in partition w, so no two workers ever
+   touch the same chain. */
+struct BatchJob {
+    /*The table being filled; its bucket array does not change*/
+    SymTable_T table;
+    /*The caller's arrays*/
+    const char *const *keys;
+    const void *const *values;
+    int *results;
+    size_t count;
+    /*Length and hash of each key*/
+    size_t *lengths;
+    size_t *hashes;
+    /*Key indices grouped by partition, each group in input order*/
+    size_t *order;
+    /*counts[w*nworkers+p]: keys of worker w's slice in partition p,
+    turned into the slot of order that the first of them goes to*/
+    size_t *counts;
+    /*Start of each partition's group in order, plus a final count*/
+    size_t *partstart;
+    size_t nworkers;
+    size_t partwidth;
+};
+
+/* One worker thread of a SymTable_putBatch call. */
+struct BatchWorker {
+    struct BatchJob *job;
+    /*Index of this worker, which is also its partition*/
+    size_t index;
+    /*Private allocator for the nodes this worker adds*/
+    Slab_T slab;
+    /*Number of bindings this worker added*/
+    size_t added;
+};
+
+/* Return the first key index of the slice of psJob's keys that worker
+   uWorker hashes and partitions. */
+static size_t SymTable_sliceStart(const struct BatchJob *psJob,
+    size_t uWorker){
+    size_t quotient=psJob->count/psJob->nworkers;
+    size_t remainder=psJob->count%psJob->nworkers;
+
+    /* count*uWorker/nworkers, without overflowing count*uWorker. */
+    return quotient*uWorker+remainder*uWorker/psJob->nworkers;
+}
+
+/* Return the partition that a key with hash uHash belongs to. */
+static size_t SymTable_partition(const struct BatchJob *psJob,
+    size_t uHash){
+    return SymTable_bucket(uHash,psJob->table->bucketcount)/psJob->partwidth;
+}
+
+/* First phase of SymTable_putBatch: hash the worker's slice of the keys
+   and count how many fall in each partition. */
+static void *SymTable_hashSlice(void *pvWorker){
+    struct BatchWorker *worker=(struct BatchWorker*)pvWorker;
+    struct BatchJob *job=worker->job;
+    size_t *counts=&job->counts[worker->index*job->nworkers];
+    size_t end=SymTable_sliceStart(job,worker->index+1);
+    size_t index;
+
+    for (index = SymTable_sliceStart(job,worker->index); index < end; index++) {
+        assert(job->keys[index]!=NULL);
+        job->lengths[index]=strlen(job->keys[index]);
+        job->hashes[index]=SymTable_hash(job->table,job->keys[index],
+            job->lengths[index]);
+        counts[SymTable_partition(job,job->hashes[index])]++;
+    }
+    return NULL;
+}
+
+/* Second phase of SymTable_putBatch: copy the indices of the worker's
+   slice of the keys into the partition groups of order. */
+static void *SymTable_scatterSlice(void *pvWorker){
+    struct BatchWorker *worker=(struct BatchWorker*)pvWorker;
+    struct BatchJob *job=worker->job;
+    size_t *slots=&job->counts[worker->index*job->nworkers];
+    size_t end=SymTable_sliceStart(job,worker->index+1);
+    size_t index;
+
+    for (index = SymTable_sliceStart(job,worker->index); index < end; index++)
+        job->order[slots[SymTable_partition(job,job->hashes[index])]++]=index;
+    return NULL;
+}
+
+/* Third phase of SymTable_putBatch: add the keys of the worker's
+   partition, in input order, to the chains the worker owns. */
+static void *SymTable_insertPartition(void *pvWorker){
+    struct BatchWorker *worker=(struct BatchWorker*)pvWorker;
+    struct BatchJob *job=worker->job;
+    SymTable_T oSymTable=job->table;
+    struct HashTablenode *new;
+    struct HashTablenode **link;
+    size_t slot;
+    size_t index;
+
+    for (slot = job->partstart[worker->index]; slot < job->partstart[worker->index+1]; slot++) {
+        index=job->order[slot];
+        link=SymTable_find(oSymTable,job->keys[index],job->hashes[index],
+            job->lengths[index]);
+        if (*link!=NULL)
+        {
+            job->results[index]=0;
+            continue;
+        }
+        new=(struct HashTablenode*)Slab_alloc(worker->slab,
+            SymTable_nodeSize(job->lengths[index]));
+        if (new==NULL)
+        {
+            job->results[index]=-1;
+            continue;
+        }
+        SymTable_link(new,SymTable_chain(oSymTable,job->hashes[index]),
+            job->keys[index],job->lengths[index],job->hashes[index],
+            job->values[index]);
+        job->results[index]=1;
+        worker->added++;
+    }
+    return NULL;
+}
+
+/* Run pfWork on each of the uCount workers in the array pvWorkers,
+   whose elements are uSize bytes long, in a thread of its own, and
+   wait for all of them. aoThreads has room for uCount threads. A
+   worker whose thread cannot be started runs in the calling thread
+   instead. */
+static void SymTable_runWorkers(void *pvWorkers, size_t uSize,
+    size_t uCount, pthread_t *aoThreads, void *(*pfWork)(void *)){
+    char *workers=(char*)pvWorkers;
+    int *started;
+    size_t index;
+
+    started=(int*)calloc(uCount,sizeof(int));
+    for (index = 1; index < uCount; index++) {
+        if (started!=NULL&&
+            pthread_create(&aoThreads[index],NULL,pfWork,workers+index*uSize)==0)
+            started[index]=1;
+        else
+            (*pfWork)(workers+index*uSize);
+    }
+    (*pfWork)(workers);
+    for (index = 1; index < uCount; index++) {
+        if (started!=NULL&&started[index])
+            pthread_join(aoThreads[index],NULL);
+    }
+    free(started);
+}
+
+/* Put the uCount keys of apcKeys serially, as SymTable_putBatch does.
+   Returns the number of bindings added. */
+static size_t SymTable_putSerial(SymTable_T oSymTable,
+    const char *const apcKeys[], const void *const apvValues[],
+    size_t uCount, int aiResults[]){
+    size_t added=0;
+    size_t index;
+
+    for (index = 0; index < uCount; index++) {
+        SymTable_getOrPut(oSymTable,apcKeys[index],apvValues[index],
+            &aiResults[index]);
+        if (aiResults[index]==1)
+            added++;
+    }
+    return added;
+}
+
+size_t SymTable_putBatch(SymTable_T oSymTable, const char *const apcKeys[],
+    const void *const apvValues[], size_t uCount, size_t uThreads,
+    int aiResults[]){
+    struct BatchJob job;
+    struct BatchWorker *workers;
+    pthread_t *threads;
+    size_t buckets;
+    size_t index;
+    size_t added;
+
+    assert(oSymTable!=NULL);
+    assert(oSymTable->mapped==NULL);
+    assert(oSymTable->frozenslots==NULL);
+    assert(apcKeys!=NULL||uCount==0);
+    assert(apvValues!=NULL||uCount==0);
+    assert(aiResults!=NULL||uCount==0);
+
+    if (uThreads>MAX_THREADS)
+        uThreads=MAX_THREADS;
+    if (uThreads>uCount/MIN_KEYS_PER_THREAD)
+        uThreads=uCount/MIN_KEYS_PER_THREAD;
+    if (uThreads<=1)
+    {
+        return SymTable_putSerial(oSymTable,apcKeys,apvValues,uCount,aiResults);
+    }
+
+    /* Size the table for the whole batch before any worker starts, so
+       the bucket array stays put while the workers fill it. */
+    SymTable_migrate(oSymTable,(size_t)-1);
+    if (oSymTable->bindings<=(size_t)-1-uCount)
+    {
+        buckets=SymTable_bucketsFor(oSymTable->bindings+uCount);
+        if (buckets>oSymTable->bucketcount)
+        {
+            SymTable_reposition(oSymTable,buckets);
+            SymTable_migrate(oSymTable,(size_t)-1);
+        }
+    }
+
+    job.table=oSymTable;
+    job.keys=apcKeys;
+    job.values=apvValues;
+    job.results=aiResults;
+    job.count=uCount;
+    job.nworkers=uThreads;
+    job.partwidth=(oSymTable->bucketcount+uThreads-1)/uThreads;
+    job.lengths=(size_t*)malloc(uCount*sizeof(size_t));
+    job.hashes=(size_t*)malloc(uCount*sizeof(size_t));
+    job.order=(size_t*)malloc(uCount*sizeof(size_t));
+    job.counts=(size_t*)calloc(uThreads*uThreads,sizeof(size_t));
+    job.partstart=(size_t*)malloc((uThreads+1)*sizeof(size_t));
+    workers=(struct BatchWorker*)calloc(uThreads,sizeof(struct BatchWorker));
+    threads=(pthread_t*)malloc(uThreads*sizeof(pthread_t));
+
+    for (index = 0; workers!=NULL && index < uThreads; index++) {
+        workers[index].job=&job;
+        workers[index].index=index;
+        workers[index].slab=Slab_new();
+        if (workers[index].slab==NULL)
+            break;
+    }
+
+    if (job.lengths==NULL||job.hashes==NULL||job.order==NULL||
+        job.counts==NULL||job.partstart==NULL||workers==NULL||
+        threads==NULL||index<uThreads)
+    {
+        added=SymTable_putSerial(oSymTable,apcKeys,apvValues,uCount,aiResults);
+    }
+    else
+    {
+        SymTable_runWorkers(workers,sizeof(struct BatchWorker),uThreads,threads,
+            SymTable_hashSlice);
+
+        /* Turn the counts into the slot each worker's first key of each
+           partition goes to: partitions in order, and within one
+           partition the workers' slices in order. */
+        job.partstart[0]=0;
+        added=0;
+        for (index = 0; index < uThreads*uThreads; index++) {
+            size_t cell=index%uThreads*uThreads+index/uThreads;
+            size_t count=job.counts[cell];
+            job.counts[cell]=added;
+            added+=count;
+            if (index%uThreads==uThreads-1)
+                job.partstart[index/uThreads+1]=added;
+        }
+
+        SymTable_runWorkers(workers,sizeof(struct BatchWorker),uThreads,threads,
+            SymTable_scatterSlice);
+        SymTable_runWorkers(workers,sizeof(struct BatchWorker),uThreads,threads,
+            SymTable_insertPartition);
+
+        added=0;
+        for (index = 0; index < uThreads; index++)
+            added+=workers[index].added;
+        oSymTable->bindings+=added;
+    }
+
+    for (index = 0; workers!=NULL && index < uThreads; index++) {
+        if (workers[index].slab!=NULL)
+            Slab_absorb(oSymTable->slab,workers[index].slab);
+    }
+    free(threads);
+    free(workers);
+    free(job.partstart);
+    free(job.counts);
+    free(job.order);
+    free(job.hashes);
+    free(job.lengths);
+    return added;
+}
+
+void SymTable_prepareKey(struct SymTable_Key *psKey, const char *pcKey,
+    size_t uLength, SymTable_HashFunction pfHash){
+    assert(psKey!=NULL);
+    assert(pcKey!=NULL);
+
+    psKey->pcKey=pcKey;
+    psKey->uLength=uLength;
+    psKey->pfHash=pfHash;
+    psKey->uHash=SymTable_hashWith(pfHash,pcKey,uLength);
+}
+
+/* Return the hash oSymTable uses for the prepared key *psKey, which is
+   the stored hash unless *psKey was prepared for a different hash
+   function. */
+static size_t SymTable_preparedHash(SymTable_T oSymTable,
+    const struct SymTable_Key *psKey){
+    if (psKey->pfHash==oSymTable->hashfn)
+    {
+        return psKey->uHash;
+    }
+    return SymTable_hash(oSymTable,psKey->pcKey,psKey->uLength);
+}
+
+int SymTable_putPrepared(SymTable_T oSymTable,
+    const struct SymTable_Key *psKey, const void *pvValue){
+    assert(oSymTable!=NULL);
+    assert(psKey!=NULL);
+
+    return SymTable_insert(oSymTable,psKey->pcKey,psKey->uLength,
+        SymTable_preparedHash(oSymTable,psKey),pvValue);
+}
+
+void *SymTable_getPrepared(SymTable_T oSymTable,
+    const struct SymTable_Key *psKey){
+    assert(oSymTable!=NULL);
+    assert(psKey!=NULL);
+
+    if (SymTable_isIndexed(oSymTable))
+    {
+        return SymTable_getIndexed(oSymTable,psKey->pcKey,psKey->uLength,
+            SymTable_preparedHash(oSymTable,psKey),NULL);
+    }
+
+    return SymTable_lookup(oSymTable,psKey->pcKey,psKey->uLength,
+        SymTable_preparedHash(oSymTable,psKey));
+}
+
+/* Return the index of the first non-empty bucket among the uEnd-uStart
+   buckets of apoBuckets starting at uStart, or uEnd if they are all
+   empty. Buckets are tested four at a time, so a run of empty ones
+   costs little more than streaming past their pointers. */
+static size_t SymTable_nextOccupied(struct HashTablenode **apoBuckets,
+    size_t uStart, size_t uEnd) {
+    while (uStart+4<=uEnd&&
+           ((size_t)apoBuckets[uStart]|(size_t)apoBuckets[uStart+1]|
+            (size_t)apoBuckets[uStart+2]|(size_t)apoBuckets[uStart+3])==0)
+        uStart+=4;
+    while (uStart<uEnd&&apoBuckets[uStart]==NULL)
+        uStart++;
+    return uStart;
+}
+
+void SymTable_iterBegin(SymTable_T oSymTable, struct SymTable_Iter *psIter){
+    assert(oSymTable!=NULL);
+    assert(oSymTable->mapped==NULL);
+    assert(psIter!=NULL);
+
+    psIter->oSymTable=oSymTable;
+    psIter->pvNode=NULL;
+    psIter->uBucket=0;
+}
+
+int SymTable_iterNext(struct SymTable_Iter *psIter, const char **ppcKey,
+    void **ppvValue){
+    SymTable_T oSymTable;
+    struct HashTablenode *currnode;
+    size_t oldleft=0;
+    size_t bucket;
+
+    assert(psIter!=NULL);
+
+    oSymTable=psIter->oSymTable;
+    currnode=(struct HashTablenode*)psIter->pvNode;
+
+    /* A frozen table has no nodes: uBucket counts its slots. */
+    if (oSymTable->frozenslots!=NULL)
+    {
+        const struct FrozenSlot *slot;
+
+        if (psIter->uBucket>=oSymTable->bindings)
+        {
+            return 0;
+        }
+        slot=&oSymTable->frozenslots[psIter->uBucket];
+        if (ppcKey!=NULL)
+            *ppcKey=oSymTable->frozenkeys+SymTable_frozenOffset(oSymTable,psIter->uBucket);
+        psIter->uBucket++;
+        if (ppvValue!=NULL)
+            *ppvValue=slot->value;
+        return 1;
+    }
+
+    /* Buckets are numbered as for SymTable_mapParallel: the unmigrated
+       old buckets first, then the current ones. */
+    if (oSymTable->oldbuckets!=NULL)
+        oldleft=oSymTable->oldcount-oSymTable->migrated;
+
+    while (currnode==NULL)
+    {
+        bucket=psIter->uBucket;
+        if (bucket<oldleft)
+        {
+            bucket=SymTable_nextOccupied(oSymTable->oldbuckets,
+                oSymTable->migrated+bucket,oSymTable->oldcount)-oSymTable->migrated;
+            if (bucket<oldleft)
+                currnode=oSymTable->oldbuckets[oSymTable->migrated+bucket];
+        }
+        else if (bucket<oldleft+oSymTable->bucketcount)
+        {
+            bucket=SymTable_nextOccupied(oSymTable->hashbuckets,
+                bucket-oldleft,oSymTable->bucketcount)+oldleft;
+            if (bucket<oldleft+oSymTable->bucketcount)
+                currnode=oSymTable->hashbuckets[bucket-oldleft];
+        }
+        else
+        {
+            return 0;
+        }
+        psIter->uBucket=bucket+1;
+    }
+
+    psIter->pvNode=currnode->next;
+    if (ppcKey!=NULL)
+        *ppcKey=SymTable_key(currnode);
+    if (ppvValue!=NULL)
+        *ppvValue=currnode->value;
+    return 1;
+}
+
+void SymTable_iterEnd(struct SymTable_Iter *psIter){
+    assert(psIter!=NULL);
+
+    psIter->oSymTable=NULL;
+    psIter->pvNode=NULL;
+}
+
+void SymTable_map(SymTable_T oSymTable,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+
+    struct HashTablenode *currnode;
+    size_t index;
+    size_t size;
+
+    assert(oSymTable!=NULL);
+    assert(pfApply!=NULL);
+
+    if (oSymTable->mapped!=NULL)
+    {
+        SymTable_mapMapped(oSymTable,pfApply,pvExtra);
+        return;
+    }
+
+    if (oSymTable->frozenslots!=NULL)
+    {
+        for (index = 0; index < oSymTable->bindings; index++)
+            (*pfApply)(oSymTable->frozenkeys+SymTable_frozenOffset(oSymTable,index),
+                oSymTable->frozenslots[index].value,(void*)pvExtra);
+        return;
+    }
+
+    if (oSymTable->oldbuckets!=NULL)
+    {
+        for (index = oSymTable->migrated; index < oSymTable->oldcount; index++) {
+            for ( currnode=oSymTable->oldbuckets[index]; currnode!=NULL; currnode=currnode->next){
+            (*pfApply)(SymTable_key(currnode),(void*)currnode->value,(void*)pvExtra);
+            }
+        }
+    }
+
+    size=oSymTable->bucketcount;
+
+    for (index = 0; index < size; index++) {
+
+        for ( currnode=oSymTable->hashbuckets[index]; currnode!=NULL; currnode=currnode->next){
+
+        (*pfApply)(SymTable_key(currnode),(void*)currnode->value,(void*)pvExtra);
+        }
+
+    }
+
+}
+/* One worker thread of a SymTable_mapParallel call. Buckets are
+   numbered with the unmigrated old buckets first, then the current
+   ones. Each worker starts out owning an equal run of them, from next
+   to end, and claims MAP_CHUNK at a time from the front. A worker that
+   has finished its own run steals chunks from the others' runs the
+   same way, so one worker stuck on long chains does not hold up the
+   rest. */
+struct MapWorker {
+    SymTable_T table;
+    void (*apply)(const char *pcKey, void *pvValue, void *pvExtra);
+    /*This worker's extra pointer*/
+    void *extra;
+    /*Every worker of the call, and their number*/
+    struct MapWorker *workers;
+    size_t nworkers;
+    /*Index of this worker in workers*/
+    size_t index;
+    /*The first unclaimed bucket of this worker's run; claimed with an
+    atomic add, by the owner and thieves alike*/
+    size_t next;
+    /*The end of this worker's run*/
+    size_t end;
+#ifndef __GNUC__
+    /*Without GCC's atomic builtins, the lock shared by the call's
+    workers that guards every run's next*/
+    pthread_mutex_t *lock;
+#endif
+};
+
+/* Return the chain of the uBucket-th bucket of oSymTable, in the
+   numbering described at MapWorker. */
+static struct HashTablenode *SymTable_mapChain(SymTable_T oSymTable,
+    size_t uBucket) {
+    size_t oldleft=0;
+
+    if (oSymTable->oldbuckets!=NULL)
+    {
+        oldleft=oSymTable->oldcount-oSymTable->migrated;
+        if (uBucket<oldleft)
+        {
+            return oSymTable->oldbuckets[oSymTable->migrated+uBucket];
+        }
+    }
+    return oSymTable->hashbuckets[uBucket-oldleft];
+}
+
+/* Claim the next MAP_CHUNK buckets of poVictim's run and return the
+   first of them, which is at or past the end of the run if the run was
+   already used up. */
+static size_t SymTable_claimChunk(struct MapWorker *poVictim) {
+#ifdef __GNUC__
+    if (__atomic_load_n(&poVictim->next,__ATOMIC_RELAXED)>=poVictim->end)
+    {
+        return poVictim->end;
+    }
+    return __atomic_fetch_add(&poVictim->next,MAP_CHUNK,__ATOMIC_RELAXED);
+#else
+    size_t start;
+
+    pthread_mutex_lock(poVictim->lock);
+    start=poVictim->next;
+    if (start<poVictim->end)
+        poVictim->next+=MAP_CHUNK;
+    pthread_mutex_unlock(poVictim->lock);
+    return start;
+#endif
+}
+
+/* Claim the next chunk of poVictim's run for poWorker and apply the
+   map to it. Returns 0 if poVictim's run was already used up. */
+static int SymTable_mapChunk(struct MapWorker *poWorker,
+    struct MapWorker *poVictim) {
+    struct HashTablenode *currnode;
+    size_t start;
+    size_t end;
+    size_t bucket;
+
+    start=SymTable_claimChunk(poVictim);
+    if (start>=poVictim->end)
+    {
+        return 0;
+    }
+    end=poVictim->end-start<MAP_CHUNK?poVictim->end:start+MAP_CHUNK;
+
+    for (bucket = start; bucket < end; bucket++) {
+        for (currnode=SymTable_mapChain(poWorker->table,bucket); currnode!=NULL; currnode=currnode->next)
+            (*poWorker->apply)(SymTable_key(currnode),currnode->value,poWorker->extra);
+    }
+    return 1;
+}
+
+/* Apply the map to the worker's own run, then to whatever is left of
+   the other workers' runs. */
+static void *SymTable_mapWorker(void *pvWorker) {
+    struct MapWorker *worker=(struct MapWorker*)pvWorker;
+    size_t offset;
+
+    while (SymTable_mapChunk(worker,worker))
+        ;
+    for (offset = 1; offset < worker->nworkers; offset++) {
+        struct MapWorker *victim=
+            &worker->workers[(worker->index+offset)%worker->nworkers];
+        while (SymTable_mapChunk(worker,victim))
+            ;
+    }
+    return NULL;
+}
+
+void SymTable_mapParallel(SymTable_T oSymTable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *const apvExtra[], size_t uThreads) {
+    struct MapWorker *workers;
+    pthread_t *threads;
+    size_t total;
+    size_t index;
+#ifndef __GNUC__
+    pthread_mutex_t lock;
+#endif
+
+    assert(oSymTable!=NULL);
+    assert(pfApply!=NULL);
+    assert(apvExtra!=NULL);
+    assert(uThreads>0);
+
+    /* Frozen and mapped tables have no bucket chains to split up. */
+    if (oSymTable->frozenslots!=NULL||oSymTable->mapped!=NULL)
+    {
+        SymTable_map(oSymTable,pfApply,apvExtra[0]);
+        return;
+    }
+
+    total=oSymTable->bucketcount;
+    if (oSymTable->oldbuckets!=NULL)
+        total+=oSymTable->oldcount-oSymTable->migrated;
+
+    if (uThreads>MAX_THREADS)
+        uThreads=MAX_THREADS;
+    if (uThreads>total/MAP_CHUNK)
+        uThreads=total/MAP_CHUNK;
+    if (uThreads<=1)
+    {
+        SymTable_map(oSymTable,pfApply,apvExtra[0]);
+        return;
+    }
+
+    workers=(struct MapWorker*)malloc(uThreads*sizeof(struct MapWorker));
+    threads=(pthread_t*)malloc(uThreads*sizeof(pthread_t));
+    if (workers==NULL||threads==NULL)
+    {
+        free(workers);
+        free(threads);
+        SymTable_map(oSymTable,pfApply,apvExtra[0]);
+        return;
+    }
+
+    for (index = 0; index < uThreads; index++) {
+        workers[index].table=oSymTable;
+        workers[index].apply=pfApply;
+        workers[index].extra=(void*)apvExtra[index];
+        workers[index].workers=workers;
+        workers[index].nworkers=uThreads;
+        workers[index].index=index;
+        workers[index].next=total/uThreads*index;
+        workers[index].end=index+1==uThreads?total:total/uThreads*(index+1);
+#ifndef __GNUC__
+        workers[index].lock=&lock;
+#endif
+    }
+
+#ifndef __GNUC__
+    pthread_mutex_init(&lock,NULL);
+#endif
+    SymTable_runWorkers(workers,sizeof(struct MapWorker),uThreads,threads,
+        SymTable_mapWorker);
+#ifndef __GNUC__
+    pthread_mutex_destroy(&lock);
+#endif
+
+    free(threads);
+    free(workers);
+}
+
+/* Make room in *ppvArray, an array of *puCapacity elements of uSize
+   bytes, for one more than uCount elements, doubling its capacity if
+   it is full. Returns 1 on success, or 0 if memory allocation fails,
+   in which case the array is unchanged. */
+static int SymTable_makeRoom(void **ppvArray, size_t *puCapacity,
+    size_t uCount, size_t uSize){
+    size_t capacity;
+    void *grown;
+
+    if (uCount<*puCapacity)
+    {
+        return 1;
+    }
+    capacity=(*puCapacity==0)?INITIAL_SCOPE_ENTRIES:*puCapacity*2;
+    if (capacity<*puCapacity||capacity>(size_t)-1/uSize)
+    {
+        return 0;
+    }
+    grown=realloc(*ppvArray,capacity*uSize);
+    if (grown==NULL)
+    {
+        return 0;
+    }
+    *ppvArray=grown;
+    *puCapacity=capacity;
+    return 1;
+}
+
+int SymTable_pushScope(SymTable_T oSymTable){
+    assert(oSymTable!=NULL);
+    assert(oSymTable->mapped==NULL);
+    assert(oSymTable->frozenslots==NULL);
+
+    if (!SymTable_makeRoom((void**)&oSymTable->scopestarts,
+        &oSymTable->scopecapacity,oSymTable->depth,sizeof(size_t)))
+    {
+        return 0;
+    }
+    oSymTable->scopestarts[oSymTable->depth]=oSymTable->undocount;
+    oSymTable->depth++;
+    return 1;
+}
+
+int SymTable_popScope(SymTable_T oSymTable){
+    struct HashTablenode *node;
+    struct HashTablenode **link;
+    size_t start;
+
+    assert(oSymTable!=NULL);
+    assert(oSymTable->mapped==NULL);
+    assert(oSymTable->frozenslots==NULL);
+
+    if (oSymTable->depth==0)
+    {
+        return 0;
+    }
+    oSymTable->depth--;
+    start=oSymTable->scopestarts[oSymTable->depth];
+
+    /* Undo the scope's puts, latest first. Each node is found in its
+       chain by address, so the cost is one short chain walk per
+       binding in the scope. */
+    while (oSymTable->undocount>start)
+    {
+        node=oSymTable->undo[--oSymTable->undocount];
+        if (node==NULL)
+            continue;
+        for (link = SymTable_chain(oSymTable,node->hash); *link != node; link = &(*link)->next)
+            ;
+        SymTable_unlink(oSymTable,link);
+        Slab_release(oSymTable->slab,node,SymTable_nodeSize(node->length));
+    }
+
+    SymTable_shrink(oSymTable);
+    return 1;
+}
+
+int SymTable_putScoped(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue){
+    struct HashTablenode **link;
+    struct HashTablenode *outer;
+    struct HashTablenode *new;
+    size_t length;
+    size_t hash;
+
+    assert(oSymTable!=NULL);
+    assert(oSymTable->mapped==NULL);
+    assert(oSymTable->frozenslots==NULL);
+    assert(pcKey!=NULL);
+
+    if (oSymTable->depth==0)
+    {
+        return SymTable_put(oSymTable,pcKey,pvValue);
+    }
+
+    SymTable_migrate(oSymTable,MIGRATE_BUCKETS);
+
+    length=strlen(pcKey);
+    hash=SymTable_hash(oSymTable,pcKey,length);
+    link=SymTable_find(oSymTable,pcKey,hash,length);
+    outer=*link;
+    if (outer!=NULL&&
+        outer->undoslot>oSymTable->scopestarts[oSymTable->depth-1])
+    {
+        return 0;
+    }
+
+    if (!SymTable_makeRoom((void**)&oSymTable->undo,&oSymTable->undocapacity,
+        oSymTable->undocount,sizeof(struct HashTablenode*)))
+    {
+        return 0;
+    }
+    if (outer==NULL)
+    {
+        new=SymTable_addNode(oSymTable,pcKey,length,hash,pvValue);
+        if (new==NULL)
+        {
+            return 0;
+        }
+    }
+    else
+    {
+        /* The new node takes the outer binding's place in the chain,
+           and holds on to it until the scope is popped. */
+        new=(struct HashTablenode*)Slab_alloc(oSymTable->slab,SymTable_nodeSize(length));
+        if (new==NULL)
+        {
+            return 0;
+        }
+        SymTable_link(new,link,pcKey,length,hash,pvValue);
+        new->next=outer->next;
+        new->shadow=outer;
+        outer->next=NULL;
+    }
+    oSymTable->undo[oSymTable->undocount++]=new;
+    new->undoslot=oSymTable->undocount;
+    return 1;
+}
+
+void *SymTable_getScoped(SymTable_T oSymTable, const char *pcKey,
+    size_t *puDepth){
+    struct HashTablenode *currnode;
+    size_t length;
+    void *value;
+    int found;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    length=strlen(pcKey);
+
+    /* Every binding of a mapped or frozen table is in the outermost
+       scope. */
+    if (SymTable_isIndexed(oSymTable))
+    {
+        value=SymTable_getIndexed(oSymTable,pcKey,length,
+            HashFn_words(pcKey,length),&found);
+        if (found&&puDepth!=NULL)
+            *puDepth=0;
+        return value;
+    }
+
+    currnode=*SymTable_find(oSymTable,pcKey,
+        SymTable_hash(oSymTable,pcKey,length),length);
+    if (currnode==NULL)
+    {
+        return NULL;
+    }
+    if (puDepth!=NULL)
+        *puDepth=SymTable_depthOf(oSymTable,currnode);
+    return currnode->value;
+}
+
+/* Copy the chain starting at poNode into *ppoCopy, in the same order,
+   with nodes allocated from oSlab and put in the outermost scope. Each
+   node is copied with its key and hash in one block. Returns 1 on
+   success, or 0 if memory allocation fails, in which case *ppoCopy
+   holds as much of the chain as was copied. */
+static int SymTable_copyChain(Slab_T oSlab, const struct HashTablenode *poNode,
+    struct HashTablenode **ppoCopy) {
+    struct HashTablenode *copy;
+    size_t size;
+
+    for (; poNode!=NULL; poNode=poNode->next){
+        size=SymTable_nodeSize(poNode->length);
+        copy=(struct HashTablenode*)Slab_alloc(oSlab,size);
+        if (copy==NULL)
+        {
+            *ppoCopy=NULL;
+            return 0;
+        }
+        memcpy(copy,poNode,size);
+        copy->undoslot=0;
+        copy->shadow=NULL;
+        *ppoCopy=copy;
+        ppoCopy=&copy->next;
+    }
+    *ppoCopy=NULL;
+    return 1;
+}
+
+SymTable_T SymTable_clone(SymTable_T oSymTable){
+    SymTable_T clone;
+    size_t hashnum;
+
+    assert(oSymTable!=NULL);
+    assert(oSymTable->mapped==NULL);
+    assert(oSymTable->frozenslots==NULL);
+
+    clone=SymTable_create(oSymTable->hashfn,oSymTable->bucketcount);
+    if (clone==NULL)
+    {
+        return NULL;
+    }
+    clone->minbuckets=oSymTable->minbuckets;
+
+    /* A resize in progress is copied as it stands, so the clone goes on
+       migrating the same buckets. */
+    if (oSymTable->oldbuckets!=NULL)
+    {
+        clone->oldbuckets=(struct HashTablenode**)calloc(oSymTable->oldcount,
+            sizeof(struct HashTablenode*));
+        if (clone->oldbuckets==NULL)
+        {
+            SymTable_free(clone);
+            return NULL;
+        }
+        clone->oldcount=oSymTable->oldcount;
+        clone->migrated=oSymTable->migrated;
+        for (hashnum = oSymTable->migrated; hashnum < oSymTable->oldcount; hashnum++)
+            if (!SymTable_copyChain(clone->slab,oSymTable->oldbuckets[hashnum],
+                &clone->oldbuckets[hashnum]))
+            {
+                SymTable_free(clone);
+                return NULL;
+            }
+    }
+
+    for (hashnum = 0; hashnum < oSymTable->bucketcount; hashnum++)
+        if (!SymTable_copyChain(clone->slab,oSymTable->hashbuckets[hashnum],
+            &clone->hashbuckets[hashnum]))
+        {
+            SymTable_free(clone);
+            return NULL;
+        }
+
+    clone->bindings=oSymTable->bindings;
+    return clone;
+}
+
+/* Store the binding of poNode, from oSymTable, in *psBinding, with the
+   key's hash under HashFn_words, which is what mapped and frozen tables
+   index keys under. */
+static void SymTable_describe(SymTable_T oSymTable,
+    const struct HashTablenode *poNode, struct Binding *psBinding) {
+    psBinding->length=poNode->length;
+    psBinding->key=SymTable_key(poNode);
+    psBinding->value=poNode->value;
+    if (oSymTable->hashfn==NULL)
+        psBinding->hash=poNode->hash;
+    else
+        psBinding->hash=HashFn_words(psBinding->key,poNode->length);
+}
+
+/* Store every binding of oSymTable in asBindings, in the order
+   SymTable_map visits them. */
+static void SymTable_collect(SymTable_T oSymTable,
+    struct Binding *asBindings) {
+    struct HashTablenode *currnode;
+    size_t count=0;
+    size_t index;
+
+    /* A frozen table keeps only fingerprints, so its keys are hashed
+       again. */
+    if (oSymTable->frozenslots!=NULL)
+    {
+        for (index = 0; index < oSymTable->bindings; index++) {
+            asBindings[index].length=SymTable_frozenLength(oSymTable,index);
+            asBindings[index].key=oSymTable->frozenkeys+SymTable_frozenOffset(oSymTable,index);
+            asBindings[index].hash=HashFn_words(asBindings[index].key,asBindings[index].length);
+            asBindings[index].value=oSymTable->frozenslots[index].value;
+        }
+        return;
+    }
+    if (oSymTable->oldbuckets!=NULL)
+    {
+        for (index = oSymTable->migrated; index < oSymTable->oldcount; index++)
+            for (currnode=oSymTable->oldbuckets[index]; currnode!=NULL; currnode=currnode->next)
+                SymTable_describe(oSymTable,currnode,&asBindings[count++]);
+    }
+    for (index = 0; index < oSymTable->bucketcount; index++)
+        for (currnode=oSymTable->hashbuckets[index]; currnode!=NULL; currnode=currnode->next)
+            SymTable_describe(oSymTable,currnode,&asBindings[count++]);
+}
+
+/* Group uCount items, the i-th of which belongs to group auGroups[i],
+   below uGroups, with a counting sort. Stores the item indices in
+   auOrder, in increasing order of group and in their own order within a
+   group, and where each group's run of auOrder starts in auStarts,
+   which has room for uGroups+1 entries, the last of them uCount. */
+static void SymTable_groupBy(size_t *auGroups, size_t uCount,
+    size_t uGroups, size_t *auStarts, size_t *auOrder) {
+    size_t index;
+
+    for (index = 0; index <= uGroups; index++)
+        auStarts[index]=0;
+    for (index = 0; index < uCount; index++)
+        auStarts[auGroups[index]+1]++;
+    for (index = 0; index < uGroups; index++)
+        auStarts[index+1]+=auStarts[index];
+    /* Dropping each item into the next place of its group moves every
+       start up to the following group's, so they are moved back. */
+    for (index = 0; index < uCount; index++)
+        auOrder[auStarts[auGroups[index]]++]=index;
+    for (index = uGroups; index > 0; index--)
+        auStarts[index]=auStarts[index-1];
+    auStarts[0]=0;
+}
+
+/* Write zero bytes to psFile until *puOffset, the offset it is at, is
+   a multiple of MAPPED_ALIGN. Returns 1 on success, or 0 if writing
+   fails. */
+static int SymTable_pad(FILE *psFile, size_t *puOffset) {
+    static const char zeros[MAPPED_ALIGN];
+    size_t gap=(MAPPED_ALIGN-*puOffset%MAPPED_ALIGN)%MAPPED_ALIGN;
+
+    if (fwrite(zeros,1,gap,psFile)!=gap)
+    {
+        return 0;
+    }
+    *puOffset+=gap;
+    return 1;
+}
+
+/* Write the file SymTable_save describes for oSymTable to psFile, with
+   the bindings of oSymTable in asBindings grouped by bucket, the bucket
+   starts in auStarts, and room for the entries in asEntries. Returns 1
+   on success, or 0 if writing fails. */
+static int SymTable_writeMapped(SymTable_T oSymTable, FILE *psFile,
+    const struct Binding *asBindings, const size_t *auStarts,
+    struct MappedEntry *asEntries, struct MappedHeader *psHeader,
+    SymTable_ValueWriter pfWrite) {
+    size_t offset;
+    size_t index;
+    long position;
+
+    /* The header and entries are written again once the value offsets
+       are known. */
+    offset=sizeof(struct MappedHeader)+(psHeader->bucketcount+1)*sizeof(size_t)
+        +oSymTable->bindings*sizeof(struct MappedEntry);
+    for (index = 0; index < oSymTable->bindings; index++) {
+        asEntries[index].hash=asBindings[index].hash;
+        asEntries[index].length=asBindings[index].length;
+        asEntries[index].key=offset;
+        asEntries[index].value=0;
+        offset+=asBindings[index].length+1;
+    }
+    if (fwrite(psHeader,sizeof(struct MappedHeader),1,psFile)!=1||
+        fwrite(auStarts,sizeof(size_t),psHeader->bucketcount+1,psFile)!=psHeader->bucketcount+1||
+        fwrite(asEntries,sizeof(struct MappedEntry),oSymTable->bindings,psFile)!=oSymTable->bindings)
+    {
+        return 0;
+    }
+    for (index = 0; index < oSymTable->bindings; index++)
+        if (fwrite(asBindings[index].key,1,asBindings[index].length+1,psFile)
+            !=asBindings[index].length+1)
+        {
+            return 0;
+        }
+
+    for (index = 0; index < oSymTable->bindings; index++) {
+        if (!SymTable_pad(psFile,&offset))
+        {
+            return 0;
+        }
+        asEntries[index].value=offset;
+        if (!(*pfWrite)(asBindings[index].value,psFile))
+        {
+            return 0;
+        }
+        position=ftell(psFile);
+        if (position<0)
+        {
+            return 0;
+        }
+        offset=(size_t)position;
+    }
+
+    psHeader->filesize=offset;
+    if (fseek(psFile,0L,SEEK_SET)!=0||
+        fwrite(psHeader,sizeof(struct MappedHeader),1,psFile)!=1||
+        fseek(psFile,(long)(sizeof(struct MappedHeader)
+            +(psHeader->bucketcount+1)*sizeof(size_t)),SEEK_SET)!=0||
+        fwrite(asEntries,sizeof(struct MappedEntry),oSymTable->bindings,psFile)!=oSymTable->bindings)
+    {
+        return 0;
+    }
+    return 1;
+}
+
+int SymTable_save(SymTable_T oSymTable, const char *pcPath,
+    SymTable_ValueWriter pfWrite){
+    struct MappedHeader header;
+    struct Binding *bindings;
+    struct Binding *sorted;
+    struct MappedEntry *entries;
+    size_t *starts;
+    size_t *groups;
+    size_t *order;
+    size_t count;
+    size_t index;
+    FILE *file;
+    int success=0;
+
+    assert(oSymTable!=NULL);
+    assert(oSymTable->mapped==NULL);
+    assert(pcPath!=NULL);
+    assert(pfWrite!=NULL);
+
+    count=oSymTable->bindings;
+    header.magic=MAPPED_MAGIC;
+    header.filesize=0;
+    header.bindings=count;
+    header.bucketcount=SymTable_bucketsFor(count);
+    if (header.bucketcount==0||count>(size_t)-1/sizeof(struct MappedEntry))
+    {
+        return 0;
+    }
+
+    bindings=(struct Binding*)malloc((count+1)*sizeof(struct Binding));
+    sorted=(struct Binding*)malloc((count+1)*sizeof(struct Binding));
+    entries=(struct MappedEntry*)malloc((count+1)*sizeof(struct MappedEntry));
+    starts=(size_t*)malloc((header.bucketcount+1)*sizeof(size_t));
+    groups=(size_t*)malloc((count+1)*sizeof(size_t));
+    order=(size_t*)malloc((count+1)*sizeof(size_t));
+    if (bindings!=NULL&&sorted!=NULL&&entries!=NULL&&starts!=NULL&&
+        groups!=NULL&&order!=NULL)
+    {
+        SymTable_collect(oSymTable,bindings);
+        for (index = 0; index < count; index++)
+            groups[index]=SymTable_bucket(bindings[index].hash,header.bucketcount);
+        SymTable_groupBy(groups,count,header.bucketcount,starts,order);
+        for (index = 0; index < count; index++)
+            sorted[index]=bindings[order[index]];
+
+        file=fopen(pcPath,"wb");
+        if (file!=NULL)
+        {
+            success=SymTable_writeMapped(oSymTable,file,sorted,starts,entries,
+                &header,pfWrite);
+            if (fclose(file)!=0)
+                success=0;
+            if (!success)
+                remove(pcPath);
+        }
+    }
+
+    free(bindings);
+    free(sorted);
+    free(entries);
+    free(starts);
+    free(groups);
+    free(order);
+    return success;
+}
+
+/* Return 1 if the uSize bytes at pcMapping are laid out as a file
+   written by SymTable_save on this kind of machine, so that no lookup
+   or map reads outside them, and 0 otherwise: the header must match
+   the file, the bucket starts must rise from 0 to the number of
+   bindings, and each entry must sit in its hash's bucket with its key,
+   ending in '\0', and its value's start inside the file past the
+   entries. */
+static int SymTable_checkMapped(const char *pcMapping, size_t uSize) {
+    const struct MappedHeader *header=(const struct MappedHeader*)(const void*)pcMapping;
+    const size_t *starts=(const size_t*)(const void*)(header+1);
+    const struct MappedEntry *entries;
+    const struct MappedEntry *entry;
+    size_t data;
+    size_t hashnum;
+    size_t index;
+
+    if (header->magic!=MAPPED_MAGIC||header->filesize!=uSize||
+        header->bucketcount==0||(header->bucketcount&(header->bucketcount-1))!=0||
+        header->bucketcount>uSize/sizeof(size_t)||
+        header->bindings>uSize/sizeof(struct MappedEntry)||
+        sizeof(struct MappedHeader)+(header->bucketcount+1)*sizeof(size_t)
+            +header->bindings*sizeof(struct MappedEntry)>uSize)
+    {
+        return 0;
+    }
+    entries=(const struct MappedEntry*)(const void*)(starts+header->bucketcount+1);
+    data=(size_t)((const char*)(entries+header->bindings)-pcMapping);
+
+    if (starts[0]!=0||starts[header->bucketcount]!=header->bindings)
+    {
+        return 0;
+    }
+    for (hashnum = 0; hashnum < header->bucketcount; hashnum++) {
+        if (starts[hashnum]>starts[hashnum+1])
+        {
+            return 0;
+        }
+        for (index = starts[hashnum]; index < starts[hashnum+1]; index++) {
+            entry=&entries[index];
+            if (SymTable_bucket(entry->hash,header->bucketcount)!=hashnum||
+                entry->key<data||entry->key>=uSize||
+                entry->length>=uSize-entry->key||
+                pcMapping[entry->key+entry->length]!='\0'||
+                entry->value<data||entry->value>uSize||
+                entry->value%MAPPED_ALIGN!=0)
+            {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+SymTable_T SymTable_openMapped(const char *pcPath){
+    SymTable_T symtablenew;
+    const struct MappedHeader *header;
+    struct stat status;
+    void *mapping;
+    size_t size;
+    int descriptor;
+
+    assert(pcPath!=NULL);
+
+    descriptor=open(pcPath,O_RDONLY);
+    if (descriptor<0)
+    {
+        return NULL;
+    }
+    if (fstat(descriptor,&status)!=0||status.st_size<(off_t)sizeof(struct MappedHeader))
+    {
+        close(descriptor);
+        return NULL;
+    }
+    size=(size_t)status.st_size;
+    mapping=mmap(NULL,size,PROT_READ,MAP_PRIVATE,descriptor,0);
+    close(descriptor);
+    if (mapping==MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    if (!SymTable_checkMapped((const char*)mapping,size))
+    {
+        munmap(mapping,size);
+        return NULL;
+    }
+    header=(const struct MappedHeader*)mapping;
+
+    /* The buckets stay empty: every function allowed on the table
+       looks at the mapping instead. */
+    symtablenew=(SymTable_T)malloc(sizeof(struct Stack));
+    if (symtablenew==NULL)
+    {
+        munmap(mapping,size);
+        return NULL;
+    }
+    symtablenew->hashfn=NULL;
+    symtablenew->bindings=header->bindings;
+    symtablenew->hashbuckets=NULL;
+    symtablenew->bucketcount=0;
+    symtablenew->minbuckets=0;
+    symtablenew->oldbuckets=NULL;
+    symtablenew->oldcount=0;
+    symtablenew->migrated=0;
+    symtablenew->slab=NULL;
+    symtablenew->depth=0;
+    symtablenew->undo=NULL;
+    symtablenew->undocount=0;
+    symtablenew->undocapacity=0;
+    symtablenew->scopestarts=NULL;
+    symtablenew->scopecapacity=0;
+    symtablenew->mapped=(const char*)mapping;
+    symtablenew->mappedsize=size;
+    symtablenew->frozenslots=NULL;
+    symtablenew->frozencount=0;
+    symtablenew->frozenhomes=NULL;
+    symtablenew->frozenkeys=NULL;
+    symtablenew->frozenkeysize=0;
+    symtablenew->frozenoffsets=NULL;
+    symtablenew->displacements=NULL;
+    symtablenew->displacementcount=0;
+    return symtablenew;
+}
+
+/* Find a displacement for the uSize keys of one bucket of the perfect
+   hash under construction, the ones whose indices in asBindings are in
+   auMembers and whose hashes all differ, that sends each of them to a
+   slot of the uSlots whose bit in aulTaken is clear. Sets those bits,
+   stores the index of the binding each slot gets in auOwners, stores
+   the displacement in *puDisplacement, and returns 1. Returns 0 if no
+   displacement works, which distinct hashes make vanishingly unlikely.
+   The bitmap stays in cache while the last keys search a nearly full
+   table. */
+static int SymTable_placeBucket(size_t *auOwners, unsigned long *aulTaken,
+    size_t uSlots, const struct Binding *asBindings,
+    const size_t *auMembers, size_t uSize, unsigned int *puDisplacement) {
+    enum {BITS = CHAR_BIT*sizeof(unsigned long)};
+    unsigned int displacement;
+    size_t placed;
+    size_t slot;
+
+    for (displacement = 0; ; displacement++) {
+        for (placed = 0; placed < uSize; placed++) {
+            slot=SymTable_frozenMix(asBindings[auMembers[placed]].hash,displacement)%uSlots;
+            if (aulTaken[slot/BITS]&1UL<<slot%BITS)
+                break;
+            aulTaken[slot/BITS]|=1UL<<slot%BITS;
+        }
+        if (placed==uSize)
+        {
+            break;
+        }
+        while (placed>0)
+        {
+            placed--;
+            slot=SymTable_frozenMix(asBindings[auMembers[placed]].hash,displacement)%uSlots;
+            aulTaken[slot/BITS]&=~(1UL<<slot%BITS);
+        }
+        if (displacement==UINT_MAX)
+        {
+            return 0;
+        }
+    }
+
+    for (placed = 0; placed < uSize; placed++)
+        auOwners[SymTable_frozenMix(asBindings[auMembers[placed]].hash,displacement)%uSlots]=
+            auMembers[placed];
+    *puDisplacement=displacement;
+    return 1;
+}
+
+/* Build the perfect hash of the frozen table poFrozen for the uCount
+   bindings of asBindings: group the keys into buckets, and give each
+   bucket, the largest first, the first displacement that sends all of
+   its keys to free slots. The large buckets are placed while most slots
+   are free, and the single keys that come last can always find one.
+   A key whose hash an earlier key of its bucket already has cannot be
+   told apart from it by any displacement, so it is left out and will
+   overflow: its index in auTwins is that of the earlier key, while the
+   index of every other key is its own. Sets the frozencount of
+   poFrozen to the number of keys placed, and stores the index of the
+   binding each of those slots gets in auOwners. Returns 1 on success,
+   or 0 if memory allocation fails or no displacement works for some
+   bucket. */
+static int SymTable_buildPerfectHash(SymTable_T poFrozen,
+    const struct Binding *asBindings, size_t uCount, size_t *auOwners,
+    size_t *auTwins) {
+    size_t buckets=poFrozen->displacementcount;
+    size_t *groups;
+    size_t *members;
+    size_t *starts;
+    size_t *sizes;
+    size_t *bysize;
+    size_t *sizestarts;
+    unsigned long *taken;
+    size_t largest=0;
+    size_t slots=0;
+    size_t bucket;
+    size_t index;
+    size_t kept;
+    size_t other;
+    int success=1;
+
+    groups=(size_t*)malloc((uCount+buckets)*sizeof(size_t));
+    taken=(unsigned long*)calloc(uCount/(CHAR_BIT*sizeof(unsigned long))+1,
+        sizeof(unsigned long));
+    members=(size_t*)malloc((uCount+1)*sizeof(size_t));
+    starts=(size_t*)malloc((buckets+1)*sizeof(size_t));
+    sizes=(size_t*)malloc(buckets*sizeof(size_t));
+    bysize=(size_t*)malloc(buckets*sizeof(size_t));
+    sizestarts=NULL;
+    if (groups==NULL||taken==NULL||members==NULL||starts==NULL||
+        sizes==NULL||bysize==NULL)
+    {
+        success=0;
+    }
+    else
+    {
+        for (index = 0; index < uCount; index++)
+            groups[index]=SymTable_bucket(asBindings[index].hash,buckets);
+        SymTable_groupBy(groups,uCount,buckets,starts,members);
+
+        /* Keep the first key of each hash at the front of its bucket's
+           run. */
+        for (bucket = 0; bucket < buckets; bucket++) {
+            kept=starts[bucket];
+            for (index = starts[bucket]; index < starts[bucket+1]; index++) {
+                auTwins[members[index]]=members[index];
+                for (other = starts[bucket]; other < kept; other++)
+                    if (asBindings[members[other]].hash==asBindings[members[index]].hash)
+                    {
+                        auTwins[members[index]]=members[other];
+                        break;
+                    }
+                if (other==kept)
+                    members[kept++]=members[index];
+            }
+            sizes[bucket]=kept-starts[bucket];
+            slots+=sizes[bucket];
+            if (sizes[bucket]>largest)
+                largest=sizes[bucket];
+        }
+        poFrozen->frozencount=slots;
+
+        /* Order the buckets from largest to smallest. */
+        for (bucket = 0; bucket < buckets; bucket++)
+            groups[bucket]=largest-sizes[bucket];
+        sizestarts=(size_t*)malloc((largest+2)*sizeof(size_t));
+        if (sizestarts==NULL)
+        {
+            success=0;
+        }
+        else
+        {
+            SymTable_groupBy(groups,buckets,largest+1,sizestarts,bysize);
+        }
+    }
+
+    for (index = 0; success&&index < buckets; index++) {
+        bucket=bysize[index];
+        if (sizes[bucket]==0)
+            break;
+        success=SymTable_placeBucket(auOwners,taken,slots,asBindings,
+            &members[starts[bucket]],sizes[bucket],&poFrozen->displacements[bucket]);
+    }
+
+    free(groups);
+    free(taken);
+    free(members);
+    free(starts);
+    free(sizes);
+    free(bysize);
+    free(sizestarts);
+    return success;
+}
+
+/* Append to auOwners, after the frozencount slots of the perfect hash
+   of poFrozen, the indices of the uCount bindings that auTwins, as
+   SymTable_buildPerfectHash left it, marks as overflowing, sorted by
+   the slot of their twin, which is their home; store those homes in
+   the frozenhomes of poFrozen; and mark each home slot's check with
+   FROZEN_SHARED once the slots are filled in. Returns 1 on success, or
+   0 if memory allocation fails. */
+static int SymTable_sortOverflow(SymTable_T poFrozen, const size_t *auTwins,
+    size_t uCount, size_t *auOwners) {
+    size_t slots=poFrozen->frozencount;
+    size_t overflow=uCount-slots;
+    size_t *places;
+    size_t *spilled;
+    size_t *homes;
+    size_t *order;
+    size_t *starts;
+    size_t index;
+    size_t count=0;
+    int success=0;
+
+    poFrozen->frozenhomes=(size_t*)malloc((overflow+1)*sizeof(size_t));
+    places=(size_t*)malloc((uCount+1)*sizeof(size_t));
+    spilled=(size_t*)malloc((overflow+1)*sizeof(size_t));
+    homes=(size_t*)malloc((overflow+1)*sizeof(size_t));
+    order=(size_t*)malloc((overflow+1)*sizeof(size_t));
+    starts=(size_t*)malloc((slots+1)*sizeof(size_t));
+    if (poFrozen->frozenhomes!=NULL&&places!=NULL&&spilled!=NULL&&
+        homes!=NULL&&order!=NULL&&starts!=NULL)
+    {
+        for (index = 0; index < slots; index++)
+            places[auOwners[index]]=index;
+        for (index = 0; index < uCount; index++)
+            if (auTwins[index]!=index)
+            {
+                spilled[count]=index;
+                homes[count]=places[auTwins[index]];
+                count++;
+            }
+        SymTable_groupBy(homes,overflow,slots,starts,order);
+        for (index = 0; index < overflow; index++) {
+            auOwners[slots+index]=spilled[order[index]];
+            poFrozen->frozenhomes[index]=homes[order[index]];
+        }
+        success=1;
+    }
+
+    free(places);
+    free(spilled);
+    free(homes);
+    free(order);
+    free(starts);
+    return success;
+}
+
+SymTable_T SymTable_freeze(SymTable_T oSymTable){
+    SymTable_T frozen;
+    struct Binding *bindings;
+    const struct Binding *binding;
+    size_t *owners;
+    size_t *twins;
+    size_t count;
+    size_t size=0;
+    size_t index;
+    int success=0;
+
+    assert(oSymTable!=NULL);
+    assert(oSymTable->mapped==NULL);
+
+    count=oSymTable->bindings;
+    if (count>(size_t)-1/sizeof(struct Binding)-1)
+    {
+        return NULL;
+    }
+
+    /* The frozen table's one empty bucket is never used: every lookup
+       goes to its slots instead. */
+    frozen=SymTable_create(NULL,1);
+    if (frozen==NULL)
+    {
+        return NULL;
+    }
+    frozen->minbuckets=1;
+    frozen->displacementcount=1;
+    while (frozen->displacementcount*FROZEN_LOAD<count)
+        frozen->displacementcount*=2;
+    frozen->frozenslots=(struct FrozenSlot*)malloc((count+1)*sizeof(struct FrozenSlot));
+    frozen->displacements=(unsigned int*)calloc(frozen->displacementcount,sizeof(unsigned int));
+    bindings=(struct Binding*)malloc((count+1)*sizeof(struct Binding));
+    owners=(size_t*)malloc((count+1)*sizeof(size_t));
+    twins=(size_t*)malloc((count+1)*sizeof(size_t));
+    if (frozen->frozenslots!=NULL&&frozen->displacements!=NULL&&
+        bindings!=NULL&&owners!=NULL&&twins!=NULL)
+    {
+        SymTable_collect(oSymTable,bindings);
+        for (index = 0; index < count; index++)
+            size+=bindings[index].length+1;
+        frozen->frozenkeys=(char*)malloc(size+1);
+        frozen->frozenkeysize=size;
+        if (size>UINT_MAX)
+            frozen->frozenoffsets=(size_t*)malloc((count+1)*sizeof(size_t));
+        if (frozen->frozenkeys!=NULL&&(size<=UINT_MAX||frozen->frozenoffsets!=NULL))
+            success=SymTable_buildPerfectHash(frozen,bindings,count,owners,twins)&&
+                SymTable_sortOverflow(frozen,twins,count,owners);
+    }
+
+    /* Fill the slots, and lay the keys out in slot order so that
+       neighbouring slots' keys sit side by side. */
+    size=0;
+    for (index = 0; success&&index < count; index++) {
+        binding=&bindings[owners[index]];
+        frozen->frozenslots[index].check=SymTable_fingerprint(binding->hash);
+        frozen->frozenslots[index].key=0;
+        if (frozen->frozenoffsets!=NULL)
+            frozen->frozenoffsets[index]=size;
+        else
+            frozen->frozenslots[index].key=(unsigned int)size;
+        frozen->frozenslots[index].value=binding->value;
+        memcpy(frozen->frozenkeys+size,binding->key,binding->length+1);
+        size+=binding->length+1;
+    }
+    for (index = 0; success&&index < count-frozen->frozencount; index++)
+        frozen->frozenslots[frozen->frozenhomes[index]].check|=FROZEN_SHARED;
+
+    free(bindings);
+    free(owners);
+    free(twins);
+    if (!success)
+    {
+        SymTable_free(frozen);
+        return NULL;
+    }
+    frozen->bindings=count;
+    return frozen;
 }
@@ -5,20 +5,38 @@
 
 #include <stdio.h>
 #include "symtable.h"
+#include "slab.h"
+#include "hashfn.h"
 #include <assert.h>
 #include <stdlib.h> 
 #include <string.h>
 #include <stddef.h>
 
+/* Initial number of entries in the undo log and in the array of scope
+   starts. Both double when full. */
+enum {INITIAL_SCOPE_ENTRIES = 16};
+
 /* Each item is stored in a SymTableNode.  SymTableNodes are linked to
-   form a list.  */
+   form a list. The bytes of the key, with their '\0', follow the node
+   in the same slab block; see SymTable_key. */
 struct SymTablenode {
-    /* The key*/
-    const char *string;
     /* The value*/
     void *value;
     /* The address of the next SymTablenode. */
     struct SymTablenode *next;
+    /* The length of the key, not counting the '\0'*/
+    size_t length;
+    /* The hash of the key, checked before the key bytes are compared*/
+    size_t hash;
+    /* One more than the index of the binding's undo log entry, or 0
+    for a binding of the outermost scope*/
+    size_t undoslot;
+    /* The binding of the same key from an outer scope that this one
+    hides, kept out of the list until this one is gone*/
+    struct SymTablenode *shadow;
+    /* The link that points to this node while it is in the list, so
+    that SymTable_popScope can unlink it without a search*/
+    struct SymTablenode **pprev;
 
 };
 /*A stack is a node that points to the first SymTable Node*/
@@ -27,10 +45,81 @@ struct Stack {
     struct SymTablenode *first;
     /*Number of bindings in the Symbol table*/
     size_t numbindings;
+    /*Allocator for the nodes*/
+    Slab_T slab;
+    /*Caller's hash function, or NULL for HashFn_words*/
+    SymTable_HashFunction hashfn;
+    /*Number of scopes pushed and not yet popped*/
+    size_t depth;
+    /*Undo log: the nodes put by SymTable_putScoped, innermost scope
+    last, with NULL in place of any since removed*/
+    struct SymTablenode **undo;
+    size_t undocount;
+    size_t undocapacity;
+    /*For each pushed scope, the undo count when it was pushed*/
+    size_t *scopestarts;
+    size_t scopecapacity;
 };
 
+/* Return the key stored inline after poNode. */
+static const char *SymTable_key(const struct SymTablenode *poNode) {
+    return (const char*)(poNode + 1);
+}
+
+/* Return the size of the slab block that holds a node with a key of
+   length uLength. */
+static size_t SymTable_nodeSize(size_t uLength) {
+    return sizeof(struct SymTablenode) + uLength + 1;
+}
+
+/* Return the hash code for the uLength bytes at pcKey under the hash
+   function pfHash, or under HashFn_words if pfHash is NULL. */
+static size_t SymTable_hashWith(SymTable_HashFunction pfHash,
+    const char *pcKey, size_t uLength) {
+    assert(pcKey != NULL);
+
+    if (pfHash == NULL)
+    {
+        return HashFn_words(pcKey, uLength);
+    }
+    return HashFn_mix((*pfHash)(pcKey, uLength));
+}
+
+/* Return the hash code oSymTable uses for the uLength bytes at
+   pcKey. */
+static size_t SymTable_hash(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength) {
+    return SymTable_hashWith(oSymTable->hashfn, pcKey, uLength);
+}
+
+/* Return the address of the link that points to the node holding
+   pcKey, whose hash is uHash and length is uLength, in oSymTable, or
+   the address of the NULL link ending the list if there is no such
+   node. Most mismatches are rejected by the hash alone, without
+   reading the node's key. */
+static struct SymTablenode **SymTable_find(SymTable_T oSymTable,
+    const char *pcKey, size_t uHash, size_t uLength) {
+    struct SymTablenode **link;
+    struct SymTablenode *currnode;
+
+    link=&oSymTable->first;
+    for (currnode=*link; currnode!=NULL; currnode=*link)
+    {
+        if (currnode->hash==uHash&&currnode->length==uLength&&
+            memcmp(SymTable_key(currnode),pcKey,uLength)==0)
+        {
+            break;
+        }
+        link=&currnode->next;
+    }
+    return link;
+}
 
 SymTable_T SymTable_new(void){
+    return SymTable_newWithHash(NULL);
+}
+
+SymTable_T SymTable_newWithHash(SymTable_HashFunction pfHash){
 
     SymTable_T symtablenew;
 
@@ -41,25 +130,48 @@ SymTable_T SymTable_new(void){
         return NULL;
     }
 
+    symtablenew->slab=Slab_new();
+    if (symtablenew->slab==NULL)
+    {
+        free(symtablenew);
+        return NULL;
+    }
+
+    symtablenew->hashfn=pfHash;
     symtablenew->first=NULL;
     symtablenew->numbindings=0;
+    symtablenew->depth=0;
+    symtablenew->undo=NULL;
+    symtablenew->undocount=0;
+    symtablenew->undocapacity=0;
+    symtablenew->scopestarts=NULL;
+    symtablenew->scopecapacity=0;
 
     return symtablenew;
 }
 
+SymTable_T SymTable_newWithCapacity(size_t uCapacity){
+    /* A list has nothing to size ahead of time; its nodes come from
+       a slab that grows geometrically. */
+    (void)uCapacity;
+    return SymTable_new();
+}
+
+int SymTable_reserve(SymTable_T oSymTable, size_t uCapacity){
+    assert(oSymTable!=NULL);
+
+    (void)uCapacity;
+    return 1;
+}
+
 void SymTable_free(SymTable_T oSymTable){
-    struct SymTablenode *currnode;
-    struct SymTablenode *nextnode;
 
     assert(oSymTable!=NULL);
 
-    for ( currnode= oSymTable->first; currnode!=NULL; currnode=nextnode)
-    {
-        nextnode=currnode->next;
-        free((void*)currnode->string);
-        free(currnode);
-    }
-    
+    /* Every node lives in the slab, so the list need not be walked. */
+    free(oSymTable->undo);
+    free(oSymTable->scopestarts);
+    Slab_free(oSymTable->slab);
     free(oSymTable);
 }
 
@@ -70,55 +182,85 @@ size_t SymTable_getLength(SymTable_T oSymTable){
 }
 
 int SymTable_put(SymTable_T oSymTable, const char *pcKey, const void *pvValue){
-    
-    struct SymTablenode *new;
-    struct SymTablenode *currnode;
-
-    assert(oSymTable!=NULL);  
     assert(pcKey!=NULL);
-    
-    currnode = oSymTable->first;
-
-/*  Check to see if pckey is inside the symbol table. If we find it
-    then we can just change the value of that node that it is in*/
+    return SymTable_putn(oSymTable,pcKey,strlen(pcKey),pvValue);
+}
 
-    while (currnode!=NULL)
-    {
-        int cmp=strcmp(currnode->string,pcKey);
-        if (cmp==0)
-        {
-            return 0;
-        }
+/* Fill in poNode as a binding of the uLength bytes at pcKey, whose hash
+   is uHash, to pvValue in the outermost scope and insert it at the link
+   ppoLink points to. */
+static void SymTable_link(struct SymTablenode *poNode,
+    struct SymTablenode **ppoLink, const char *pcKey, size_t uLength,
+    size_t uHash, const void *pvValue){
+    memcpy((char*)SymTable_key(poNode),pcKey,uLength);
+    ((char*)SymTable_key(poNode))[uLength]='\0';
+    poNode->length=uLength;
+    poNode->hash=uHash;
+    poNode->undoslot=0;
+    poNode->shadow=NULL;
+    poNode->next=*ppoLink;
+    poNode->value=(void*)pvValue;
+    poNode->pprev=ppoLink;
+    if (poNode->next!=NULL)
+        poNode->next->pprev=&poNode->next;
+    *ppoLink=poNode;
+}
 
-        currnode = currnode->next;
-    }
+/* Add a new node binding the uLength bytes at pcKey, whose hash is
+   uHash, to pvValue at the front of oSymTable, which must not already
+   contain the key. Returns the node, or NULL if memory allocation
+   fails. */
+static struct SymTablenode *SymTable_addNode(SymTable_T oSymTable,
+    const char *pcKey, size_t uLength, size_t uHash, const void *pvValue){
+    struct SymTablenode *new;
 
-    /*  If not in the symbol table already, then we can just add the 
-        key and value pair to the front*/
-    new = (struct SymTablenode*)malloc(sizeof(struct SymTablenode));
+    new = (struct SymTablenode*)Slab_alloc(oSymTable->slab,SymTable_nodeSize(uLength));
 
     if (new==NULL)
     {
-        return 0;
+        return NULL;
     }
-    
-    new->string=(const char*)malloc(strlen(pcKey)+1);
-
-    strcpy((char*)new->string,pcKey);
 
-    new->next=oSymTable->first;
-    new->value= (void*)pvValue;
-    oSymTable->first=new;
+    SymTable_link(new,&oSymTable->first,pcKey,uLength,uHash,pvValue);
 
     oSymTable->numbindings++; /* Only when we add a new key and value pair*/
 
-    return 1;
-    /*FIX CONST VALUES*/
+    return new;
+}
+
+/* Add a binding of the uLength bytes at pcKey, whose hash is uHash, to
+   pvValue in oSymTable, as SymTable_putn does. */
+static int SymTable_insert(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, size_t uHash, const void *pvValue){
+
+    assert(oSymTable!=NULL);  
+    assert(pcKey!=NULL);
 
+    if (*SymTable_find(oSymTable,pcKey,uHash,uLength)!=NULL)
+    {
+        return 0;
+    }
+
+    return SymTable_addNode(oSymTable,pcKey,uLength,uHash,pvValue)!=NULL;
+}
+
+int SymTable_putn(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, const void *pvValue){
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    return SymTable_insert(oSymTable,pcKey,uLength,
+        SymTable_hash(oSymTable,pcKey,uLength),pvValue);
 }
 
 void *SymTable_replace(SymTable_T oSymTable, const char *pcKey,
 const void *pvValue) {
+    assert(pcKey!=NULL);
+    return SymTable_replacen(oSymTable,pcKey,strlen(pcKey),pvValue);
+}
+
+void *SymTable_replacen(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, const void *pvValue) {
 
     struct SymTablenode *currnode;
     void *oldval;
@@ -126,120 +268,327 @@ const void *pvValue) {
     assert(oSymTable!=NULL);
     assert(pcKey!=NULL);
 
-    currnode = oSymTable->first;
-
-    while (currnode!=NULL)
+    currnode=*SymTable_find(oSymTable,pcKey,
+        SymTable_hash(oSymTable,pcKey,uLength),uLength);
+    if (currnode==NULL)
     {
-        int cmp=strcmp(currnode->string,pcKey);
-        if (cmp==0)
-        {
-            oldval=currnode->value;
-            currnode->value=(void*)pvValue;
-            return oldval;
-        }
-
-        currnode = currnode->next;
+        return NULL;
     }
-    return NULL;
+
+    oldval=currnode->value;
+    currnode->value=(void*)pvValue;
+    return oldval;
 }
 
 int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
-    struct SymTablenode *currnode;
+    assert(pcKey!=NULL);
+    return SymTable_containsn(oSymTable,pcKey,strlen(pcKey));
+}
+
+int SymTable_containsn(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength){
     
     assert(oSymTable!=NULL);  
     assert(pcKey!=NULL);
 
-    currnode = oSymTable->first;
+    return *SymTable_find(oSymTable,pcKey,
+        SymTable_hash(oSymTable,pcKey,uLength),uLength)!=NULL;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+    assert(pcKey!=NULL);
+    return SymTable_getn(oSymTable,pcKey,strlen(pcKey));
+}
+
+/* Return the value bound to the uLength bytes at pcKey, whose uHash is
+   uHash, in oSymTable, as SymTable_getn does. */
+static void *SymTable_lookup(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, size_t uHash){
+    struct SymTablenode *currnode;
 
-    while (currnode!=NULL)
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    currnode=*SymTable_find(oSymTable,pcKey,uHash,uLength);
+    if (currnode==NULL)
     {
-        int cmp=strcmp(currnode->string,pcKey);
-        if (cmp==0)
-        {
-            return 1;
-        }
+        return NULL;
+    }
+    return currnode->value;
+}
+
+void *SymTable_getn(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength){
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    return SymTable_lookup(oSymTable,pcKey,uLength,
+        SymTable_hash(oSymTable,pcKey,uLength));
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+    assert(pcKey!=NULL);
+    return SymTable_removen(oSymTable,pcKey,strlen(pcKey));
+}
 
-        currnode = currnode->next;
+/* Take the node that *ppoLink points to out of oSymTable. If the node
+   hides a binding from an outer scope, that binding takes its place. */
+static void SymTable_unlink(SymTable_T oSymTable,
+    struct SymTablenode **ppoLink){
+    struct SymTablenode *node=*ppoLink;
+
+    if (node->shadow!=NULL)
+    {
+        node->shadow->next=node->next;
+        node->shadow->pprev=ppoLink;
+        if (node->next!=NULL)
+            node->next->pprev=&node->shadow->next;
+        *ppoLink=node->shadow;
+        return;
     }
-    return 0;
+    if (node->next!=NULL)
+        node->next->pprev=ppoLink;
+    *ppoLink=node->next;
+    oSymTable->numbindings--;
+}
 
+/* Replace the undo log entry of poNode, which SymTable_putScoped put
+   and which is being removed, by NULL so that SymTable_popScope skips
+   it. */
+static void SymTable_forget(SymTable_T oSymTable,
+    const struct SymTablenode *poNode){
+    assert(oSymTable->undo[poNode->undoslot-1]==poNode);
+    oSymTable->undo[poNode->undoslot-1]=NULL;
 }
 
-void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+/* Return the depth of the scope poNode was put in: the number of
+   scopes pushed at or before the point its undo log entry was made.
+   The scope starts never decrease, so they are binary searched. */
+static size_t SymTable_depthOf(SymTable_T oSymTable,
+    const struct SymTablenode *poNode){
+    size_t low=0;
+    size_t high=oSymTable->depth;
+    size_t middle;
+
+    if (poNode->undoslot==0)
+    {
+        return 0;
+    }
+    while (low<high)
+    {
+        middle=low+(high-low)/2;
+        if (oSymTable->scopestarts[middle]<poNode->undoslot)
+            low=middle+1;
+        else
+            high=middle;
+    }
+    return low;
+}
+
+void *SymTable_removen(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength){
+   
+    struct SymTablenode **link;
     struct SymTablenode *currnode;
+    void *returni;
 
     assert(oSymTable!=NULL);
     assert(pcKey!=NULL);
 
-    currnode = oSymTable->first;
-
-    while (currnode!=NULL)
+    link=SymTable_find(oSymTable,pcKey,
+        SymTable_hash(oSymTable,pcKey,uLength),uLength);
+    currnode=*link;
+    if (currnode==NULL)
     {
-        int cmp=strcmp(currnode->string,pcKey);
-        if (cmp==0)
-        {
-            return currnode->value;
-        }
+        return NULL;
+    }
 
-        currnode = currnode->next;
+    SymTable_unlink(oSymTable,link);
+    returni=currnode->value;
+    if (currnode->undoslot>0)
+        SymTable_forget(oSymTable,currnode);
+    Slab_release(oSymTable->slab,currnode,SymTable_nodeSize(currnode->length));
+
+    return returni;
+}
+
+void *SymTable_upsert(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue, int *piAdded){
+    struct SymTablenode *currnode;
+    void *oldval;
+    size_t length;
+    size_t hash;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    length=strlen(pcKey);
+    hash=SymTable_hash(oSymTable,pcKey,length);
+    currnode=*SymTable_find(oSymTable,pcKey,hash,length);
+    if (currnode!=NULL)
+    {
+        oldval=currnode->value;
+        currnode->value=(void*)pvValue;
+        if (piAdded!=NULL)
+            *piAdded=0;
+        return oldval;
     }
 
+    currnode=SymTable_addNode(oSymTable,pcKey,length,hash,pvValue);
+    if (piAdded!=NULL)
+        *piAdded=(currnode!=NULL)?1:-1;
     return NULL;
 }
 
-void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
-   
+void *SymTable_getOrPut(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue, int *piAdded){
     struct SymTablenode *currnode;
-    struct SymTablenode *formernode;
-    void *returni;
-    int cmp;
+    size_t length;
+    size_t hash;
 
     assert(oSymTable!=NULL);
     assert(pcKey!=NULL);
 
-    formernode=oSymTable->first;
+    length=strlen(pcKey);
+    hash=SymTable_hash(oSymTable,pcKey,length);
+    currnode=*SymTable_find(oSymTable,pcKey,hash,length);
+    if (currnode!=NULL)
+    {
+        if (piAdded!=NULL)
+            *piAdded=0;
+        return currnode->value;
+    }
 
-    if(formernode==NULL){
-        return NULL;
+    currnode=SymTable_addNode(oSymTable,pcKey,length,hash,pvValue);
+    if (piAdded!=NULL)
+        *piAdded=(currnode!=NULL)?1:-1;
+    return (currnode!=NULL)?(void*)pvValue:NULL;
+}
+
+void SymTable_getBatch(SymTable_T oSymTable, const char *const apcKeys[],
+    size_t uCount, void *apvValues[]){
+    size_t index;
+
+    assert(oSymTable!=NULL);
+    assert(apcKeys!=NULL||uCount==0);
+    assert(apvValues!=NULL||uCount==0);
+
+    /* Each lookup walks the same list, so there is no latency for a
+       batch to overlap. */
+    for (index = 0; index < uCount; index++)
+        apvValues[index]=SymTable_get(oSymTable,apcKeys[index]);
+}
+
+void SymTable_containsBatch(SymTable_T oSymTable,
+    const char *const apcKeys[], size_t uCount, int aiFound[]){
+    size_t index;
+
+    assert(oSymTable!=NULL);
+    assert(apcKeys!=NULL||uCount==0);
+    assert(aiFound!=NULL||uCount==0);
+
+    for (index = 0; index < uCount; index++)
+        aiFound[index]=SymTable_contains(oSymTable,apcKeys[index]);
+}
+
+size_t SymTable_putBatch(SymTable_T oSymTable, const char *const apcKeys[],
+    const void *const apvValues[], size_t uCount, size_t uThreads,
+    int aiResults[]){
+    size_t added=0;
+    size_t index;
+
+    assert(oSymTable!=NULL);
+    assert(apcKeys!=NULL||uCount==0);
+    assert(apvValues!=NULL||uCount==0);
+    assert(aiResults!=NULL||uCount==0);
+
+    /* Every put scans the one list, so there is nothing to split
+       between threads. */
+    (void)uThreads;
+    for (index = 0; index < uCount; index++) {
+        SymTable_getOrPut(oSymTable,apcKeys[index],apvValues[index],
+            &aiResults[index]);
+        if (aiResults[index]==1)
+            added++;
     }
+    return added;
+}
 
-    currnode = formernode->next;
+void SymTable_iterBegin(SymTable_T oSymTable, struct SymTable_Iter *psIter){
+    assert(oSymTable!=NULL);
+    assert(psIter!=NULL);
 
-    cmp=strcmp(formernode->string,pcKey);
+    psIter->oSymTable=oSymTable;
+    psIter->pvNode=oSymTable->first;
+    psIter->uBucket=0;
+}
 
-    if (cmp==0)
+int SymTable_iterNext(struct SymTable_Iter *psIter, const char **ppcKey,
+    void **ppvValue){
+    struct SymTablenode *currnode;
+
+    assert(psIter!=NULL);
+
+    currnode=(struct SymTablenode*)psIter->pvNode;
+    if (currnode==NULL)
     {
-        oSymTable->numbindings--;
-        returni=formernode->value;
-        free((void*)formernode->string);
-        free(formernode);
-        
-        oSymTable->first=currnode;
-        
-        return returni;
-    }
-    else{
-        while (currnode!=NULL)
-        {
-            cmp=strcmp(currnode->string,pcKey);
-            if (cmp==0)
-            {
-                oSymTable->numbindings--;
-                returni=currnode->value;
-        
-                formernode->next=currnode->next;
-                free((void*)currnode->string);
-                
-                free(currnode);
-
-                return returni;
-            }
-            currnode = currnode->next;
-            formernode=formernode->next;
-        }
+        return 0;
+    }
+
+    psIter->pvNode=currnode->next;
+    if (ppcKey!=NULL)
+        *ppcKey=SymTable_key(currnode);
+    if (ppvValue!=NULL)
+        *ppvValue=currnode->value;
+    return 1;
+}
 
+void SymTable_iterEnd(struct SymTable_Iter *psIter){
+    assert(psIter!=NULL);
+
+    psIter->oSymTable=NULL;
+    psIter->pvNode=NULL;
+}
+
+void SymTable_prepareKey(struct SymTable_Key *psKey, const char *pcKey,
+    size_t uLength, SymTable_HashFunction pfHash){
+    assert(psKey!=NULL);
+    assert(pcKey!=NULL);
+
+    psKey->pcKey=pcKey;
+    psKey->uLength=uLength;
+    psKey->pfHash=pfHash;
+    psKey->uHash=SymTable_hashWith(pfHash,pcKey,uLength);
+}
+
+/* Return the hash oSymTable uses for the prepared key *psKey, which is
+   the stored hash unless *psKey was prepared for a different hash
+   function. */
+static size_t SymTable_preparedHash(SymTable_T oSymTable,
+    const struct SymTable_Key *psKey){
+    if (psKey->pfHash==oSymTable->hashfn)
+    {
+        return psKey->uHash;
     }
-    return NULL;
+    return SymTable_hash(oSymTable,psKey->pcKey,psKey->uLength);
+}
+
+int SymTable_putPrepared(SymTable_T oSymTable,
+    const struct SymTable_Key *psKey, const void *pvValue){
+    assert(oSymTable!=NULL);
+    assert(psKey!=NULL);
+
+    return SymTable_insert(oSymTable,psKey->pcKey,psKey->uLength,
+        SymTable_preparedHash(oSymTable,psKey),pvValue);
+}
+
+void *SymTable_getPrepared(SymTable_T oSymTable,
+    const struct SymTable_Key *psKey){
+    assert(oSymTable!=NULL);
+    assert(psKey!=NULL);
+
+    return SymTable_lookup(oSymTable,psKey->pcKey,psKey->uLength,
+        SymTable_preparedHash(oSymTable,psKey));
 }
 
 /* INCLUDE THE STRING LIBRARY TO USE THE STRING COMPARE FUNCTION.
@@ -258,10 +607,208 @@ const void *pvExtra){
 
     for (currnode= oSymTable->first; currnode!=NULL; currnode=currnode->next)
     {
-        (*pfApply)(currnode->string,(void*)currnode->value,(void*)pvExtra);
+        (*pfApply)(SymTable_key(currnode),(void*)currnode->value,(void*)pvExtra);
     }
 
 }
 
 
     
+
+void SymTable_mapParallel(SymTable_T oSymTable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *const apvExtra[], size_t uThreads) {
+    assert(apvExtra!=NULL);
+    assert(uThreads>0);
+
+    /* A list cannot be split without walking it, so one thread does
+       all the work. */
+    SymTable_map(oSymTable,pfApply,apvExtra[0]);
+}
+
+/* Make room in *ppvArray, an array of *puCapacity elements of uSize
+   bytes, for one more than uCount elements, doubling its capacity if
+   it is full. Returns 1 on success, or 0 if memory allocation fails,
+   in which case the array is unchanged. */
+static int SymTable_makeRoom(void **ppvArray, size_t *puCapacity,
+    size_t uCount, size_t uSize){
+    size_t capacity;
+    void *grown;
+
+    if (uCount<*puCapacity)
+    {
+        return 1;
+    }
+    capacity=(*puCapacity==0)?INITIAL_SCOPE_ENTRIES:*puCapacity*2;
+    if (capacity<*puCapacity||capacity>(size_t)-1/uSize)
+    {
+        return 0;
+    }
+    grown=realloc(*ppvArray,capacity*uSize);
+    if (grown==NULL)
+    {
+        return 0;
+    }
+    *ppvArray=grown;
+    *puCapacity=capacity;
+    return 1;
+}
+
+int SymTable_pushScope(SymTable_T oSymTable){
+    assert(oSymTable!=NULL);
+
+    if (!SymTable_makeRoom((void**)&oSymTable->scopestarts,
+        &oSymTable->scopecapacity,oSymTable->depth,sizeof(size_t)))
+    {
+        return 0;
+    }
+    oSymTable->scopestarts[oSymTable->depth]=oSymTable->undocount;
+    oSymTable->depth++;
+    return 1;
+}
+
+int SymTable_popScope(SymTable_T oSymTable){
+    struct SymTablenode *node;
+    size_t start;
+
+    assert(oSymTable!=NULL);
+
+    if (oSymTable->depth==0)
+    {
+        return 0;
+    }
+    oSymTable->depth--;
+    start=oSymTable->scopestarts[oSymTable->depth];
+
+    /* Undo the scope's puts, latest first. Each node knows the link
+       that points to it, so none has to be searched for. */
+    while (oSymTable->undocount>start)
+    {
+        node=oSymTable->undo[--oSymTable->undocount];
+        if (node==NULL)
+            continue;
+        SymTable_unlink(oSymTable,node->pprev);
+        Slab_release(oSymTable->slab,node,SymTable_nodeSize(node->length));
+    }
+    return 1;
+}
+
+int SymTable_putScoped(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue){
+    struct SymTablenode **link;
+    struct SymTablenode *outer;
+    struct SymTablenode *new;
+    size_t length;
+    size_t hash;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    if (oSymTable->depth==0)
+    {
+        return SymTable_put(oSymTable,pcKey,pvValue);
+    }
+
+    length=strlen(pcKey);
+    hash=SymTable_hash(oSymTable,pcKey,length);
+    link=SymTable_find(oSymTable,pcKey,hash,length);
+    outer=*link;
+    if (outer!=NULL&&
+        outer->undoslot>oSymTable->scopestarts[oSymTable->depth-1])
+    {
+        return 0;
+    }
+
+    if (!SymTable_makeRoom((void**)&oSymTable->undo,&oSymTable->undocapacity,
+        oSymTable->undocount,sizeof(struct SymTablenode*)))
+    {
+        return 0;
+    }
+    if (outer==NULL)
+    {
+        new=SymTable_addNode(oSymTable,pcKey,length,hash,pvValue);
+        if (new==NULL)
+        {
+            return 0;
+        }
+    }
+    else
+    {
+        /* The new node takes the outer binding's place in the list,
+           and holds on to it until the scope is popped. */
+        new=(struct SymTablenode*)Slab_alloc(oSymTable->slab,SymTable_nodeSize(length));
+        if (new==NULL)
+        {
+            return 0;
+        }
+        SymTable_link(new,link,pcKey,length,hash,pvValue);
+        new->next=outer->next;
+        if (new->next!=NULL)
+            new->next->pprev=&new->next;
+        new->shadow=outer;
+        outer->next=NULL;
+    }
+    oSymTable->undo[oSymTable->undocount++]=new;
+    new->undoslot=oSymTable->undocount;
+    return 1;
+}
+
+void *SymTable_getScoped(SymTable_T oSymTable, const char *pcKey,
+    size_t *puDepth){
+    struct SymTablenode *currnode;
+    size_t length;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    length=strlen(pcKey);
+    currnode=*SymTable_find(oSymTable,pcKey,
+        SymTable_hash(oSymTable,pcKey,length),length);
+    if (currnode==NULL)
+    {
+        return NULL;
+    }
+    if (puDepth!=NULL)
+        *puDepth=SymTable_depthOf(oSymTable,currnode);
+    return currnode->value;
+}
+
+SymTable_T SymTable_clone(SymTable_T oSymTable){
+    SymTable_T clone;
+    struct SymTablenode *currnode;
+    struct SymTablenode *copy;
+    struct SymTablenode **link;
+    size_t size;
+
+    assert(oSymTable!=NULL);
+
+    clone=SymTable_newWithHash(oSymTable->hashfn);
+    if (clone==NULL)
+    {
+        return NULL;
+    }
+
+    /* Each node is copied with its key and hash in one block, in list
+       order, and put in the outermost scope. */
+    link=&clone->first;
+    for (currnode=oSymTable->first; currnode!=NULL; currnode=currnode->next){
+        size=SymTable_nodeSize(currnode->length);
+        copy=(struct SymTablenode*)Slab_alloc(clone->slab,size);
+        if (copy==NULL)
+        {
+            *link=NULL;
+            SymTable_free(clone);
+            return NULL;
+        }
+        memcpy(copy,currnode,size);
+        copy->undoslot=0;
+        copy->shadow=NULL;
+        copy->pprev=link;
+        *link=copy;
+        link=&copy->next;
+    }
+    *link=NULL;
+
+    clone->numbindings=oSymTable->numbindings;
+    return clone;
+}
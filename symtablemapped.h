@@ -0,0 +1,51 @@
+/*--------------------------------------------------------------------*/
+/* symtablemapped.h                                                   */
+/* Author: Kevin Castro                                               */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLEMAPPED_INCLUDED
+#define SYMTABLEMAPPED_INCLUDED
+
+#include "symtable.h"
+#include <stdio.h>
+
+/* The functions below are provided by the hash table implementation.
+   They save a table to a file that can later be mapped into memory and
+   searched where it lies, so a large table is ready as soon as the file
+   is mapped instead of after every binding has been put again. The file
+   holds only offsets, never addresses, but it is read with the size_t
+   width and byte order of the machine that wrote it. */
+
+/* A SymTable_ValueWriter writes the value pvValue to psFile, in a form
+   the program can use in place once the file is mapped, and returns 1.
+   Returns 0 if the value cannot be written. */
+typedef int (*SymTable_ValueWriter)(const void *pvValue, FILE *psFile);
+
+/* Writes every binding of oSymTable to the file at pcPath, replacing
+   it, with each value written by *pfWrite. Each value starts at a
+   multiple of 16 bytes from the start of the file, so a value written
+   as a struct can be read in place. The keys are indexed under the
+   default hash whatever hash function oSymTable uses. Returns 1 on
+   success. Returns 0 if the file cannot be written, *pfWrite fails, or
+   memory allocation fails, in which case the file is removed.
+   oSymTable must not itself come from SymTable_openMapped. */
+int SymTable_save(SymTable_T oSymTable, const char *pcPath,
+   SymTable_ValueWriter pfWrite);
+
+/* Returns a table serving the bindings of the file at pcPath, which
+   SymTable_save wrote, straight from a read-only mapping of the file.
+   Opening it makes one pass over the file's index, checking that every
+   bucket, entry and key lies within the file, but reads no values, and
+   lookups allocate nothing. SymTable_get returns the address of the
+   bytes *pfWrite wrote for the value, which must not be written
+   through. Only SymTable_getLength, SymTable_contains,
+   SymTable_containsn, SymTable_get, SymTable_getn, SymTable_getPrepared,
+   SymTable_getBatch, SymTable_containsBatch, SymTable_getScoped, which
+   finds every binding in the outermost scope, SymTable_map,
+   SymTable_mapParallel, which applies the map in one thread, and
+   SymTable_free may be called on the table. Returns NULL if the file
+   cannot be opened or mapped, is not a file written by SymTable_save on
+   this kind of machine, or if memory allocation fails. */
+SymTable_T SymTable_openMapped(const char *pcPath);
+
+#endif
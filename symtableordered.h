@@ -0,0 +1,37 @@
+/*--------------------------------------------------------------------*/
+/* symtableordered.h                                                  */
+/* Author: Kevin Castro                                               */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLEORDERED_INCLUDED
+#define SYMTABLEORDERED_INCLUDED
+
+#include "symtable.h"
+
+/* The functions below are provided by the ordered implementations,
+   which keep their keys sorted by strcmp. In those implementations
+   SymTable_map visits the bindings in increasing order of their keys,
+   and SymTable_newWithHash ignores its hash function. The key a map
+   function passes to *pfApply may be rebuilt for the call, so it lasts
+   only until *pfApply returns, and *pfApply must not map oSymTable
+   again. */
+
+/* Applies *pfApply, in increasing order of key, to every binding of
+   oSymTable whose key is at least pcLow and less than pcHigh. A NULL
+   pcLow or pcHigh leaves that end of the range open. pvExtra is passed
+   to *pfApply as in SymTable_map. *pfApply must not change
+   oSymTable. */
+void SymTable_rangeMap(SymTable_T oSymTable, const char *pcLow,
+   const char *pcHigh,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra);
+
+/* Applies *pfApply, in increasing order of key, to every binding of
+   oSymTable whose key starts with pcPrefix. The empty prefix matches
+   every key. pvExtra is passed to *pfApply as in SymTable_map.
+   *pfApply must not change oSymTable. */
+void SymTable_prefixMap(SymTable_T oSymTable, const char *pcPrefix,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra);
+
+#endif
@@ -0,0 +1,754 @@
+/*--------------------------------------------------------------------*/
+/* symtablercu.c                                                      */
+/* Author: Kevin Castro                                               */
+/*--------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include "symtable.h"
+#include "slab.h"
+#include "hashfn.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <pthread.h>
+
+/* A hash table for tables that are read by many threads and written
+   rarely. Every function except SymTable_free may be called by several
+   threads at once.
+
+   SymTable_get, SymTable_contains and SymTable_map take no lock and
+   write nothing shared: they follow pointers that writers publish
+   with atomic stores. Writers take the table's one writer lock. A
+   writer never changes a node a reader might be looking at, other
+   than its value and next pointer; it unlinks the node instead, and a
+   resize copies every node into a new bucket array rather than
+   relinking the old ones.
+
+   Unlinked nodes and old bucket arrays are freed once no reader can
+   still hold them, judged by epochs. Every thread that reads a table
+   owns a reader record. On entering a read it stamps the record with
+   the global epoch, and on leaving it clears the stamp. The global
+   epoch moves from e to e+1 only once every stamped record shows e,
+   so memory retired during epoch e is unreachable by the time the
+   epoch reaches e+2. A thread that cannot get a record is counted in
+   anonymousReaders instead, and holds every epoch back while it
+   reads. */
+
+/* Number of buckets in a new SymTable. A power of two. */
+enum {INITIAL_BUCKETS = 512};
+
+/* The table shrinks once its bindings fall below one per this many
+   buckets, but never below INITIAL_BUCKETS. */
+enum {SHRINK_LOAD_DIVISOR = 8};
+
+/* Number of limbo lists; memory retired in epoch e waits on list
+   e % LIMBO_LISTS. Three covers the epochs e, e-1 and e-2 that may
+   still have readers. */
+enum {LIMBO_LISTS = 3};
+
+/* Number of retirements between attempts to advance the global epoch
+   and free what has become unreachable. */
+enum {RECLAIM_INTERVAL = 64};
+
+/* Bytes set aside for each reader record, so that readers stamping
+   their own records never write to a cache line another reader
+   uses. */
+enum {READER_SPACING = 128};
+
+/* Each binding is stored in an RcuNode, and the nodes of a bucket are
+   linked to form a chain. The bytes of the key, with their '\0',
+   follow the node in the same slab block; see SymTable_key. */
+struct RcuNode {
+    /* The value; read and written atomically*/
+    void *value;
+    /* The next node of the chain; read and written atomically*/
+    struct RcuNode *next;
+    /* The full hash of the key*/
+    size_t hash;
+    /* The length of the key, not counting the '\0'*/
+    size_t length;
+    /* The next node on the same limbo list, once unlinked*/
+    struct RcuNode *retired;
+};
+
+/* A bucket array. The count chain heads follow the header in the same
+   block; see SymTable_heads. */
+struct RcuBuckets {
+    /* Number of buckets, a power of two*/
+    size_t count;
+    /* The next array on the same limbo list, once replaced*/
+    struct RcuBuckets *retired;
+};
+
+/* The epoch stamp of a thread. */
+struct RcuReader {
+    /* 0 while the thread is outside any read, or 2e+1 while it reads
+    and entered during epoch e; written by the owning thread only*/
+    size_t state;
+    /* Depth of nested reads, as when pfApply of SymTable_map calls
+    SymTable_get; used by the owning thread only*/
+    size_t nesting;
+    /* Nonzero while a thread owns the record*/
+    int inuse;
+    /* The next record; records are never freed*/
+    struct RcuReader *next;
+};
+
+/* A reader record, padded out to READER_SPACING bytes. */
+union RcuReaderSlot {
+    struct RcuReader reader;
+    char padding[READER_SPACING];
+};
+
+/*A stack is the published bucket array, and the writer lock and
+limbo lists that the writers share.*/
+struct Stack {
+    /*The current bucket array; read and written atomically*/
+    struct RcuBuckets *buckets;
+    /*Number of bindings; read atomically, written by writers*/
+    size_t bindings;
+    /*Held by every put, replace and remove*/
+    pthread_mutex_t writelock;
+    /*Allocator for the nodes; used only with writelock held*/
+    Slab_T slab;
+    /*Caller's hash function, or NULL for HashFn_words*/
+    SymTable_HashFunction hashfn;
+    /*Retired nodes and bucket arrays waiting to be freed, and the
+    epoch they were retired in*/
+    struct RcuNode *limbonodes[LIMBO_LISTS];
+    struct RcuBuckets *limboarrays[LIMBO_LISTS];
+    size_t limboepoch[LIMBO_LISTS];
+    /*Retirements since the last attempt to reclaim*/
+    size_t retirecount;
+};
+
+/* The global epoch, shared by every table. Starts at 1 so that no
+   limbo list starts out looking current. */
+static size_t globalEpoch = 1;
+
+/* Every reader record ever made. */
+static struct RcuReader *readerList = NULL;
+
+/* Number of reads in progress by threads that could not get a reader
+   record. The epoch never advances while there are any. */
+static size_t anonymousReaders = 0;
+
+/* The key under which each thread keeps its reader record, created
+   once. readerKeyMade is nonzero if creating it succeeded. */
+static pthread_once_t readerOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t readerKey;
+static int readerKeyMade = 0;
+
+/* Return the key stored inline after poNode. */
+static const char *SymTable_key(const struct RcuNode *poNode) {
+    return (const char*)(poNode + 1);
+}
+
+/* Return the size of the slab block that holds a node with a key of
+   length uLength. */
+static size_t SymTable_nodeSize(size_t uLength) {
+    return sizeof(struct RcuNode) + uLength + 1;
+}
+
+/* Return the chain heads stored after poBuckets. */
+static struct RcuNode **SymTable_heads(struct RcuBuckets *poBuckets) {
+    return (struct RcuNode**)(void*)(poBuckets + 1);
+}
+
+/* Return the hash code oSymTable uses for the uLength bytes at
+   pcKey. */
+static size_t SymTable_hash(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength) {
+    assert(pcKey != NULL);
+
+    if (oSymTable->hashfn == NULL)
+    {
+        return HashFn_words(pcKey, uLength);
+    }
+    return HashFn_mix((*oSymTable->hashfn)(pcKey, uLength));
+}
+
+/* Return a new bucket array of uCount empty buckets, or NULL if
+   memory allocation fails. */
+static struct RcuBuckets *SymTable_newBuckets(size_t uCount) {
+    struct RcuBuckets *buckets;
+
+    if (uCount>((size_t)-1-sizeof(struct RcuBuckets))/sizeof(struct RcuNode*))
+    {
+        return NULL;
+    }
+    buckets=(struct RcuBuckets*)calloc(1,sizeof(struct RcuBuckets)+uCount*sizeof(struct RcuNode*));
+    if (buckets==NULL)
+    {
+        return NULL;
+    }
+    buckets->count=uCount;
+    return buckets;
+}
+
+/*--------------------------------------------------------------------*/
+/* Reader records and epochs */
+
+/* Give up the reader record pvReader when its thread exits. */
+static void SymTable_releaseReader(void *pvReader) {
+    struct RcuReader *reader=(struct RcuReader*)pvReader;
+
+    __atomic_store_n(&reader->state,0,__ATOMIC_RELEASE);
+    __atomic_store_n(&reader->inuse,0,__ATOMIC_RELEASE);
+}
+
+/* Create readerKey. */
+static void SymTable_makeReaderKey(void) {
+    readerKeyMade=pthread_key_create(&readerKey,SymTable_releaseReader)==0;
+}
+
+/* Return the calling thread's reader record, claiming one on the
+   thread's first read. Returns NULL if no record can be had. */
+static struct RcuReader *SymTable_reader(void) {
+    struct RcuReader *reader;
+    union RcuReaderSlot *slot;
+    int unused;
+
+    if (pthread_once(&readerOnce,SymTable_makeReaderKey)!=0||!readerKeyMade)
+    {
+        return NULL;
+    }
+    reader=(struct RcuReader*)pthread_getspecific(readerKey);
+    if (reader!=NULL)
+    {
+        return reader;
+    }
+
+    /* Reuse the record of a thread that has exited, if there is one. */
+    for (reader=__atomic_load_n(&readerList,__ATOMIC_ACQUIRE); reader!=NULL; reader=reader->next) {
+        unused=0;
+        if (__atomic_compare_exchange_n(&reader->inuse,&unused,1,0,
+            __ATOMIC_ACQ_REL,__ATOMIC_RELAXED))
+        {
+            break;
+        }
+    }
+
+    if (reader==NULL)
+    {
+        slot=(union RcuReaderSlot*)malloc(sizeof(union RcuReaderSlot));
+        if (slot==NULL)
+        {
+            return NULL;
+        }
+        reader=&slot->reader;
+        reader->state=0;
+        reader->nesting=0;
+        reader->inuse=1;
+        reader->next=__atomic_load_n(&readerList,__ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&readerList,&reader->next,reader,0,
+            __ATOMIC_RELEASE,__ATOMIC_RELAXED))
+            ;
+    }
+
+    if (pthread_setspecific(readerKey,reader)!=0)
+    {
+        SymTable_releaseReader(reader);
+        return NULL;
+    }
+    return reader;
+}
+
+/* Begin a read. Returns the record to pass to SymTable_endRead, or
+   NULL if the calling thread has none and is counted in
+   anonymousReaders instead. */
+static struct RcuReader *SymTable_beginRead(void) {
+    struct RcuReader *reader=SymTable_reader();
+
+    if (reader==NULL)
+    {
+        __atomic_add_fetch(&anonymousReaders,1,__ATOMIC_SEQ_CST);
+        return NULL;
+    }
+    if (reader->nesting++==0)
+    {
+        size_t epoch=__atomic_load_n(&globalEpoch,__ATOMIC_SEQ_CST);
+        __atomic_store_n(&reader->state,2*epoch+1,__ATOMIC_RELAXED);
+        /* The stamp must be visible before any pointer of the table is
+           read; otherwise a writer could miss the stamp and free what
+           the read is about to reach. */
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+    return reader;
+}
+
+/* End a read begun by SymTable_beginRead, which returned poReader. */
+static void SymTable_endRead(struct RcuReader *poReader) {
+    if (poReader==NULL)
+    {
+        __atomic_sub_fetch(&anonymousReaders,1,__ATOMIC_RELEASE);
+        return;
+    }
+    if (--poReader->nesting==0)
+        __atomic_store_n(&poReader->state,0,__ATOMIC_RELEASE);
+}
+
+/* Advance the global epoch if every thread in a read entered it during
+   the current epoch. Return the global epoch afterwards. */
+static size_t SymTable_advanceEpoch(void) {
+    struct RcuReader *reader;
+    size_t epoch;
+    size_t state;
+
+    epoch=__atomic_load_n(&globalEpoch,__ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&anonymousReaders,__ATOMIC_SEQ_CST)!=0)
+    {
+        return epoch;
+    }
+    for (reader=__atomic_load_n(&readerList,__ATOMIC_ACQUIRE); reader!=NULL; reader=reader->next) {
+        state=__atomic_load_n(&reader->state,__ATOMIC_ACQUIRE);
+        if (state!=0&&state!=2*epoch+1)
+        {
+            return epoch;
+        }
+    }
+    /* If another writer advanced it first, that is just as good. */
+    __atomic_compare_exchange_n(&globalEpoch,&epoch,epoch+1,0,
+        __ATOMIC_SEQ_CST,__ATOMIC_SEQ_CST);
+    return __atomic_load_n(&globalEpoch,__ATOMIC_SEQ_CST);
+}
+
+/*--------------------------------------------------------------------*/
+/* Deferred freeing; every function here needs the writer lock */
+
+/* Free everything on limbo list uList of oSymTable. */
+static void SymTable_freeLimbo(SymTable_T oSymTable, size_t uList) {
+    struct RcuNode *currnode;
+    struct RcuNode *nextnode;
+    struct RcuBuckets *currarray;
+    struct RcuBuckets *nextarray;
+
+    for (currnode=oSymTable->limbonodes[uList]; currnode!=NULL; currnode=nextnode) {
+        nextnode=currnode->retired;
+        Slab_release(oSymTable->slab,currnode,SymTable_nodeSize(currnode->length));
+    }
+    oSymTable->limbonodes[uList]=NULL;
+
+    for (currarray=oSymTable->limboarrays[uList]; currarray!=NULL; currarray=nextarray) {
+        nextarray=currarray->retired;
+        free(currarray);
+    }
+    oSymTable->limboarrays[uList]=NULL;
+}
+
+/* Return the limbo list of oSymTable for memory retired now, first
+   freeing whatever is left on it from an earlier epoch. */
+static size_t SymTable_limbo(SymTable_T oSymTable) {
+    size_t epoch;
+    size_t list;
+
+    /* Read the epoch only after the unlink that retires the memory is
+       visible. Then any reader that still got to the memory entered
+       during this epoch or an earlier one, and its stamp holds the
+       epoch back from reaching this one plus 2. */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    epoch=__atomic_load_n(&globalEpoch,__ATOMIC_SEQ_CST);
+    list=epoch%LIMBO_LISTS;
+
+    /* The list's earlier epoch is at least LIMBO_LISTS behind. */
+    if (oSymTable->limboepoch[list]!=epoch)
+    {
+        SymTable_freeLimbo(oSymTable,list);
+        oSymTable->limboepoch[list]=epoch;
+    }
+    return list;
+}
+
+/* Every RECLAIM_INTERVAL retirements, try to advance the global epoch
+   and free the limbo lists of oSymTable that no reader can reach. */
+static void SymTable_reclaim(SymTable_T oSymTable) {
+    size_t epoch;
+    size_t list;
+
+    if (++oSymTable->retirecount<RECLAIM_INTERVAL)
+    {
+        return;
+    }
+    oSymTable->retirecount=0;
+
+    epoch=SymTable_advanceEpoch();
+    for (list = 0; list < LIMBO_LISTS; list++) {
+        if (oSymTable->limboepoch[list]+2<=epoch)
+            SymTable_freeLimbo(oSymTable,list);
+    }
+}
+
+/* Free poNode, which has been unlinked, once no reader can reach it. */
+static void SymTable_retireNode(SymTable_T oSymTable,
+    struct RcuNode *poNode) {
+    size_t list=SymTable_limbo(oSymTable);
+
+    poNode->retired=oSymTable->limbonodes[list];
+    oSymTable->limbonodes[list]=poNode;
+    SymTable_reclaim(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_newWithHash(SymTable_HashFunction pfHash){
+    SymTable_T symtablenew;
+    size_t list;
+
+    symtablenew =(SymTable_T)malloc(sizeof(struct Stack));
+    if (symtablenew==NULL)
+    {
+        return NULL;
+    }
+
+    symtablenew->buckets=SymTable_newBuckets(INITIAL_BUCKETS);
+    if (symtablenew->buckets==NULL)
+    {
+        free(symtablenew);
+        return NULL;
+    }
+
+    symtablenew->slab=Slab_new();
+    if (symtablenew->slab==NULL)
+    {
+        free(symtablenew->buckets);
+        free(symtablenew);
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&symtablenew->writelock,NULL)!=0)
+    {
+        Slab_free(symtablenew->slab);
+        free(symtablenew->buckets);
+        free(symtablenew);
+        return NULL;
+    }
+
+    symtablenew->bindings=0;
+    symtablenew->hashfn=pfHash;
+    for (list = 0; list < LIMBO_LISTS; list++) {
+        symtablenew->limbonodes[list]=NULL;
+        symtablenew->limboarrays[list]=NULL;
+        symtablenew->limboepoch[list]=0;
+    }
+    symtablenew->retirecount=0;
+    return symtablenew;
+}
+
+SymTable_T SymTable_new(void){
+    return SymTable_newWithHash(NULL);
+}
+
+void SymTable_free(SymTable_T oSymTable){
+    size_t list;
+
+    assert(oSymTable!=NULL);
+
+    /* Retired nodes, like live ones, are freed with the slab. */
+    for (list = 0; list < LIMBO_LISTS; list++) {
+        oSymTable->limbonodes[list]=NULL;
+        SymTable_freeLimbo(oSymTable,list);
+    }
+    free(oSymTable->buckets);
+    Slab_free(oSymTable->slab);
+    pthread_mutex_destroy(&oSymTable->writelock);
+    free(oSymTable);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+
+    assert(oSymTable!=NULL);
+
+    return __atomic_load_n(&oSymTable->bindings,__ATOMIC_ACQUIRE);
+}
+
+/* Return the address of the link that points to the node holding
+   pcKey, whose hash is uHash and length is uLength, in poBuckets. If
+   there is no such node, return the address of the NULL link ending
+   its chain. Needs the writer lock, which keeps the link pointing
+   where it did. */
+static struct RcuNode **SymTable_find(struct RcuBuckets *poBuckets,
+    const char *pcKey, size_t uHash, size_t uLength) {
+    struct RcuNode **link;
+    struct RcuNode *currnode;
+
+    link=&SymTable_heads(poBuckets)[uHash&(poBuckets->count-1)];
+    for (currnode=*link; currnode!=NULL; currnode=*link)
+    {
+        if (currnode->hash==uHash&&currnode->length==uLength&&
+            memcmp(SymTable_key(currnode),pcKey,uLength)==0)
+        {
+            break;
+        }
+        link=&currnode->next;
+    }
+    return link;
+}
+
+/* Return the node holding pcKey, whose hash is uHash and length is
+   uLength, in the current bucket array of oSymTable, or NULL if there
+   is none. For readers: every link is loaded exactly once, since a
+   writer may change it between two loads. */
+static struct RcuNode *SymTable_search(SymTable_T oSymTable,
+    const char *pcKey, size_t uHash, size_t uLength) {
+    struct RcuBuckets *buckets;
+    struct RcuNode *currnode;
+
+    buckets=__atomic_load_n(&oSymTable->buckets,__ATOMIC_ACQUIRE);
+    for (currnode=__atomic_load_n(&SymTable_heads(buckets)[uHash&(buckets->count-1)],__ATOMIC_ACQUIRE);
+         currnode!=NULL; currnode=__atomic_load_n(&currnode->next,__ATOMIC_ACQUIRE))
+    {
+        if (currnode->hash==uHash&&currnode->length==uLength&&
+            memcmp(SymTable_key(currnode),pcKey,uLength)==0)
+        {
+            break;
+        }
+    }
+    return currnode;
+}
+
+/*Replaces the bucket array of oSymTable with one of uNewSize buckets
+holding copies of every node, and retires the old array and nodes.
+Readers already in the old array finish there undisturbed. Leaves
+oSymTable unchanged if memory allocation fails. Needs the writer
+lock. */
+static void SymTable_resize(SymTable_T oSymTable, size_t uNewSize) {
+    struct RcuBuckets *oldbuckets=oSymTable->buckets;
+    struct RcuBuckets *newbuckets;
+    struct RcuNode **newheads;
+    struct RcuNode *currnode;
+    struct RcuNode *copy;
+    size_t hashnum;
+    size_t index;
+    size_t list;
+
+    newbuckets=SymTable_newBuckets(uNewSize);
+    if (newbuckets==NULL)
+    {
+        return;
+    }
+    newheads=SymTable_heads(newbuckets);
+
+    for (index = 0; index < oldbuckets->count; index++) {
+        for (currnode=SymTable_heads(oldbuckets)[index]; currnode!=NULL; currnode=currnode->next) {
+            copy=(struct RcuNode*)Slab_alloc(oSymTable->slab,SymTable_nodeSize(currnode->length));
+            if (copy==NULL)
+            {
+                /* Nothing has been published, so the copies can go at
+                   once. */
+                for (index = 0; index < uNewSize; index++) {
+                    for (currnode=newheads[index]; currnode!=NULL; currnode=copy) {
+                        copy=currnode->next;
+                        Slab_release(oSymTable->slab,currnode,SymTable_nodeSize(currnode->length));
+                    }
+                }
+                free(newbuckets);
+                return;
+            }
+            memcpy(copy,currnode,SymTable_nodeSize(currnode->length));
+            hashnum=copy->hash&(uNewSize-1);
+            copy->next=newheads[hashnum];
+            newheads[hashnum]=copy;
+        }
+    }
+
+    /* Publish the new array, then retire the old one and its nodes. */
+    __atomic_store_n(&oSymTable->buckets,newbuckets,__ATOMIC_RELEASE);
+
+    list=SymTable_limbo(oSymTable);
+    for (index = 0; index < oldbuckets->count; index++) {
+        for (currnode=SymTable_heads(oldbuckets)[index]; currnode!=NULL; currnode=currnode->next) {
+            currnode->retired=oSymTable->limbonodes[list];
+            oSymTable->limbonodes[list]=currnode;
+        }
+    }
+    oldbuckets->retired=oSymTable->limboarrays[list];
+    oSymTable->limboarrays[list]=oldbuckets;
+    SymTable_reclaim(oSymTable);
+}
+
+int SymTable_put(SymTable_T oSymTable, const char *pcKey, const void *pvValue){
+    struct RcuNode *new;
+    struct RcuNode **link;
+    struct RcuNode **chain;
+    size_t length;
+    size_t hash;
+    size_t count;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    length=strlen(pcKey);
+    hash=SymTable_hash(oSymTable,pcKey,length);
+
+    pthread_mutex_lock(&oSymTable->writelock);
+
+    link=SymTable_find(oSymTable->buckets,pcKey,hash,length);
+    if (*link!=NULL)
+    {
+        pthread_mutex_unlock(&oSymTable->writelock);
+        return 0;
+    }
+
+    new=(struct RcuNode*)Slab_alloc(oSymTable->slab,SymTable_nodeSize(length));
+    if (new==NULL)
+    {
+        pthread_mutex_unlock(&oSymTable->writelock);
+        return 0;
+    }
+
+    /* The node is complete before the store that lets readers see
+       it. */
+    chain=&SymTable_heads(oSymTable->buckets)[hash&(oSymTable->buckets->count-1)];
+    memcpy((char*)SymTable_key(new),pcKey,length+1);
+    new->hash=hash;
+    new->length=length;
+    new->value=(void*)pvValue;
+    new->retired=NULL;
+    new->next=*chain;
+    __atomic_store_n(chain,new,__ATOMIC_RELEASE);
+
+    __atomic_store_n(&oSymTable->bindings,oSymTable->bindings+1,__ATOMIC_RELEASE);
+
+    count=oSymTable->buckets->count;
+    if (oSymTable->bindings>count&&count*2/2==count&&
+        count*2<=((size_t)-1-sizeof(struct RcuBuckets))/sizeof(struct RcuNode*))
+        SymTable_resize(oSymTable,count*2);
+
+    pthread_mutex_unlock(&oSymTable->writelock);
+    return 1;
+}
+
+void *SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue){
+    struct RcuNode *currnode;
+    void *oldval=NULL;
+    size_t length;
+    size_t hash;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    length=strlen(pcKey);
+    hash=SymTable_hash(oSymTable,pcKey,length);
+
+    pthread_mutex_lock(&oSymTable->writelock);
+    currnode=*SymTable_find(oSymTable->buckets,pcKey,hash,length);
+    if (currnode!=NULL)
+    {
+        oldval=currnode->value;
+        __atomic_store_n(&currnode->value,(void*)pvValue,__ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&oSymTable->writelock);
+
+    return oldval;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+    struct RcuReader *reader;
+    size_t length;
+    size_t hash;
+    int found;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    length=strlen(pcKey);
+    hash=SymTable_hash(oSymTable,pcKey,length);
+
+    reader=SymTable_beginRead();
+    found=SymTable_search(oSymTable,pcKey,hash,length)!=NULL;
+    SymTable_endRead(reader);
+
+    return found;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+    struct RcuReader *reader;
+    struct RcuNode *currnode;
+    void *value=NULL;
+    size_t length;
+    size_t hash;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    length=strlen(pcKey);
+    hash=SymTable_hash(oSymTable,pcKey,length);
+
+    reader=SymTable_beginRead();
+    currnode=SymTable_search(oSymTable,pcKey,hash,length);
+    if (currnode!=NULL)
+        value=__atomic_load_n(&currnode->value,__ATOMIC_ACQUIRE);
+    SymTable_endRead(reader);
+
+    return value;
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+    struct RcuNode *currnode;
+    struct RcuNode **link;
+    void *returni=NULL;
+    size_t length;
+    size_t hash;
+    size_t count;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    length=strlen(pcKey);
+    hash=SymTable_hash(oSymTable,pcKey,length);
+
+    pthread_mutex_lock(&oSymTable->writelock);
+
+    link=SymTable_find(oSymTable->buckets,pcKey,hash,length);
+    currnode=*link;
+    if (currnode!=NULL)
+    {
+        /* Readers already on the node still reach the rest of the
+           chain through its next pointer, which stays intact until the
+           node is freed. */
+        __atomic_store_n(link,currnode->next,__ATOMIC_RELEASE);
+        returni=currnode->value;
+        __atomic_store_n(&oSymTable->bindings,oSymTable->bindings-1,__ATOMIC_RELEASE);
+        SymTable_retireNode(oSymTable,currnode);
+
+        count=oSymTable->buckets->count;
+        if (count>INITIAL_BUCKETS&&oSymTable->bindings<count/SHRINK_LOAD_DIVISOR)
+            SymTable_resize(oSymTable,count/2);
+    }
+
+    pthread_mutex_unlock(&oSymTable->writelock);
+    return returni;
+}
+
+/* pfApply runs inside a read, so it may call any function on
+   oSymTable. It is given every binding present for the whole of the
+   call, and may or may not be given bindings put or removed while the
+   call runs. */
+void SymTable_map(SymTable_T oSymTable,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+
+    struct RcuReader *reader;
+    struct RcuBuckets *buckets;
+    struct RcuNode *currnode;
+    size_t index;
+
+    assert(oSymTable!=NULL);
+    assert(pfApply!=NULL);
+
+    reader=SymTable_beginRead();
+    buckets=__atomic_load_n(&oSymTable->buckets,__ATOMIC_ACQUIRE);
+
+    for (index = 0; index < buckets->count; index++) {
+        for (currnode=__atomic_load_n(&SymTable_heads(buckets)[index],__ATOMIC_ACQUIRE);
+             currnode!=NULL; currnode=__atomic_load_n(&currnode->next,__ATOMIC_ACQUIRE)){
+        (*pfApply)(SymTable_key(currnode),
+            __atomic_load_n(&currnode->value,__ATOMIC_ACQUIRE),(void*)pvExtra);
+        }
+    }
+
+    SymTable_endRead(reader);
+}
@@ -776,6 +776,75 @@ static void testCollisions(void)
 
 /*--------------------------------------------------------------------*/
 
+/* Return the same hash code for every key, so that every binding of a
+   SymTable object collides. */
+
+static size_t constantHash(const char *pcKey, size_t uLength)
+{
+   assert(pcKey != NULL);
+   (void)uLength;
+   return 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a SymTable object that uses a caller-supplied hash function. */
+
+static void testCustomHash(void)
+{
+   enum {KEY_COUNT = 600, MAX_KEY_LENGTH = 12};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   char acShortstop[] = "Shortstop";
+   char *pcValue;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object with a custom hash function.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_newWithHash(constantHash);
+   ASSURE(oSymTable != NULL);
+
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acShortstop);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT);
+
+   iSuccessful = SymTable_put(oSymTable, "17", acShortstop);
+   ASSURE(! iSuccessful);
+
+   pcValue = (char*)SymTable_get(oSymTable, "599");
+   ASSURE(pcValue == acShortstop);
+
+   pcValue = (char*)SymTable_get(oSymTable, "600");
+   ASSURE(pcValue == NULL);
+
+   pcValue = (char*)SymTable_remove(oSymTable, "0");
+   ASSURE(pcValue == acShortstop);
+   ASSURE(! SymTable_contains(oSymTable, "0"));
+   ASSURE(SymTable_contains(oSymTable, "1"));
+
+   SymTable_free(oSymTable);
+
+   /* A NULL hash function selects the default. */
+   oSymTable = SymTable_newWithHash(NULL);
+   ASSURE(oSymTable != NULL);
+   iSuccessful = SymTable_put(oSymTable, "Jeter", acShortstop);
+   ASSURE(iSuccessful);
+   pcValue = (char*)SymTable_get(oSymTable, "Jeter");
+   ASSURE(pcValue == acShortstop);
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
 /* Test the ability of a SymTable object to be large, that is, to
    contain iBindingCount bindings. Write the time consumed to stdout. */
 
@@ -960,6 +1029,7 @@ int main(int argc, char *argv[])
    testLongKey();
    testTableOfTables();
    testCollisions();
+   testCustomHash();
    testLargeTable(iBindingCount);
 
    printf("------------------------------------------------------\n");
@@ -0,0 +1,1087 @@
+/*--------------------------------------------------------------------*/
+/* testsymtableext.c                                                  */
+/* Author: Kevin Castro                                               */
+/*--------------------------------------------------------------------*/
+
+#include "symtable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <assert.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the functions that take length-delimited keys. */
+
+static void testLengthKeys(void)
+{
+   SymTable_T oSymTable;
+   char acBuffer[] = "Jeter Mantle Gehrig";
+   char acEmbedded[] = {'a', '\0', 'b'};
+   char acShortstop[] = "Shortstop";
+   char acCenterField[] = "Center Field";
+   char *pcValue;
+   int iSuccessful;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing length-delimited keys.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* Keys are slices of acBuffer, which is never modified. */
+   iSuccessful = SymTable_putn(oSymTable, acBuffer, 5, acShortstop);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putn(oSymTable, acBuffer + 6, 6, acCenterField);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putn(oSymTable, acBuffer, 5, acCenterField);
+   ASSURE(! iSuccessful);
+   ASSURE(SymTable_getLength(oSymTable) == 2);
+
+   /* A slice and a string with the same characters are the same key. */
+   pcValue = (char*)SymTable_get(oSymTable, "Jeter");
+   ASSURE(pcValue == acShortstop);
+   pcValue = (char*)SymTable_getn(oSymTable, "Mantle!", 6);
+   ASSURE(pcValue == acCenterField);
+   ASSURE(SymTable_containsn(oSymTable, acBuffer + 6, 6));
+   ASSURE(! SymTable_containsn(oSymTable, acBuffer + 6, 5));
+   ASSURE(! SymTable_containsn(oSymTable, acBuffer, 0));
+
+   pcValue = (char*)SymTable_replacen(oSymTable, acBuffer, 5,
+      acCenterField);
+   ASSURE(pcValue == acShortstop);
+   pcValue = (char*)SymTable_replacen(oSymTable, acBuffer + 13, 6,
+      acCenterField);
+   ASSURE(pcValue == NULL);
+
+   /* Keys may contain '\0' bytes. */
+   iSuccessful = SymTable_putn(oSymTable, acEmbedded, 3, acShortstop);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_containsn(oSymTable, acEmbedded, 3));
+   ASSURE(! SymTable_contains(oSymTable, "a"));
+
+   pcValue = (char*)SymTable_removen(oSymTable, acEmbedded, 3);
+   ASSURE(pcValue == acShortstop);
+   pcValue = (char*)SymTable_removen(oSymTable, acBuffer, 5);
+   ASSURE(pcValue == acCenterField);
+   pcValue = (char*)SymTable_remove(oSymTable, "Mantle");
+   ASSURE(pcValue == acCenterField);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a hash code that depends only on the length of the key. */
+
+static size_t lengthHash(const char *pcKey, size_t uLength)
+{
+   assert(pcKey != NULL);
+   return uLength;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test keys whose hash is computed once and reused across tables. */
+
+static void testPreparedKeys(int iBindingCount)
+{
+   enum {SCOPE_COUNT = 8, MAX_KEY_LENGTH = 12};
+
+   SymTable_T aoScopes[SCOPE_COUNT];
+   SymTable_T oSymTable;
+   struct SymTable_Key sKey;
+   struct SymTable_Key sMissing;
+   char acKey[MAX_KEY_LENGTH];
+   char acShortstop[] = "Shortstop";
+   char *pcValue;
+   int iSuccessful;
+   int i;
+   int j;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing prepared keys.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   SymTable_prepareKey(&sKey, "Jeter", 5, NULL);
+   SymTable_prepareKey(&sMissing, "Maris", 5, NULL);
+
+   /* Enough other bindings to make every table resize, so the
+      prepared key has to survive new bucket counts. */
+   for (i = 0; i < SCOPE_COUNT; i++)
+   {
+      aoScopes[i] = SymTable_new();
+      ASSURE(aoScopes[i] != NULL);
+      for (j = 0; j < iBindingCount / SCOPE_COUNT; j++)
+      {
+         sprintf(acKey, "%d", j);
+         iSuccessful = SymTable_put(aoScopes[i], acKey, NULL);
+         ASSURE(iSuccessful);
+      }
+      if (i % 2 == 0)
+      {
+         iSuccessful = SymTable_putPrepared(aoScopes[i], &sKey,
+            aoScopes[i]);
+         ASSURE(iSuccessful);
+         iSuccessful = SymTable_putPrepared(aoScopes[i], &sKey, NULL);
+         ASSURE(! iSuccessful);
+      }
+   }
+
+   for (i = 0; i < SCOPE_COUNT; i++)
+   {
+      pcValue = (char*)SymTable_getPrepared(aoScopes[i], &sKey);
+      ASSURE(pcValue == (i % 2 == 0 ? (char*)aoScopes[i] : NULL));
+      pcValue = (char*)SymTable_get(aoScopes[i], "Jeter");
+      ASSURE(pcValue == (i % 2 == 0 ? (char*)aoScopes[i] : NULL));
+      pcValue = (char*)SymTable_getPrepared(aoScopes[i], &sMissing);
+      ASSURE(pcValue == NULL);
+   }
+   for (i = 0; i < SCOPE_COUNT; i++)
+      SymTable_free(aoScopes[i]);
+
+   /* A key prepared for one hash function still works with a table
+      that uses another. */
+   oSymTable = SymTable_newWithHash(lengthHash);
+   ASSURE(oSymTable != NULL);
+   iSuccessful = SymTable_putPrepared(oSymTable, &sKey, acShortstop);
+   ASSURE(iSuccessful);
+   pcValue = (char*)SymTable_get(oSymTable, "Jeter");
+   ASSURE(pcValue == acShortstop);
+   SymTable_prepareKey(&sKey, "Jeter", 5, lengthHash);
+   pcValue = (char*)SymTable_getPrepared(oSymTable, &sKey);
+   ASSURE(pcValue == acShortstop);
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_upsert() and SymTable_getOrPut(). */
+
+static void testUpsert(void)
+{
+   SymTable_T oSymTable;
+   char acShortstop[] = "Shortstop";
+   char acCenterField[] = "Center Field";
+   char *pcValue;
+   int iAdded;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_upsert() and SymTable_getOrPut().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   pcValue = (char*)SymTable_upsert(oSymTable, "Jeter", acShortstop,
+      &iAdded);
+   ASSURE(pcValue == NULL);
+   ASSURE(iAdded == 1);
+   ASSURE(SymTable_getLength(oSymTable) == 1);
+
+   pcValue = (char*)SymTable_upsert(oSymTable, "Jeter", acCenterField,
+      &iAdded);
+   ASSURE(pcValue == acShortstop);
+   ASSURE(iAdded == 0);
+   ASSURE(SymTable_getLength(oSymTable) == 1);
+   ASSURE(SymTable_get(oSymTable, "Jeter") == acCenterField);
+
+   /* A binding whose value is NULL is still reported as existing. */
+   pcValue = (char*)SymTable_upsert(oSymTable, "Brown", NULL, NULL);
+   ASSURE(pcValue == NULL);
+   pcValue = (char*)SymTable_upsert(oSymTable, "Brown", acShortstop,
+      &iAdded);
+   ASSURE(pcValue == NULL);
+   ASSURE(iAdded == 0);
+
+   pcValue = (char*)SymTable_getOrPut(oSymTable, "Jeter", acShortstop,
+      &iAdded);
+   ASSURE(pcValue == acCenterField);
+   ASSURE(iAdded == 0);
+
+   pcValue = (char*)SymTable_getOrPut(oSymTable, "Mantle",
+      acCenterField, &iAdded);
+   ASSURE(pcValue == acCenterField);
+   ASSURE(iAdded == 1);
+   ASSURE(SymTable_getLength(oSymTable) == 3);
+   ASSURE(SymTable_get(oSymTable, "Mantle") == acCenterField);
+
+   pcValue = (char*)SymTable_getOrPut(oSymTable, "Mantle", acShortstop,
+      NULL);
+   ASSURE(pcValue == acCenterField);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_newWithCapacity() and SymTable_reserve() with
+   iBindingCount bindings. */
+
+static void testCapacity(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 12};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   char acShortstop[] = "Shortstop";
+   char *pcValue;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_newWithCapacity() and SymTable_reserve().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_newWithCapacity((size_t)iBindingCount);
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acShortstop);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == (size_t)iBindingCount);
+
+   /* Reserving more room keeps every existing binding. */
+   iSuccessful = SymTable_reserve(oSymTable, (size_t)iBindingCount * 4);
+   ASSURE(iSuccessful);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      pcValue = (char*)SymTable_get(oSymTable, acKey);
+      ASSURE(pcValue == acShortstop);
+   }
+
+   /* So does reserving less room than the table already has. */
+   iSuccessful = SymTable_reserve(oSymTable, 0);
+   ASSURE(iSuccessful);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      pcValue = (char*)SymTable_remove(oSymTable, acKey);
+      ASSURE(pcValue == acShortstop);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the index that the i-th of iCount lookups uses, so that
+   consecutive lookups visit keys far apart. */
+
+static int scatter(int i, int iCount)
+{
+   return (int)((unsigned long)i * 7919UL % (unsigned long)iCount);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_getBatch() and SymTable_containsBatch() on a table
+   with iBindingCount bindings. Write the time consumed by batched and
+   unbatched lookups to stdout. */
+
+static void testBatchLookup(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 12, BATCH_SIZE = 64};
+
+   SymTable_T oSymTable;
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   const char *apcBatch[BATCH_SIZE];
+   void *apvValues[BATCH_SIZE];
+   int aiFound[BATCH_SIZE];
+   int iSuccessful;
+   int i;
+   int j;
+   int iLookups;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+   clock_t iBatchClock;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_getBatch() and SymTable_containsBatch().\n");
+   printf("No output except CPU time consumed should appear here:\n");
+   fflush(stdout);
+
+   /* Twice as many keys as bindings: the odd-numbered ones are
+      missing from the table. */
+   iLookups = 2 * iBindingCount + 1;
+   pacKeys = (char(*)[MAX_KEY_LENGTH])malloc(
+      (size_t)iLookups * MAX_KEY_LENGTH);
+   ASSURE(pacKeys != NULL);
+   if (pacKeys == NULL)
+      return;
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < iLookups; i++)
+   {
+      sprintf(pacKeys[i], "%d", i);
+      if (i % 2 == 0)
+      {
+         iSuccessful = SymTable_put(oSymTable, pacKeys[i], pacKeys[i]);
+         ASSURE(iSuccessful);
+      }
+   }
+
+   /* Look the keys up in a scattered order so that neighbouring keys
+      in a batch land in unrelated buckets. */
+   iInitialClock = clock();
+   for (i = 0; i < iLookups; i += BATCH_SIZE)
+   {
+      int iCount = iLookups - i < BATCH_SIZE ? iLookups - i : BATCH_SIZE;
+      for (j = 0; j < iCount; j++)
+         apcBatch[j] = pacKeys[scatter(i + j, iLookups)];
+      SymTable_getBatch(oSymTable, apcBatch, (size_t)iCount, apvValues);
+      SymTable_containsBatch(oSymTable, apcBatch, (size_t)iCount,
+         aiFound);
+      for (j = 0; j < iCount; j++)
+      {
+         int iKey = scatter(i + j, iLookups);
+         ASSURE(apvValues[j] == (iKey % 2 == 0 ? pacKeys[iKey] : NULL));
+         ASSURE(aiFound[j] == (iKey % 2 == 0));
+      }
+   }
+   iBatchClock = clock();
+
+   for (i = 0; i < iLookups; i++)
+   {
+      int iKey = scatter(i, iLookups);
+      void *pvValue = SymTable_get(oSymTable, pacKeys[iKey]);
+      int iFound = SymTable_contains(oSymTable, pacKeys[iKey]);
+      ASSURE(pvValue == (iKey % 2 == 0 ? pacKeys[iKey] : NULL));
+      ASSURE(iFound == (iKey % 2 == 0));
+   }
+   iFinalClock = clock();
+
+   /* An empty batch is allowed. */
+   SymTable_getBatch(oSymTable, apcBatch, 0, apvValues);
+
+   printf("CPU time (%d lookups, batched):  %f seconds\n", iLookups,
+      ((double)(iBatchClock - iInitialClock)) / CLOCKS_PER_SEC);
+   printf("CPU time (%d lookups, one at a time):  %f seconds\n",
+      iLookups, ((double)(iFinalClock - iBatchClock)) / CLOCKS_PER_SEC);
+   fflush(stdout);
+
+   SymTable_free(oSymTable);
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_putBatch() with iBindingCount distinct keys, loading
+   them with one thread and then with several. Write the time consumed
+   by each load to stdout. */
+
+static void testPutBatch(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 12, THREAD_RUNS = 2};
+
+   static const size_t auThreads[THREAD_RUNS] = {1, 4};
+   static char acOld[] = "old";
+   SymTable_T oSymTable;
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   const char **ppcBatch;
+   const void **ppvValues;
+   int *piResults;
+   int iPreloaded;
+   int iRepeated;
+   int iBatchCount;
+   int iSuccessful;
+   int iRun;
+   int i;
+   size_t uAdded;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_putBatch().\n");
+   printf("No output except CPU time consumed should appear here:\n");
+   fflush(stdout);
+
+   /* The first quarter of the keys is already bound, and an eighth of
+      them appear a second time at the end of the batch. */
+   iPreloaded = iBindingCount / 4;
+   iRepeated = iBindingCount / 8;
+   iBatchCount = iBindingCount + iRepeated;
+   pacKeys = (char(*)[MAX_KEY_LENGTH])malloc(
+      (size_t)iBindingCount * MAX_KEY_LENGTH);
+   ppcBatch = (const char**)malloc(
+      (size_t)iBatchCount * sizeof(const char*));
+   ppvValues = (const void**)malloc(
+      (size_t)iBatchCount * sizeof(const void*));
+   piResults = (int*)malloc((size_t)iBatchCount * sizeof(int));
+   ASSURE(pacKeys != NULL && ppcBatch != NULL && ppvValues != NULL
+      && piResults != NULL);
+   if (pacKeys == NULL || ppcBatch == NULL || ppvValues == NULL
+       || piResults == NULL)
+      return;
+
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(pacKeys[i], "%d", i);
+      ppcBatch[i] = pacKeys[i];
+      ppvValues[i] = pacKeys[i];
+   }
+   for (i = 0; i < iRepeated; i++)
+   {
+      ppcBatch[iBindingCount + i] = pacKeys[iBindingCount / 2 + i];
+      ppvValues[iBindingCount + i] = acOld;
+   }
+
+   for (iRun = 0; iRun < THREAD_RUNS; iRun++)
+   {
+      oSymTable = SymTable_new();
+      ASSURE(oSymTable != NULL);
+      for (i = 0; i < iPreloaded; i++)
+      {
+         iSuccessful = SymTable_put(oSymTable, pacKeys[i], acOld);
+         ASSURE(iSuccessful);
+      }
+
+      iInitialClock = clock();
+      uAdded = SymTable_putBatch(oSymTable, ppcBatch, ppvValues,
+         (size_t)iBatchCount, auThreads[iRun], piResults);
+      iFinalClock = clock();
+
+      ASSURE(uAdded == (size_t)(iBindingCount - iPreloaded));
+      ASSURE(SymTable_getLength(oSymTable) == (size_t)iBindingCount);
+      for (i = 0; i < iBatchCount; i++)
+         ASSURE(piResults[i] == (i >= iPreloaded && i < iBindingCount));
+      for (i = 0; i < iBindingCount; i++)
+         ASSURE(SymTable_get(oSymTable, pacKeys[i])
+            == (i < iPreloaded ? acOld : pacKeys[i]));
+
+      /* The table stays fully usable after a batch. */
+      for (i = 0; i < iBindingCount; i += 2)
+         ASSURE(SymTable_remove(oSymTable, pacKeys[i]) != NULL);
+      ASSURE(SymTable_getLength(oSymTable)
+         == (size_t)(iBindingCount / 2));
+      for (i = 0; i < iBindingCount; i++)
+         ASSURE(SymTable_contains(oSymTable, pacKeys[i]) == (i % 2));
+
+      printf("CPU time (%d keys, %lu threads):  %f seconds\n",
+         iBatchCount, (unsigned long)auThreads[iRun],
+         ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+      fflush(stdout);
+      SymTable_free(oSymTable);
+   }
+
+   /* An empty batch adds nothing. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_putBatch(oSymTable, ppcBatch, ppvValues, 0, 4,
+      piResults) == 0);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   SymTable_free(oSymTable);
+
+   free(piResults);
+   free(ppvValues);
+   free(ppcBatch);
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The running totals of one thread of SymTable_mapParallel(). */
+
+struct MapTotals
+{
+   long lBindings;
+   long lKeySum;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Add the binding whose key is pcKey, a decimal numeral, and whose
+   value is pcKey itself to *pvExtra, a struct MapTotals. */
+
+static void totalBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   struct MapTotals *psTotals = (struct MapTotals*)pvExtra;
+
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+
+   ASSURE(pvValue == (void*)pcKey || strcmp((char*)pvValue, pcKey) == 0);
+   psTotals->lBindings++;
+   psTotals->lKeySum += atol(pcKey);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_mapParallel() on a table with iBindingCount bindings,
+   before and after removing some of them. Write the time consumed to
+   stdout. */
+
+static void testMapParallel(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 12, THREAD_COUNT = 4};
+
+   SymTable_T oSymTable;
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   struct MapTotals asTotals[THREAD_COUNT];
+   const void *apvExtra[THREAD_COUNT];
+   long lBindings;
+   long lKeySum;
+   long lExpectedSum;
+   int iSuccessful;
+   int iRemoved;
+   int i;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_mapParallel().\n");
+   printf("No output except CPU time consumed should appear here:\n");
+   fflush(stdout);
+
+   pacKeys = (char(*)[MAX_KEY_LENGTH])malloc(
+      (size_t)(iBindingCount > 0 ? iBindingCount : 1) * MAX_KEY_LENGTH);
+   ASSURE(pacKeys != NULL);
+   if (pacKeys == NULL)
+      return;
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   lExpectedSum = 0;
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(pacKeys[i], "%d", i);
+      iSuccessful = SymTable_put(oSymTable, pacKeys[i], pacKeys[i]);
+      ASSURE(iSuccessful);
+      lExpectedSum += i;
+   }
+   for (i = 0; i < THREAD_COUNT; i++)
+      apvExtra[i] = &asTotals[i];
+
+   /* Once on the full table, which may be in the middle of a resize,
+      then again after removing every third binding. */
+   for (iRemoved = 0; iRemoved <= 1; iRemoved++)
+   {
+      for (i = 0; i < THREAD_COUNT; i++)
+      {
+         asTotals[i].lBindings = 0;
+         asTotals[i].lKeySum = 0;
+      }
+
+      iInitialClock = clock();
+      SymTable_mapParallel(oSymTable, totalBinding, apvExtra,
+         THREAD_COUNT);
+      iFinalClock = clock();
+
+      lBindings = 0;
+      lKeySum = 0;
+      for (i = 0; i < THREAD_COUNT; i++)
+      {
+         lBindings += asTotals[i].lBindings;
+         lKeySum += asTotals[i].lKeySum;
+      }
+      ASSURE(lBindings == (long)SymTable_getLength(oSymTable));
+      ASSURE(lKeySum == lExpectedSum);
+
+      printf("CPU time (%ld bindings, %d threads):  %f seconds\n",
+         lBindings, THREAD_COUNT,
+         ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+      fflush(stdout);
+
+      if (iRemoved)
+         continue;
+      for (i = 0; i < iBindingCount; i += 3)
+      {
+         ASSURE(SymTable_remove(oSymTable, pacKeys[i]) == pacKeys[i]);
+         lExpectedSum -= i;
+      }
+   }
+
+   SymTable_free(oSymTable);
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_iterBegin(), SymTable_iterNext() and SymTable_iterEnd()
+   on a table with iBindingCount bindings, then on the same table once
+   most of them are removed, so that most buckets are empty. */
+
+static void testIterator(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 12};
+
+   SymTable_T oSymTable;
+   struct SymTable_Iter sIter;
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   const char *pcKey;
+   void *pvValue;
+   long lVisited;
+   long lKeySum;
+   long lExpectedSum;
+   int iSuccessful;
+   int iPass;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the SymTable iterator.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* An empty table has nothing to visit. */
+   SymTable_iterBegin(oSymTable, &sIter);
+   ASSURE(! SymTable_iterNext(&sIter, &pcKey, &pvValue));
+   ASSURE(! SymTable_iterNext(&sIter, NULL, NULL));
+   SymTable_iterEnd(&sIter);
+
+   pacKeys = (char(*)[MAX_KEY_LENGTH])malloc(
+      (size_t)(iBindingCount > 0 ? iBindingCount : 1) * MAX_KEY_LENGTH);
+   ASSURE(pacKeys != NULL);
+   if (pacKeys == NULL)
+      return;
+   lExpectedSum = 0;
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(pacKeys[i], "%d", i);
+      iSuccessful = SymTable_put(oSymTable, pacKeys[i], pacKeys[i]);
+      ASSURE(iSuccessful);
+      lExpectedSum += i;
+   }
+
+   /* The full table may be in the middle of a resize; after most of
+      the bindings are removed, most buckets are empty. */
+   for (iPass = 0; iPass <= 1; iPass++)
+   {
+      lVisited = 0;
+      lKeySum = 0;
+      SymTable_iterBegin(oSymTable, &sIter);
+      while (SymTable_iterNext(&sIter, &pcKey, &pvValue))
+      {
+         ASSURE(pvValue == pacKeys[atoi(pcKey)]);
+         ASSURE(strcmp(pcKey, (char*)pvValue) == 0);
+         lVisited++;
+         lKeySum += atol(pcKey);
+      }
+      ASSURE(! SymTable_iterNext(&sIter, &pcKey, &pvValue));
+      SymTable_iterEnd(&sIter);
+      ASSURE(lVisited == (long)SymTable_getLength(oSymTable));
+      ASSURE(lKeySum == lExpectedSum);
+
+      if (iPass)
+         continue;
+      for (i = 0; i < iBindingCount; i++)
+      {
+         if (i % 16 == 0)
+            continue;
+         ASSURE(SymTable_remove(oSymTable, pacKeys[i]) == pacKeys[i]);
+         lExpectedSum -= i;
+      }
+   }
+
+   /* Stop at the first binding with an even key, replacing values
+      along the way. */
+   lVisited = 0;
+   SymTable_iterBegin(oSymTable, &sIter);
+   while (SymTable_iterNext(&sIter, &pcKey, NULL))
+   {
+      lVisited++;
+      ASSURE(SymTable_replace(oSymTable, pcKey, pacKeys[0])
+         == pacKeys[atoi(pcKey)]);
+      if (atoi(pcKey) % 2 == 0)
+         break;
+   }
+   SymTable_iterEnd(&sIter);
+   ASSURE(lVisited == (iBindingCount > 0 ? 1 : 0));
+
+   SymTable_free(oSymTable);
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Add 1 to the int pointed to by pvExtra. */
+
+static void countBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+
+   (void)pvValue;
+   (*(int*)pvExtra)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_pushScope(), SymTable_popScope(),
+   SymTable_putScoped(), and SymTable_getScoped(), with about
+   iBindingCount bindings spread over nested scopes. */
+
+static void testScopes(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 24, KEYS_PER_SCOPE = 100};
+
+   SymTable_T oSymTable;
+   char acGlobal[] = "global";
+   char acOuter[] = "outer";
+   char acInner[] = "inner";
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   char *pcValue;
+   size_t uDepth;
+   int iScopes;
+   int iCount;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing nested scopes.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* The outermost scope cannot be popped, and SymTable_putScoped
+      there is SymTable_put. */
+   ASSURE(! SymTable_popScope(oSymTable));
+   iSuccessful = SymTable_putScoped(oSymTable, "x", acGlobal);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putScoped(oSymTable, "x", acOuter);
+   ASSURE(! iSuccessful);
+   pcValue = (char*)SymTable_getScoped(oSymTable, "x", &uDepth);
+   ASSURE(pcValue == acGlobal);
+   ASSURE(uDepth == 0);
+
+   /* An inner binding hides an outer one, and counts once. */
+   ASSURE(SymTable_pushScope(oSymTable));
+   iSuccessful = SymTable_putScoped(oSymTable, "x", acOuter);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putScoped(oSymTable, "x", acInner);
+   ASSURE(! iSuccessful);
+   pcValue = (char*)SymTable_getScoped(oSymTable, "x", &uDepth);
+   ASSURE(pcValue == acOuter);
+   ASSURE(uDepth == 1);
+   ASSURE(SymTable_get(oSymTable, "x") == acOuter);
+   ASSURE(SymTable_getLength(oSymTable) == 1);
+   iSuccessful = SymTable_put(oSymTable, "x", acInner);
+   ASSURE(! iSuccessful);
+
+   ASSURE(SymTable_pushScope(oSymTable));
+   iSuccessful = SymTable_putScoped(oSymTable, "y", acInner);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putScoped(oSymTable, "x", acInner);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_getScoped(oSymTable, "x", NULL) == acInner);
+   ASSURE(SymTable_getLength(oSymTable) == 2);
+   iCount = 0;
+   SymTable_map(oSymTable, countBinding, &iCount);
+   ASSURE(iCount == 2);
+
+   /* A binding put by SymTable_put belongs to the outermost scope, so
+      it outlives the scope it was put in. */
+   iSuccessful = SymTable_put(oSymTable, "z", acGlobal);
+   ASSURE(iSuccessful);
+
+   ASSURE(SymTable_popScope(oSymTable));
+   ASSURE(SymTable_getScoped(oSymTable, "x", &uDepth) == acOuter);
+   ASSURE(uDepth == 1);
+   ASSURE(! SymTable_contains(oSymTable, "y"));
+   ASSURE(SymTable_getScoped(oSymTable, "z", &uDepth) == acGlobal);
+   ASSURE(uDepth == 0);
+
+   /* Removing the inner binding uncovers the outer one, and popping
+      the scope afterwards leaves it alone. */
+   pcValue = (char*)SymTable_remove(oSymTable, "x");
+   ASSURE(pcValue == acOuter);
+   ASSURE(SymTable_getScoped(oSymTable, "x", &uDepth) == acGlobal);
+   ASSURE(uDepth == 0);
+   ASSURE(SymTable_popScope(oSymTable));
+   ASSURE(SymTable_get(oSymTable, "x") == acGlobal);
+   ASSURE(SymTable_getLength(oSymTable) == 2);
+   ASSURE(! SymTable_popScope(oSymTable));
+
+   SymTable_free(oSymTable);
+
+   /* Nest many scopes, each binding its own keys and hiding the
+      previous scope's binding of a shared key, then unwind them. */
+   iScopes = iBindingCount / KEYS_PER_SCOPE + 1;
+   pacKeys = (char(*)[MAX_KEY_LENGTH])
+      malloc((size_t)iScopes * KEYS_PER_SCOPE * MAX_KEY_LENGTH);
+   ASSURE(pacKeys != NULL);
+   if (pacKeys == NULL)
+      return;
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   iSuccessful = SymTable_put(oSymTable, "shared", acGlobal);
+   ASSURE(iSuccessful);
+
+   for (i = 0; i < iScopes * KEYS_PER_SCOPE; i++)
+   {
+      sprintf(pacKeys[i], "scope%d.key%d", i / KEYS_PER_SCOPE, i);
+      if (i % KEYS_PER_SCOPE == 0)
+      {
+         ASSURE(SymTable_pushScope(oSymTable));
+         iSuccessful = SymTable_putScoped(oSymTable, "shared",
+            pacKeys[i]);
+         ASSURE(iSuccessful);
+      }
+      iSuccessful = SymTable_putScoped(oSymTable, pacKeys[i],
+         pacKeys[i]);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(SymTable_getLength(oSymTable)
+      == (size_t)(iScopes * KEYS_PER_SCOPE) + 1);
+
+   for (i = iScopes - 1; i >= 0; i--)
+   {
+      pcValue = (char*)SymTable_getScoped(oSymTable, "shared", &uDepth);
+      ASSURE(pcValue == pacKeys[i * KEYS_PER_SCOPE]);
+      ASSURE(uDepth == (size_t)(i + 1));
+      ASSURE(SymTable_getScoped(oSymTable,
+         pacKeys[i * KEYS_PER_SCOPE + KEYS_PER_SCOPE - 1], &uDepth)
+         == pacKeys[i * KEYS_PER_SCOPE + KEYS_PER_SCOPE - 1]);
+      ASSURE(uDepth == (size_t)(i + 1));
+      ASSURE(SymTable_popScope(oSymTable));
+      ASSURE(! SymTable_contains(oSymTable, pacKeys[i * KEYS_PER_SCOPE]));
+      ASSURE(SymTable_getLength(oSymTable)
+         == (size_t)(i * KEYS_PER_SCOPE) + 1);
+   }
+   ASSURE(SymTable_get(oSymTable, "shared") == acGlobal);
+   ASSURE(! SymTable_popScope(oSymTable));
+
+   /* Empty scopes between full ones still count toward a binding's
+      depth. */
+   ASSURE(SymTable_pushScope(oSymTable));
+   ASSURE(SymTable_pushScope(oSymTable));
+   iSuccessful = SymTable_putScoped(oSymTable, "shared", acOuter);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_pushScope(oSymTable));
+   ASSURE(SymTable_pushScope(oSymTable));
+   iSuccessful = SymTable_putScoped(oSymTable, "shared", acInner);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putScoped(oSymTable, "shared", acGlobal);
+   ASSURE(! iSuccessful);
+   ASSURE(SymTable_getScoped(oSymTable, "shared", &uDepth) == acInner);
+   ASSURE(uDepth == 4);
+   ASSURE(SymTable_popScope(oSymTable));
+   ASSURE(SymTable_getScoped(oSymTable, "shared", &uDepth) == acOuter);
+   ASSURE(uDepth == 2);
+   iSuccessful = SymTable_putScoped(oSymTable, "shared", acInner);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_getScoped(oSymTable, "shared", &uDepth) == acInner);
+   ASSURE(uDepth == 3);
+   ASSURE(SymTable_popScope(oSymTable));
+   ASSURE(SymTable_popScope(oSymTable));
+   ASSURE(SymTable_popScope(oSymTable));
+   ASSURE(SymTable_getScoped(oSymTable, "shared", &uDepth) == acGlobal);
+   ASSURE(uDepth == 0);
+
+   /* One wide scope: remove every other binding one at a time, each
+      of which drops its own undo log entry, then pop the rest. */
+   ASSURE(SymTable_pushScope(oSymTable));
+   for (i = 0; i < iScopes * KEYS_PER_SCOPE; i++)
+   {
+      iSuccessful = SymTable_putScoped(oSymTable, pacKeys[i],
+         pacKeys[i]);
+      ASSURE(iSuccessful);
+   }
+   for (i = 0; i < iScopes * KEYS_PER_SCOPE; i += 2)
+      ASSURE(SymTable_remove(oSymTable, pacKeys[i]) == pacKeys[i]);
+   ASSURE(SymTable_getLength(oSymTable)
+      == (size_t)(iScopes * KEYS_PER_SCOPE / 2) + 1);
+   ASSURE(SymTable_popScope(oSymTable));
+   ASSURE(SymTable_getLength(oSymTable) == 1);
+   ASSURE(! SymTable_contains(oSymTable, pacKeys[1]));
+   iCount = 0;
+   SymTable_map(oSymTable, countBinding, &iCount);
+   ASSURE(iCount == 1);
+
+   SymTable_free(oSymTable);
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_clone() on a table of iBindingCount bindings, on an
+   empty table, and on a table with nested scopes. Write the CPU time
+   the clone took to stdout. */
+
+static void testClone(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 12};
+
+   SymTable_T oSymTable;
+   SymTable_T oClone;
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   char acGlobal[] = "global";
+   char acInner[] = "inner";
+   size_t uDepth;
+   int iCount;
+   int iSuccessful;
+   int i;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_clone().\n");
+   printf("No output except CPU time consumed should appear here:\n");
+   fflush(stdout);
+
+   pacKeys = (char(*)[MAX_KEY_LENGTH])
+      calloc((size_t)iBindingCount + 1, MAX_KEY_LENGTH);
+   ASSURE(pacKeys != NULL);
+   if (pacKeys == NULL)
+      return;
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* An empty table clones to an empty table. */
+   oClone = SymTable_clone(oSymTable);
+   ASSURE(oClone != NULL);
+   ASSURE(SymTable_getLength(oClone) == 0);
+   SymTable_free(oClone);
+
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(pacKeys[i], "%d", i);
+      iSuccessful = SymTable_put(oSymTable, pacKeys[i], pacKeys[i]);
+      ASSURE(iSuccessful);
+   }
+
+   iInitialClock = clock();
+   oClone = SymTable_clone(oSymTable);
+   iFinalClock = clock();
+   ASSURE(oClone != NULL);
+   printf("CPU time (%d bindings): %f seconds\n", iBindingCount,
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+
+   ASSURE(SymTable_getLength(oClone) == (size_t)iBindingCount);
+   iCount = 0;
+   SymTable_map(oClone, countBinding, &iCount);
+   ASSURE(iCount == iBindingCount);
+   for (i = 0; i < iBindingCount; i++)
+      ASSURE(SymTable_get(oClone, pacKeys[i]) == pacKeys[i]);
+
+   /* The two tables change independently. */
+   for (i = 0; i < iBindingCount; i += 2)
+      ASSURE(SymTable_remove(oClone, pacKeys[i]) == pacKeys[i]);
+   iSuccessful = SymTable_put(oClone, "clone", acInner);
+   ASSURE(iSuccessful);
+   if (iBindingCount > 1)
+      ASSURE(SymTable_replace(oSymTable, pacKeys[1], acGlobal)
+         == pacKeys[1]);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      ASSURE(SymTable_contains(oSymTable, pacKeys[i]));
+      ASSURE(SymTable_contains(oClone, pacKeys[i]) == (i % 2 == 1));
+   }
+   if (iBindingCount > 1)
+      ASSURE(SymTable_get(oClone, pacKeys[1]) == pacKeys[1]);
+   ASSURE(! SymTable_contains(oSymTable, "clone"));
+   ASSURE(SymTable_getLength(oClone)
+      == (size_t)(iBindingCount / 2) + 1);
+   SymTable_free(oClone);
+
+   /* The clone of a table with scopes holds the visible bindings in
+      its outermost scope. */
+   iSuccessful = SymTable_put(oSymTable, "x", acGlobal);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_pushScope(oSymTable));
+   iSuccessful = SymTable_putScoped(oSymTable, "x", acInner);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putScoped(oSymTable, "y", acInner);
+   ASSURE(iSuccessful);
+   oClone = SymTable_clone(oSymTable);
+   ASSURE(oClone != NULL);
+   ASSURE(! SymTable_popScope(oClone));
+   ASSURE(SymTable_getScoped(oClone, "x", &uDepth) == acInner);
+   ASSURE(uDepth == 0);
+   ASSURE(SymTable_remove(oClone, "x") == acInner);
+   ASSURE(! SymTable_contains(oClone, "x"));
+   ASSURE(SymTable_get(oClone, "y") == acInner);
+   ASSURE(SymTable_getLength(oClone) == (size_t)iBindingCount + 1);
+   SymTable_free(oClone);
+
+   ASSURE(SymTable_popScope(oSymTable));
+   ASSURE(SymTable_get(oSymTable, "x") == acGlobal);
+   ASSURE(! SymTable_contains(oSymTable, "y"));
+
+   SymTable_free(oSymTable);
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the SymTable extensions.  Write the output of the tests to
+   stdout.  As always, argc is the command-line argument count, argv
+   contains the command-line arguments, and argv[0] is the name of the
+   executable binary file. argv[1] is the number of bindings to put
+   into a potentially large SymTable object.  Exit with EXIT_FAILURE
+   if argv[1] is missing or not numeric.  Otherwise return 0. */
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+
+   if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s bindingcount\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1)
+   {
+      fprintf(stderr, "bindingcount must be numeric\n");
+      exit(EXIT_FAILURE);
+   }
+   if (iBindingCount < 0)
+   {
+      fprintf(stderr, "bindingcount cannot be negative\n");
+      exit(EXIT_FAILURE);
+   }
+
+   testLengthKeys();
+   testPreparedKeys(iBindingCount);
+   testUpsert();
+   testCapacity(iBindingCount);
+   testBatchLookup(iBindingCount);
+   testPutBatch(iBindingCount);
+   testMapParallel(iBindingCount);
+   testIterator(iBindingCount);
+   testScopes(iBindingCount);
+   testClone(iBindingCount);
+
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}
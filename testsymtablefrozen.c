@@ -0,0 +1,374 @@
+/*--------------------------------------------------------------------*/
+/* testsymtablefrozen.c                                               */
+/* Author: Kevin Castro                                               */
+/*--------------------------------------------------------------------*/
+
+#include "symtablefrozen.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <assert.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/* Length of the buffer each test key is printed into. */
+enum {MAX_KEY_LENGTH = 16};
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Add 1 to the int pointed to by pvExtra, checking that the value of
+   the binding is its key. */
+
+static void countBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+
+   ASSURE(pvValue == NULL || strcmp((char*)pvValue, pcKey) == 0);
+   (*(int*)pvExtra)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the same hash code for every key. */
+
+static size_t hashConstant(const char *pcKey, size_t uLength)
+{
+   assert(pcKey != NULL);
+   (void)uLength;
+   return 217;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of the first iCount keys of pacKeys that are bound
+   to themselves in oSymTable, looking each up iRounds times. The keys
+   are visited in a scattered order, since looking them up in the order
+   they were put would find the table's nodes side by side. */
+
+static int lookUpAll(SymTable_T oSymTable,
+   char (*pacKeys)[MAX_KEY_LENGTH], int iCount, int iRounds)
+{
+   /* A prime, so stepping by it modulo iCount visits every key unless
+      iCount is a multiple of it. */
+   const unsigned long ulPrime = 7919;
+
+   int iFound = 0;
+   int iRound;
+   int i;
+   unsigned long ulStride;
+   unsigned long ulKey;
+
+   ulStride = iCount > 0 && (unsigned long)iCount % ulPrime == 0 ?
+      1 : ulPrime;
+   for (iRound = 0; iRound < iRounds; iRound++)
+   {
+      ulKey = 0;
+      for (i = 0; i < iCount; i++)
+      {
+         if (SymTable_get(oSymTable, pacKeys[ulKey]) == pacKeys[ulKey])
+            iFound++;
+         ulKey = (ulKey + ulStride) % (unsigned long)iCount;
+      }
+   }
+   return iFound / iRounds;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Freeze a table of iBindingCount bindings and test every read-only
+   function on the frozen table. Write the CPU time consumed by
+   freezing, and by looking every key up in the table and in the frozen
+   table, to stdout. */
+
+static void testFreeze(int iBindingCount)
+{
+   enum {ROUNDS = 4, BATCH = 64, THREAD_COUNT = 4};
+
+   SymTable_T oSymTable;
+   SymTable_T oFrozen;
+   SymTable_T oRefrozen;
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   const char *apcBatch[BATCH];
+   void *apvValues[BATCH];
+   int aiFound[BATCH];
+   int aiCounts[THREAD_COUNT];
+   const void *apvExtra[THREAD_COUNT];
+   struct SymTable_Key sKey;
+   struct SymTable_Iter sIter;
+   const char *pcKey;
+   void *pvValue;
+   size_t uDepth;
+   int iSuccessful;
+   int iCount;
+   int i;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_freeze().\n");
+   printf("No output except CPU time consumed should appear here:\n");
+   fflush(stdout);
+
+   pacKeys = (char(*)[MAX_KEY_LENGTH])
+      calloc((size_t)iBindingCount + 1, MAX_KEY_LENGTH);
+   ASSURE(pacKeys != NULL);
+   if (pacKeys == NULL)
+      return;
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(pacKeys[i], "%d", i);
+      iSuccessful = SymTable_put(oSymTable, pacKeys[i], pacKeys[i]);
+      ASSURE(iSuccessful);
+   }
+
+   iInitialClock = clock();
+   oFrozen = SymTable_freeze(oSymTable);
+   iFinalClock = clock();
+   ASSURE(oFrozen != NULL);
+   printf("CPU time to freeze (%d bindings): %f seconds\n",
+      iBindingCount,
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+   if (oFrozen == NULL)
+   {
+      SymTable_free(oSymTable);
+      free(pacKeys);
+      return;
+   }
+
+   iInitialClock = clock();
+   ASSURE(lookUpAll(oSymTable, pacKeys, iBindingCount, ROUNDS)
+      == iBindingCount);
+   iFinalClock = clock();
+   printf("CPU time to look up in the table: %f seconds\n",
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+
+   iInitialClock = clock();
+   ASSURE(lookUpAll(oFrozen, pacKeys, iBindingCount, ROUNDS)
+      == iBindingCount);
+   iFinalClock = clock();
+   printf("CPU time to look up in the frozen table: %f seconds\n",
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+
+   ASSURE(SymTable_getLength(oFrozen) == (size_t)iBindingCount);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      ASSURE(SymTable_contains(oFrozen, pacKeys[i]));
+      ASSURE(SymTable_getn(oFrozen, pacKeys[i], strlen(pacKeys[i]))
+         == pacKeys[i]);
+   }
+
+   /* Keys that are not there land on some other key's slot. */
+   ASSURE(! SymTable_contains(oFrozen, "-1"));
+   ASSURE(! SymTable_contains(oFrozen, ""));
+   ASSURE(SymTable_get(oFrozen, "Ruth") == NULL);
+   if (iBindingCount > 12)
+   {
+      ASSURE(SymTable_containsn(oFrozen, "123", 2));
+      ASSURE(! SymTable_containsn(oFrozen, "12x", 3));
+   }
+
+   iCount = 0;
+   SymTable_map(oFrozen, countBinding, &iCount);
+   ASSURE(iCount == iBindingCount);
+
+   for (i = 0; i < THREAD_COUNT; i++)
+   {
+      aiCounts[i] = 0;
+      apvExtra[i] = &aiCounts[i];
+   }
+   SymTable_mapParallel(oFrozen, countBinding, apvExtra, THREAD_COUNT);
+   iCount = 0;
+   for (i = 0; i < THREAD_COUNT; i++)
+      iCount += aiCounts[i];
+   ASSURE(iCount == iBindingCount);
+
+   iCount = 0;
+   SymTable_iterBegin(oFrozen, &sIter);
+   while (SymTable_iterNext(&sIter, &pcKey, &pvValue))
+   {
+      ASSURE(strcmp((char*)pvValue, pcKey) == 0);
+      iCount++;
+   }
+   SymTable_iterEnd(&sIter);
+   ASSURE(iCount == iBindingCount);
+
+   /* Batches, prepared keys, and scoped lookups. */
+   for (i = 0; i < BATCH; i++)
+      apcBatch[i] = i % 2 == 0 && i < iBindingCount ? pacKeys[i] : "x";
+   SymTable_getBatch(oFrozen, apcBatch, BATCH, apvValues);
+   SymTable_containsBatch(oFrozen, apcBatch, BATCH, aiFound);
+   for (i = 0; i < BATCH; i++)
+   {
+      ASSURE(apvValues[i] == (apcBatch[i] == pacKeys[i] ? pacKeys[i]
+         : NULL));
+      ASSURE(aiFound[i] == (apvValues[i] != NULL));
+   }
+   if (iBindingCount > 0)
+   {
+      SymTable_prepareKey(&sKey, pacKeys[0], strlen(pacKeys[0]), NULL);
+      ASSURE(SymTable_getPrepared(oFrozen, &sKey) == pacKeys[0]);
+      ASSURE(SymTable_getScoped(oFrozen, pacKeys[0], &uDepth)
+         == pacKeys[0]);
+      ASSURE(uDepth == 0);
+   }
+
+   /* The table stays usable, and its changes do not reach the frozen
+      table. */
+   if (iBindingCount > 0)
+   {
+      ASSURE(SymTable_remove(oSymTable, pacKeys[0]) == pacKeys[0]);
+      ASSURE(SymTable_get(oFrozen, pacKeys[0]) == pacKeys[0]);
+   }
+   SymTable_free(oSymTable);
+
+   /* A frozen table can be frozen again. */
+   oRefrozen = SymTable_freeze(oFrozen);
+   ASSURE(oRefrozen != NULL);
+   SymTable_free(oFrozen);
+   if (oRefrozen != NULL)
+   {
+      ASSURE(SymTable_getLength(oRefrozen) == (size_t)iBindingCount);
+      ASSURE(lookUpAll(oRefrozen, pacKeys, iBindingCount, 1)
+         == iBindingCount);
+      SymTable_free(oRefrozen);
+   }
+
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test freezing an empty table, a table with a caller's hash function,
+   and a table with nested scopes. */
+
+static void testEdgeCases(void)
+{
+   enum {KEYS = 100};
+
+   SymTable_T oSymTable;
+   SymTable_T oFrozen;
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   char acGlobal[] = "global";
+   char acInner[] = "inner";
+   int iSuccessful;
+   int iCount;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing edge cases of frozen tables.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* An empty table. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   oFrozen = SymTable_freeze(oSymTable);
+   ASSURE(oFrozen != NULL);
+   if (oFrozen != NULL)
+   {
+      ASSURE(SymTable_getLength(oFrozen) == 0);
+      ASSURE(! SymTable_contains(oFrozen, "Ruth"));
+      iCount = 0;
+      SymTable_map(oFrozen, countBinding, &iCount);
+      ASSURE(iCount == 0);
+      SymTable_free(oFrozen);
+   }
+
+   /* Nested scopes: only the innermost binding of each key is kept. */
+   iSuccessful = SymTable_put(oSymTable, "x", acGlobal);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_pushScope(oSymTable));
+   iSuccessful = SymTable_putScoped(oSymTable, "x", acInner);
+   ASSURE(iSuccessful);
+   oFrozen = SymTable_freeze(oSymTable);
+   ASSURE(oFrozen != NULL);
+   if (oFrozen != NULL)
+   {
+      ASSURE(SymTable_getLength(oFrozen) == 1);
+      ASSURE(SymTable_get(oFrozen, "x") == acInner);
+      SymTable_free(oFrozen);
+   }
+   ASSURE(SymTable_popScope(oSymTable));
+   ASSURE(SymTable_get(oSymTable, "x") == acGlobal);
+   SymTable_free(oSymTable);
+
+   /* A table whose keys all share one hash code under its own hash
+      function freezes under the default one. */
+   pacKeys = (char(*)[MAX_KEY_LENGTH])calloc(KEYS, MAX_KEY_LENGTH);
+   ASSURE(pacKeys != NULL);
+   if (pacKeys == NULL)
+      return;
+   oSymTable = SymTable_newWithHash(hashConstant);
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < KEYS; i++)
+   {
+      sprintf(pacKeys[i], "%d", i);
+      iSuccessful = SymTable_put(oSymTable, pacKeys[i], pacKeys[i]);
+      ASSURE(iSuccessful);
+   }
+   oFrozen = SymTable_freeze(oSymTable);
+   ASSURE(oFrozen != NULL);
+   SymTable_free(oSymTable);
+   if (oFrozen != NULL)
+   {
+      ASSURE(lookUpAll(oFrozen, pacKeys, KEYS, 1) == KEYS);
+      ASSURE(! SymTable_contains(oFrozen, "100"));
+      SymTable_free(oFrozen);
+   }
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_freeze() with iBindingCount bindings. */
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+
+   if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s bindingcount\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1)
+   {
+      fprintf(stderr, "bindingcount must be numeric\n");
+      exit(EXIT_FAILURE);
+   }
+   if (iBindingCount < 0)
+   {
+      fprintf(stderr, "bindingcount cannot be negative\n");
+      exit(EXIT_FAILURE);
+   }
+
+   testFreeze(iBindingCount);
+   testEdgeCases();
+
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}
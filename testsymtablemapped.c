@@ -0,0 +1,412 @@
+/*--------------------------------------------------------------------*/
+/* testsymtablemapped.c                                               */
+/* Author: Kevin Castro                                               */
+/*--------------------------------------------------------------------*/
+
+#include "symtablemapped.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <assert.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/* Length of the buffer each test key is printed into. */
+enum {MAX_KEY_LENGTH = 24};
+
+/* The file the tests save to, which they remove when done. */
+static const char pcPath[] = "testsymtablemapped.dat";
+
+/* A value as the tests store it, and as it is read back in place from
+   a mapped file. */
+struct Player
+{
+   long lNumber;
+   char acPosition[16];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write pvValue, a struct Player, to psFile as it is in memory. Return
+   1 on success and 0 otherwise. */
+
+static int writePlayer(const void *pvValue, FILE *psFile)
+{
+   assert(pvValue != NULL);
+   assert(psFile != NULL);
+
+   return fwrite(pvValue, sizeof(struct Player), 1, psFile) == 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Overwrite the uIndex-th size_t of the file at pcPath with uWord.
+   Return 1 on success and 0 otherwise. */
+
+static int overwriteWord(size_t uIndex, size_t uWord)
+{
+   FILE *psFile;
+   int iSuccessful;
+
+   psFile = fopen(pcPath, "r+b");
+   if (psFile == NULL)
+      return 0;
+   iSuccessful = fseek(psFile, (long)(uIndex * sizeof(size_t)),
+      SEEK_SET) == 0 && fwrite(&uWord, sizeof(size_t), 1, psFile) == 1;
+   return fclose(psFile) == 0 && iSuccessful;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Read the uIndex-th size_t of the file at pcPath into *puWord.
+   Return 1 on success and 0 otherwise. */
+
+static int readWord(size_t uIndex, size_t *puWord)
+{
+   FILE *psFile;
+   int iSuccessful;
+
+   psFile = fopen(pcPath, "rb");
+   if (psFile == NULL)
+      return 0;
+   iSuccessful = fseek(psFile, (long)(uIndex * sizeof(size_t)),
+      SEEK_SET) == 0 && fread(puWord, sizeof(size_t), 1, psFile) == 1;
+   fclose(psFile);
+   return iSuccessful;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write nothing, and fail. */
+
+static int writeNothing(const void *pvValue, FILE *psFile)
+{
+   assert(psFile != NULL);
+   (void)pvValue;
+   return 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Add the number of pvValue, a struct Player, to the long pointed to
+   by pvExtra, checking that the key is that number. */
+
+static void sumPlayer(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   const struct Player *psPlayer = (const struct Player*)pvValue;
+
+   assert(pcKey != NULL);
+   assert(pvValue != NULL);
+   assert(pvExtra != NULL);
+
+   ASSURE(atol(pcKey) == psPlayer->lNumber);
+   *(long*)pvExtra += psPlayer->lNumber;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the same hash code for every key. */
+
+static size_t hashConstant(const char *pcKey, size_t uLength)
+{
+   assert(pcKey != NULL);
+   (void)uLength;
+   return 217;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Save a table of iBindingCount bindings, map it, and check every
+   binding of the mapped table. Write the CPU time consumed by building
+   the table and by opening and searching the mapped file to stdout. */
+
+static void testSaveAndMap(int iBindingCount)
+{
+   enum {BATCH = 64, THREAD_COUNT = 4};
+
+   SymTable_T oSymTable;
+   SymTable_T oMapped;
+   struct Player *psPlayers;
+   const struct Player *psFound;
+   char acKey[MAX_KEY_LENGTH];
+   char aacBatch[BATCH][MAX_KEY_LENGTH];
+   const char *apcBatch[BATCH];
+   void *apvValues[BATCH];
+   int aiFound[BATCH];
+   const void *apvExtra[THREAD_COUNT];
+   struct SymTable_Key sKey;
+   size_t uDepth;
+   int iSuccessful;
+   int i;
+   long lSum;
+   long lExpected;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_save() and SymTable_openMapped().\n");
+   printf("No output except CPU time consumed should appear here:\n");
+   fflush(stdout);
+
+   psPlayers = (struct Player*)
+      calloc((size_t)iBindingCount + 1, sizeof(struct Player));
+   ASSURE(psPlayers != NULL);
+   if (psPlayers == NULL)
+      return;
+
+   iInitialClock = clock();
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      psPlayers[i].lNumber = i;
+      strcpy(psPlayers[i].acPosition, i % 2 == 0 ? "Pitcher" : "Catcher");
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, &psPlayers[i]);
+      ASSURE(iSuccessful);
+   }
+   iFinalClock = clock();
+   printf("CPU time to build (%d bindings): %f seconds\n", iBindingCount,
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+
+   iSuccessful = SymTable_save(oSymTable, pcPath, writePlayer);
+   ASSURE(iSuccessful);
+   SymTable_free(oSymTable);
+
+   iInitialClock = clock();
+   oMapped = SymTable_openMapped(pcPath);
+   ASSURE(oMapped != NULL);
+   if (oMapped == NULL)
+   {
+      remove(pcPath);
+      free(psPlayers);
+      return;
+   }
+   ASSURE(SymTable_getLength(oMapped) == (size_t)iBindingCount);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      psFound = (const struct Player*)SymTable_get(oMapped, acKey);
+      ASSURE(psFound != NULL);
+      if (psFound == NULL)
+         continue;
+      ASSURE(psFound->lNumber == i);
+      ASSURE(strcmp(psFound->acPosition,
+         i % 2 == 0 ? "Pitcher" : "Catcher") == 0);
+   }
+   iFinalClock = clock();
+   printf("CPU time to map and search (%d bindings): %f seconds\n",
+      iBindingCount,
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+
+   /* Missing keys, including ones that share a prefix with a real key
+      or are the leading bytes of one. */
+   ASSURE(! SymTable_contains(oMapped, "-1"));
+   ASSURE(! SymTable_contains(oMapped, ""));
+   sprintf(acKey, "%d", iBindingCount);
+   ASSURE(SymTable_get(oMapped, acKey) == NULL);
+   if (iBindingCount > 12)
+   {
+      ASSURE(SymTable_containsn(oMapped, "12", 2));
+      ASSURE(SymTable_containsn(oMapped, "12", 1));
+      ASSURE(SymTable_getn(oMapped, "123", 2) != NULL);
+   }
+
+   lSum = 0;
+   SymTable_map(oMapped, sumPlayer, &lSum);
+   lExpected = (long)iBindingCount * (iBindingCount - 1) / 2;
+   ASSURE(lSum == lExpected);
+
+   lSum = 0;
+   for (i = 0; i < THREAD_COUNT; i++)
+      apvExtra[i] = &lSum;
+   SymTable_mapParallel(oMapped, sumPlayer, apvExtra, THREAD_COUNT);
+   ASSURE(lSum == lExpected);
+
+   /* Batches, prepared keys, and scoped lookups. */
+   for (i = 0; i < BATCH; i++)
+   {
+      sprintf(aacBatch[i], "%d", i % 2 == 0 ? i : -i);
+      apcBatch[i] = aacBatch[i];
+   }
+   SymTable_getBatch(oMapped, apcBatch, BATCH, apvValues);
+   SymTable_containsBatch(oMapped, apcBatch, BATCH, aiFound);
+   for (i = 0; i < BATCH; i++)
+   {
+      psFound = (const struct Player*)apvValues[i];
+      ASSURE(aiFound[i] == (i % 2 == 0 && i < iBindingCount));
+      ASSURE((psFound != NULL) == aiFound[i]);
+      ASSURE(psFound == NULL || psFound->lNumber == i);
+   }
+   if (iBindingCount > 0)
+   {
+      SymTable_prepareKey(&sKey, "0", 1, NULL);
+      psFound = (const struct Player*)SymTable_getPrepared(oMapped, &sKey);
+      ASSURE(psFound != NULL && psFound->lNumber == 0);
+      uDepth = 1;
+      ASSURE(SymTable_getScoped(oMapped, "0", &uDepth) == psFound);
+      ASSURE(uDepth == 0);
+   }
+   ASSURE(SymTable_getScoped(oMapped, "-1", &uDepth) == NULL);
+
+   SymTable_free(oMapped);
+   remove(pcPath);
+   free(psPlayers);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test saving an empty table, a table with a caller's hash function,
+   and failures to save or open. */
+
+static void testEdgeCases(void)
+{
+   SymTable_T oSymTable;
+   SymTable_T oMapped;
+   struct Player sPlayer;
+   const struct Player *psFound;
+   FILE *psFile;
+   size_t uBuckets = 0;
+   size_t uWord = 0;
+   int iSuccessful;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing edge cases of mapped tables.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* An empty table. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   iSuccessful = SymTable_save(oSymTable, pcPath, writePlayer);
+   ASSURE(iSuccessful);
+   SymTable_free(oSymTable);
+   oMapped = SymTable_openMapped(pcPath);
+   ASSURE(oMapped != NULL);
+   if (oMapped != NULL)
+   {
+      ASSURE(SymTable_getLength(oMapped) == 0);
+      ASSURE(! SymTable_contains(oMapped, "Ruth"));
+      SymTable_free(oMapped);
+   }
+
+   /* A caller's hash function is not needed to search the file. */
+   sPlayer.lNumber = 3;
+   strcpy(sPlayer.acPosition, "RightField");
+   oSymTable = SymTable_newWithHash(hashConstant);
+   ASSURE(oSymTable != NULL);
+   iSuccessful = SymTable_put(oSymTable, "Ruth", &sPlayer);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTable, "Gehrig", &sPlayer);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_save(oSymTable, pcPath, writePlayer);
+   ASSURE(iSuccessful);
+
+   /* A value that cannot be written leaves no file behind. */
+   iSuccessful = SymTable_save(oSymTable, pcPath, writeNothing);
+   ASSURE(! iSuccessful);
+   ASSURE(SymTable_openMapped(pcPath) == NULL);
+   iSuccessful = SymTable_save(oSymTable, pcPath, writePlayer);
+   ASSURE(iSuccessful);
+   SymTable_free(oSymTable);
+
+   oMapped = SymTable_openMapped(pcPath);
+   ASSURE(oMapped != NULL);
+   if (oMapped != NULL)
+   {
+      ASSURE(SymTable_getLength(oMapped) == 2);
+      psFound = (const struct Player*)SymTable_get(oMapped, "Ruth");
+      ASSURE(psFound != NULL && psFound->lNumber == 3);
+      ASSURE(SymTable_contains(oMapped, "Gehrig"));
+      ASSURE(! SymTable_contains(oMapped, "Mantle"));
+      SymTable_free(oMapped);
+   }
+
+   /* Files whose index has been damaged. The header is four words,
+      the last the bucket count, followed by the bucket starts and then
+      the entries of four words each, the second the key's length and
+      the third its offset. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   iSuccessful = SymTable_put(oSymTable, "Ruth", &sPlayer);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_save(oSymTable, pcPath, writePlayer);
+   ASSURE(iSuccessful);
+   ASSURE(readWord(3, &uBuckets));
+   ASSURE(overwriteWord(4 + uBuckets / 2, (size_t)-1));
+   ASSURE(SymTable_openMapped(pcPath) == NULL);
+   iSuccessful = SymTable_save(oSymTable, pcPath, writePlayer);
+   ASSURE(iSuccessful);
+   ASSURE(readWord(4 + uBuckets + 1 + 2, &uWord));
+   ASSURE(overwriteWord(4 + uBuckets + 1 + 2, uWord + 100000));
+   ASSURE(SymTable_openMapped(pcPath) == NULL);
+   iSuccessful = SymTable_save(oSymTable, pcPath, writePlayer);
+   ASSURE(iSuccessful);
+   ASSURE(overwriteWord(4 + uBuckets + 1 + 1, 3));
+   ASSURE(SymTable_openMapped(pcPath) == NULL);
+   SymTable_free(oSymTable);
+
+   /* Files that SymTable_save did not write. */
+   psFile = fopen(pcPath, "wb");
+   ASSURE(psFile != NULL);
+   if (psFile != NULL)
+   {
+      fputs("Not a symbol table, but long enough to have a header.\n",
+         psFile);
+      fclose(psFile);
+   }
+   ASSURE(SymTable_openMapped(pcPath) == NULL);
+   remove(pcPath);
+   ASSURE(SymTable_openMapped(pcPath) == NULL);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_save() and SymTable_openMapped() with iBindingCount
+   bindings. */
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+
+   if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s bindingcount\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1)
+   {
+      fprintf(stderr, "bindingcount must be numeric\n");
+      exit(EXIT_FAILURE);
+   }
+   if (iBindingCount < 0)
+   {
+      fprintf(stderr, "bindingcount cannot be negative\n");
+      exit(EXIT_FAILURE);
+   }
+
+   testSaveAndMap(iBindingCount);
+   testEdgeCases();
+
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}
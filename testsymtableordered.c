@@ -0,0 +1,408 @@
+/*--------------------------------------------------------------------*/
+/* testsymtableordered.c                                              */
+/* Author: Kevin Castro                                               */
+/*--------------------------------------------------------------------*/
+
+#include "symtableordered.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <assert.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* What a visit records: how many bindings were visited, the last key
+   visited, and whether every key was greater than the one before. */
+
+struct Visit
+{
+   int iCount;
+   char acLast[64];
+   int iSorted;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Record in *pvExtra, a struct Visit, a visit to the binding whose key
+   is pcKey. The value of every binding is its key. */
+
+static void recordBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   struct Visit *psVisit = (struct Visit*)pvExtra;
+
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+
+   if (psVisit->iCount > 0 && strcmp(psVisit->acLast, pcKey) >= 0)
+      psVisit->iSorted = 0;
+   if (strcmp((char*)pvValue, pcKey) != 0)
+      psVisit->iSorted = 0;
+   strncpy(psVisit->acLast, pcKey, sizeof(psVisit->acLast) - 1);
+   psVisit->acLast[sizeof(psVisit->acLast) - 1] = '\0';
+   psVisit->iCount++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Apply SymTable_rangeMap() to oSymTable over [pcLow, pcHigh), and
+   return what it visited. */
+
+static struct Visit visitRange(SymTable_T oSymTable, const char *pcLow,
+   const char *pcHigh)
+{
+   struct Visit sVisit;
+
+   sVisit.iCount = 0;
+   sVisit.acLast[0] = '\0';
+   sVisit.iSorted = 1;
+   SymTable_rangeMap(oSymTable, pcLow, pcHigh, recordBinding, &sVisit);
+   return sVisit;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Apply SymTable_prefixMap() to oSymTable with pcPrefix, and return
+   what it visited. */
+
+static struct Visit visitPrefix(SymTable_T oSymTable,
+   const char *pcPrefix)
+{
+   struct Visit sVisit;
+
+   sVisit.iCount = 0;
+   sVisit.acLast[0] = '\0';
+   sVisit.iSorted = 1;
+   SymTable_prefixMap(oSymTable, pcPrefix, recordBinding, &sVisit);
+   return sVisit;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test that SymTable_map() visits a small table in key order. */
+
+static void testSortedMap(void)
+{
+   static const char *apcKeys[] =
+      {"Ruth", "Gehrig", "Mantle", "Jeter", "Berra", "DiMaggio",
+       "Maris", "Rivera", "", "Ruthless", "Rut"};
+   enum {KEY_COUNT = sizeof(apcKeys) / sizeof(apcKeys[0])};
+
+   SymTable_T oSymTable;
+   struct Visit sVisit;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the order of SymTable_map().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      iSuccessful = SymTable_put(oSymTable, apcKeys[i],
+         (void*)apcKeys[i]);
+      ASSURE(iSuccessful);
+   }
+
+   sVisit.iCount = 0;
+   sVisit.acLast[0] = '\0';
+   sVisit.iSorted = 1;
+   SymTable_map(oSymTable, recordBinding, &sVisit);
+   ASSURE(sVisit.iCount == KEY_COUNT);
+   ASSURE(sVisit.iSorted);
+   ASSURE(strcmp(sVisit.acLast, "Ruthless") == 0);
+
+   /* Bounds need not be keys, and either may be open. */
+   sVisit = visitRange(oSymTable, "Rut", "Ruth");
+   ASSURE(sVisit.iCount == 1);
+   ASSURE(strcmp(sVisit.acLast, "Rut") == 0);
+   sVisit = visitRange(oSymTable, "Ja", "Mb");
+   ASSURE(sVisit.iCount == 3);
+   ASSURE(strcmp(sVisit.acLast, "Maris") == 0);
+   sVisit = visitRange(oSymTable, NULL, "Berra");
+   ASSURE(sVisit.iCount == 1);
+   sVisit = visitRange(oSymTable, "Rivera", NULL);
+   ASSURE(sVisit.iCount == 4);
+   ASSURE(sVisit.iSorted);
+   sVisit = visitRange(oSymTable, NULL, NULL);
+   ASSURE(sVisit.iCount == KEY_COUNT);
+   sVisit = visitRange(oSymTable, "Mantle", "Mantle");
+   ASSURE(sVisit.iCount == 0);
+   sVisit = visitRange(oSymTable, "Z", "A");
+   ASSURE(sVisit.iCount == 0);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_put(), SymTable_remove(), and SymTable_rangeMap() on
+   iBindingCount bindings put and removed in random order, checking
+   that the table stays sorted as it grows and shrinks. Write the CPU
+   time consumed to stdout. */
+
+static void testChurn(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 16};
+
+   SymTable_T oSymTable;
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   int *piOrder;
+   struct Visit sVisit;
+   char acLow[MAX_KEY_LENGTH];
+   char acHigh[MAX_KEY_LENGTH];
+   int iSuccessful;
+   int iSwap;
+   int i;
+   int j;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing puts and removes in random order.\n");
+   printf("No output except CPU time consumed should appear here:\n");
+   fflush(stdout);
+
+   pacKeys = (char(*)[MAX_KEY_LENGTH])
+      calloc((size_t)iBindingCount + 1, MAX_KEY_LENGTH);
+   piOrder = (int*)calloc((size_t)iBindingCount + 1, sizeof(int));
+   ASSURE(pacKeys != NULL);
+   ASSURE(piOrder != NULL);
+   if (pacKeys == NULL || piOrder == NULL)
+      return;
+
+   /* Zero-padded keys sort in numeric order. */
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(pacKeys[i], "%010d", i);
+      piOrder[i] = i;
+   }
+   srand(217);
+   for (i = iBindingCount - 1; i > 0; i--)
+   {
+      j = rand() % (i + 1);
+      iSwap = piOrder[i];
+      piOrder[i] = piOrder[j];
+      piOrder[j] = iSwap;
+   }
+
+   iInitialClock = clock();
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   for (i = 0; i < iBindingCount; i++)
+   {
+      iSuccessful = SymTable_put(oSymTable, pacKeys[piOrder[i]],
+         pacKeys[piOrder[i]]);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == (size_t)iBindingCount);
+
+   for (i = 0; i < iBindingCount; i++)
+      ASSURE(SymTable_get(oSymTable, pacKeys[i]) == pacKeys[i]);
+
+   sVisit = visitRange(oSymTable, NULL, NULL);
+   ASSURE(sVisit.iCount == iBindingCount);
+   ASSURE(sVisit.iSorted);
+
+   /* Every key from acLow up to acHigh is present. */
+   sprintf(acLow, "%010d", iBindingCount / 4);
+   sprintf(acHigh, "%010d", iBindingCount / 2);
+   sVisit = visitRange(oSymTable, acLow, acHigh);
+   ASSURE(sVisit.iCount == iBindingCount / 2 - iBindingCount / 4);
+   ASSURE(sVisit.iSorted);
+
+   /* Remove the keys at even positions of the order, then put them
+      back, so that nodes empty out and refill throughout the tree. */
+   for (i = 0; i < iBindingCount; i += 2)
+      ASSURE(SymTable_remove(oSymTable, pacKeys[piOrder[i]])
+         == pacKeys[piOrder[i]]);
+   ASSURE(SymTable_getLength(oSymTable) == (size_t)(iBindingCount / 2));
+   for (i = 0; i < iBindingCount; i++)
+      ASSURE(SymTable_contains(oSymTable, pacKeys[piOrder[i]])
+         == (i % 2 == 1));
+   sVisit = visitRange(oSymTable, NULL, NULL);
+   ASSURE(sVisit.iCount == iBindingCount / 2);
+   ASSURE(sVisit.iSorted);
+
+   for (i = 0; i < iBindingCount; i += 2)
+   {
+      iSuccessful = SymTable_put(oSymTable, pacKeys[piOrder[i]],
+         pacKeys[piOrder[i]]);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == (size_t)iBindingCount);
+
+   /* Remove everything, in key order so that the leftmost leaf keeps
+      borrowing from and merging with its neighbour. */
+   for (i = 0; i < iBindingCount; i++)
+   {
+      ASSURE(SymTable_remove(oSymTable, pacKeys[i]) == pacKeys[i]);
+      ASSURE(SymTable_remove(oSymTable, pacKeys[i]) == NULL);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   sVisit = visitRange(oSymTable, NULL, NULL);
+   ASSURE(sVisit.iCount == 0);
+
+   /* The emptied table is still usable. */
+   iSuccessful = SymTable_put(oSymTable, "Ruth", (void*)"Ruth");
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_getLength(oSymTable) == 1);
+
+   SymTable_free(oSymTable);
+
+   iFinalClock = clock();
+   printf("CPU time (%d bindings): %f seconds\n", iBindingCount,
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+
+   free(piOrder);
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_prefixMap() on qualified names of the form
+   module.Class.field, which share long prefixes. Use about
+   iBindingCount bindings. */
+
+static void testPrefixMap(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 64, CLASSES = 10, FIELDS = 10};
+
+   SymTable_T oSymTable;
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   struct Visit sVisit;
+   char acPrefix[MAX_KEY_LENGTH];
+   int iModules;
+   int iKeyCount;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_prefixMap().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   iModules = iBindingCount / (CLASSES * FIELDS) + 1;
+   iKeyCount = iModules * CLASSES * FIELDS;
+   pacKeys = (char(*)[MAX_KEY_LENGTH])
+      calloc((size_t)iKeyCount, MAX_KEY_LENGTH);
+   ASSURE(pacKeys != NULL);
+   if (pacKeys == NULL)
+      return;
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   for (i = 0; i < iKeyCount; i++)
+   {
+      sprintf(pacKeys[i], "org.example.compiler.module%d.Class%d.field%d",
+         i / (CLASSES * FIELDS), i / FIELDS % CLASSES, i % FIELDS);
+      iSuccessful = SymTable_put(oSymTable, pacKeys[i], pacKeys[i]);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == (size_t)iKeyCount);
+
+   /* The prefix may end anywhere: inside a shared run, at a dot, or
+      part way through a name. */
+   sVisit = visitPrefix(oSymTable, "");
+   ASSURE(sVisit.iCount == iKeyCount);
+   ASSURE(sVisit.iSorted);
+   sVisit = visitPrefix(oSymTable, "org.exam");
+   ASSURE(sVisit.iCount == iKeyCount);
+   sVisit = visitPrefix(oSymTable, "org.example.compiler.module0.");
+   ASSURE(sVisit.iCount == CLASSES * FIELDS);
+   ASSURE(sVisit.iSorted);
+   sVisit = visitPrefix(oSymTable, "org.example.compiler.module0.Class3");
+   ASSURE(sVisit.iCount == FIELDS);
+   sVisit = visitPrefix(oSymTable,
+      "org.example.compiler.module0.Class3.field7");
+   ASSURE(sVisit.iCount == 1);
+   sVisit = visitPrefix(oSymTable,
+      "org.example.compiler.module0.Class3.field7x");
+   ASSURE(sVisit.iCount == 0);
+   sVisit = visitPrefix(oSymTable, "org.example.linker");
+   ASSURE(sVisit.iCount == 0);
+   sVisit = visitPrefix(oSymTable, "org.examplf");
+   ASSURE(sVisit.iCount == 0);
+   sVisit = visitPrefix(oSymTable, "org.example.compiler.module0.Class3.x");
+   ASSURE(sVisit.iCount == 0);
+
+   /* Remove every other field, and check that a module's worth of
+      prefixes still see exactly the rest. */
+   for (i = 0; i < iKeyCount; i += 2)
+      ASSURE(SymTable_remove(oSymTable, pacKeys[i]) == pacKeys[i]);
+   ASSURE(SymTable_getLength(oSymTable) == (size_t)(iKeyCount / 2));
+   sVisit = visitPrefix(oSymTable, "org.example.compiler.module");
+   ASSURE(sVisit.iCount == iKeyCount / 2);
+   ASSURE(sVisit.iSorted);
+   sprintf(acPrefix, "org.example.compiler.module%d.Class9", iModules - 1);
+   sVisit = visitPrefix(oSymTable, acPrefix);
+   ASSURE(sVisit.iCount == FIELDS / 2);
+   for (i = 1; i < iKeyCount; i += 2)
+      ASSURE(SymTable_get(oSymTable, pacKeys[i]) == pacKeys[i]);
+
+   for (i = 1; i < iKeyCount; i += 2)
+      ASSURE(SymTable_remove(oSymTable, pacKeys[i]) == pacKeys[i]);
+   sVisit = visitPrefix(oSymTable, "");
+   ASSURE(sVisit.iCount == 0);
+
+   SymTable_free(oSymTable);
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+
+   if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s bindingcount\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1)
+   {
+      fprintf(stderr, "bindingcount must be numeric\n");
+      exit(EXIT_FAILURE);
+   }
+   if (iBindingCount < 0)
+   {
+      fprintf(stderr, "bindingcount cannot be negative\n");
+      exit(EXIT_FAILURE);
+   }
+
+   testSortedMap();
+   testChurn(iBindingCount);
+   testPrefixMap(iBindingCount);
+
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}
@@ -0,0 +1,454 @@
+/*--------------------------------------------------------------------*/
+/* testsymtablesnapshot.c                                             */
+/* Author: Kevin Castro                                               */
+/*--------------------------------------------------------------------*/
+
+#include "symtablehamt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/* Length of the buffer each test key is printed into. */
+enum {MAX_KEY_LENGTH = 12};
+
+/* Number of reader threads testReaders starts. */
+enum {READERS = 4};
+
+/* A thread that checks a snapshot while the table it was taken from
+   changes, and then frees it. */
+struct Reader
+{
+   SymTable_T oSnapshot;
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   /* The snapshot binds pacKeys[0] to pacKeys[iCount-1] to
+      themselves. */
+   int iCount;
+   /* Number of lookups that did not find what they should have. */
+   long lFailures;
+   pthread_t oThread;
+   /* Nonzero if oThread is running readSnapshot. */
+   int iStarted;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return an array of iCount keys, the decimal numerals 0 to iCount-1,
+   or NULL if memory allocation fails. */
+
+static char (*makeKeys(int iCount))[MAX_KEY_LENGTH]
+{
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   int i;
+
+   pacKeys = (char(*)[MAX_KEY_LENGTH])malloc(
+      (size_t)(iCount > 0 ? iCount : 1) * MAX_KEY_LENGTH);
+   if (pacKeys == NULL)
+      return NULL;
+   for (i = 0; i < iCount; i++)
+      sprintf(pacKeys[i], "%d", i);
+   return pacKeys;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the same hash code for every key, so that every binding
+   lands in one collision node. */
+
+static size_t hashConstant(const char *pcKey, size_t uLength)
+{
+   assert(pcKey != NULL);
+   (void)uLength;
+   return 217;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test that a snapshot and the table it was taken from do not see
+   each other's changes, and that either may be freed first. */
+
+static void testIsolation(void)
+{
+   SymTable_T oSymTable;
+   SymTable_T oSnapshot;
+   SymTable_T oSecond;
+   int iSuccessful;
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   iSuccessful = SymTable_put(oSymTable, "Ruth", (void*)"RightField");
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTable, "Gehrig", (void*)"FirstBase");
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTable, "Mantle", (void*)"CenterField");
+   ASSURE(iSuccessful);
+
+   oSnapshot = SymTable_snapshot(oSymTable);
+   ASSURE(oSnapshot != NULL);
+   ASSURE(SymTable_getLength(oSnapshot) == 3);
+
+   /* Change the table; the snapshot keeps the old bindings. */
+   iSuccessful = SymTable_put(oSymTable, "Maris", (void*)"RightField");
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_replace(oSymTable, "Ruth", (void*)"Pitcher")
+      == (void*)"RightField");
+   ASSURE(SymTable_remove(oSymTable, "Gehrig") == (void*)"FirstBase");
+
+   ASSURE(SymTable_getLength(oSymTable) == 3);
+   ASSURE(SymTable_get(oSymTable, "Ruth") == (void*)"Pitcher");
+   ASSURE(! SymTable_contains(oSymTable, "Gehrig"));
+   ASSURE(SymTable_contains(oSymTable, "Maris"));
+
+   ASSURE(SymTable_getLength(oSnapshot) == 3);
+   ASSURE(SymTable_get(oSnapshot, "Ruth") == (void*)"RightField");
+   ASSURE(SymTable_get(oSnapshot, "Gehrig") == (void*)"FirstBase");
+   ASSURE(! SymTable_contains(oSnapshot, "Maris"));
+
+   /* Change the snapshot; the table does not see it. */
+   iSuccessful = SymTable_put(oSnapshot, "Berra", (void*)"Catcher");
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_remove(oSnapshot, "Mantle") == (void*)"CenterField");
+   ASSURE(SymTable_get(oSymTable, "Mantle") == (void*)"CenterField");
+   ASSURE(! SymTable_contains(oSymTable, "Berra"));
+
+   /* A snapshot of a snapshot, outliving both. */
+   oSecond = SymTable_snapshot(oSnapshot);
+   ASSURE(oSecond != NULL);
+   SymTable_free(oSymTable);
+   SymTable_free(oSnapshot);
+   ASSURE(SymTable_getLength(oSecond) == 3);
+   ASSURE(SymTable_get(oSecond, "Berra") == (void*)"Catcher");
+   ASSURE(SymTable_get(oSecond, "Ruth") == (void*)"RightField");
+   ASSURE(! SymTable_contains(oSecond, "Mantle"));
+   SymTable_free(oSecond);
+
+   /* A snapshot of an empty table. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   oSnapshot = SymTable_snapshot(oSymTable);
+   ASSURE(oSnapshot != NULL);
+   iSuccessful = SymTable_put(oSymTable, "Ruth", (void*)"RightField");
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_getLength(oSnapshot) == 0);
+   ASSURE(! SymTable_contains(oSnapshot, "Ruth"));
+   SymTable_free(oSnapshot);
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 if version iVersion of testVersions binds key i, where
+   every version added iStep keys. */
+
+static int versionContains(int iVersion, int iStep, int i)
+{
+   if (i >= (iVersion + 1) * iStep)
+      return 0;
+   return ! (i % 3 == 0 && i < iVersion * iStep);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Build a table of iBindingCount bindings in VERSIONS steps, each of
+   which puts a block of keys, removes some of the block before, and
+   replaces a value, and take a snapshot after every step. Then check
+   every snapshot against what the table held when it was taken. Write
+   the CPU time consumed to stdout. */
+
+static void testVersions(int iBindingCount)
+{
+   enum {VERSIONS = 16};
+
+   SymTable_T oSymTable;
+   SymTable_T aoVersions[VERSIONS];
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   int iStep;
+   int iVersion;
+   int iSuccessful;
+   int iFound;
+   int i;
+   size_t uLength;
+   void *pvValue;
+   void *pvExpected;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing many versions of one table.\n");
+   printf("No output except CPU time consumed should appear here:\n");
+   fflush(stdout);
+
+   iStep = iBindingCount / VERSIONS;
+   if (iStep < 2)
+      iStep = 2;
+   pacKeys = makeKeys(iStep * VERSIONS);
+   ASSURE(pacKeys != NULL);
+   if (pacKeys == NULL)
+      return;
+
+   iInitialClock = clock();
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   for (iVersion = 0; iVersion < VERSIONS; iVersion++)
+   {
+      for (i = iVersion * iStep; i < (iVersion + 1) * iStep; i++)
+      {
+         iSuccessful = SymTable_put(oSymTable, pacKeys[i], pacKeys[i]);
+         ASSURE(iSuccessful);
+      }
+      if (iVersion > 0)
+      {
+         for (i = (iVersion - 1) * iStep; i < iVersion * iStep; i++)
+            if (i % 3 == 0)
+               ASSURE(SymTable_remove(oSymTable, pacKeys[i])
+                  != NULL || i % iStep == 1);
+      }
+      aoVersions[iVersion] = SymTable_snapshot(oSymTable);
+      ASSURE(aoVersions[iVersion] != NULL);
+
+      /* Later versions see this key bound to NULL. */
+      i = iVersion * iStep + 1;
+      ASSURE(SymTable_replace(oSymTable, pacKeys[i], NULL)
+         == pacKeys[i]);
+   }
+
+   for (iVersion = 0; iVersion < VERSIONS; iVersion++)
+   {
+      if (aoVersions[iVersion] == NULL)
+         continue;
+      uLength = 0;
+      for (i = 0; i < iStep * VERSIONS; i++)
+      {
+         iFound = SymTable_contains(aoVersions[iVersion], pacKeys[i]);
+         ASSURE(iFound == versionContains(iVersion, iStep, i));
+         if (! iFound)
+            continue;
+         uLength++;
+         pvExpected = pacKeys[i];
+         if (i % iStep == 1 && i / iStep < iVersion)
+            pvExpected = NULL;
+         pvValue = SymTable_get(aoVersions[iVersion], pacKeys[i]);
+         ASSURE(pvValue == pvExpected);
+      }
+      ASSURE(SymTable_getLength(aoVersions[iVersion]) == uLength);
+   }
+
+   /* Free the versions out of order, while the table still shares
+      their nodes. */
+   for (iVersion = 1; iVersion < VERSIONS; iVersion += 2)
+      if (aoVersions[iVersion] != NULL)
+         SymTable_free(aoVersions[iVersion]);
+   SymTable_free(oSymTable);
+   for (iVersion = 0; iVersion < VERSIONS; iVersion += 2)
+      if (aoVersions[iVersion] != NULL)
+         SymTable_free(aoVersions[iVersion]);
+
+   iFinalClock = clock();
+   printf("CPU time (%d bindings): %f seconds\n", iStep * VERSIONS,
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test snapshots of a table whose keys all have the same hash code. */
+
+static void testCollisions(void)
+{
+   enum {KEYS = 100};
+
+   SymTable_T oSymTable;
+   SymTable_T oSnapshot;
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   int iSuccessful;
+   int i;
+
+   pacKeys = makeKeys(KEYS);
+   ASSURE(pacKeys != NULL);
+   if (pacKeys == NULL)
+      return;
+
+   oSymTable = SymTable_newWithHash(hashConstant);
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < KEYS; i++)
+   {
+      iSuccessful = SymTable_put(oSymTable, pacKeys[i], pacKeys[i]);
+      ASSURE(iSuccessful);
+   }
+   oSnapshot = SymTable_snapshot(oSymTable);
+   ASSURE(oSnapshot != NULL);
+
+   for (i = 0; i < KEYS; i += 2)
+      ASSURE(SymTable_remove(oSymTable, pacKeys[i]) == pacKeys[i]);
+   ASSURE(SymTable_replace(oSymTable, pacKeys[1], NULL) == pacKeys[1]);
+   iSuccessful = SymTable_put(oSymTable, pacKeys[0], NULL);
+   ASSURE(iSuccessful);
+
+   ASSURE(SymTable_getLength(oSymTable) == KEYS / 2 + 1);
+   ASSURE(SymTable_getLength(oSnapshot) == KEYS);
+   for (i = 0; i < KEYS; i++)
+   {
+      ASSURE(SymTable_get(oSnapshot, pacKeys[i]) == pacKeys[i]);
+      ASSURE(SymTable_contains(oSymTable, pacKeys[i])
+         == (i % 2 == 1 || i == 0));
+   }
+   ASSURE(SymTable_get(oSymTable, pacKeys[1]) == NULL);
+
+   /* Down to one binding, then none. */
+   for (i = 0; i < KEYS; i++)
+      SymTable_remove(oSnapshot, pacKeys[i]);
+   ASSURE(SymTable_getLength(oSnapshot) == 0);
+   ASSURE(SymTable_get(oSymTable, pacKeys[3]) == pacKeys[3]);
+
+   SymTable_free(oSnapshot);
+   SymTable_free(oSymTable);
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Check every binding of the snapshot of psReader, given as pvReader,
+   and then free it. */
+
+static void *readSnapshot(void *pvReader)
+{
+   struct Reader *psReader = (struct Reader*)pvReader;
+   int i;
+
+   assert(psReader != NULL);
+
+   if (SymTable_getLength(psReader->oSnapshot)
+      != (size_t)psReader->iCount)
+      psReader->lFailures++;
+   for (i = 0; i < psReader->iCount; i++)
+      if (SymTable_get(psReader->oSnapshot, psReader->pacKeys[i])
+         != psReader->pacKeys[i])
+         psReader->lFailures++;
+   SymTable_free(psReader->oSnapshot);
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test that threads can read and free snapshots while the table they
+   were taken from changes. Use iBindingCount bindings. */
+
+static void testReaders(int iBindingCount)
+{
+   SymTable_T oSymTable;
+   struct Reader asReaders[READERS];
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   int iSuccessful;
+   int i;
+
+   pacKeys = makeKeys(iBindingCount);
+   ASSURE(pacKeys != NULL);
+   if (pacKeys == NULL)
+      return;
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      iSuccessful = SymTable_put(oSymTable, pacKeys[i], pacKeys[i]);
+      ASSURE(iSuccessful);
+   }
+
+   for (i = 0; i < READERS; i++)
+   {
+      asReaders[i].oSnapshot = SymTable_snapshot(oSymTable);
+      ASSURE(asReaders[i].oSnapshot != NULL);
+      asReaders[i].pacKeys = pacKeys;
+      asReaders[i].iCount = iBindingCount;
+      asReaders[i].lFailures = 0;
+      asReaders[i].iStarted = 0;
+      if (asReaders[i].oSnapshot != NULL)
+      {
+         asReaders[i].iStarted = pthread_create(&asReaders[i].oThread,
+            NULL, readSnapshot, &asReaders[i]) == 0;
+         ASSURE(asReaders[i].iStarted);
+         if (! asReaders[i].iStarted)
+            readSnapshot(&asReaders[i]);
+      }
+   }
+
+   /* Empty the table and fill it again while the readers run. */
+   for (i = 0; i < iBindingCount; i++)
+      ASSURE(SymTable_remove(oSymTable, pacKeys[i]) == pacKeys[i]);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      iSuccessful = SymTable_put(oSymTable, pacKeys[i], NULL);
+      ASSURE(iSuccessful);
+   }
+
+   for (i = 0; i < READERS; i++)
+   {
+      if (asReaders[i].iStarted)
+         pthread_join(asReaders[i].oThread, NULL);
+      ASSURE(asReaders[i].lFailures == 0);
+   }
+
+   ASSURE(SymTable_getLength(oSymTable) == (size_t)iBindingCount);
+   for (i = 0; i < iBindingCount; i++)
+      ASSURE(SymTable_contains(oSymTable, pacKeys[i]));
+   SymTable_free(oSymTable);
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_snapshot() with about iBindingCount bindings. */
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+
+   if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s bindingcount\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1)
+   {
+      fprintf(stderr, "bindingcount must be numeric\n");
+      exit(EXIT_FAILURE);
+   }
+   if (iBindingCount < 0)
+   {
+      fprintf(stderr, "bindingcount cannot be negative\n");
+      exit(EXIT_FAILURE);
+   }
+
+   testIsolation();
+   testVersions(iBindingCount);
+   testCollisions();
+   testReaders(iBindingCount);
+
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}
@@ -0,0 +1,447 @@
+/*--------------------------------------------------------------------*/
+/* testsymtablethreads.c                                              */
+/* Author: Kevin Castro                                               */
+/*--------------------------------------------------------------------*/
+
+/* For clock_gettime, which measures the elapsed time that throughput
+   is judged by. */
+#define _POSIX_C_SOURCE 199309L
+
+#include "symtable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/* Length of the buffer each test key is printed into. */
+enum {MAX_KEY_LENGTH = 12};
+
+/* Largest number of threads any test starts. */
+enum {MAX_THREADS = 8};
+
+/* The keys the threads of a test share, and the part of them one
+   thread works on. */
+struct Worker
+{
+   SymTable_T oSymTable;
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   /* The thread's own keys are pacKeys[iFirst] to pacKeys[iLast-1]. */
+   int iFirst;
+   int iLast;
+   /* Number of keys every thread works on, for tests where threads
+      share them. */
+   int iShared;
+   /* What the thread counted: puts that succeeded, or lookups that
+      found their key. */
+   long lCount;
+   /* The function the thread runs, given the Worker. */
+   void *(*pfWork)(void *);
+   pthread_t oThread;
+   /* Nonzero if oThread is running pfWork. */
+   int iStarted;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of seconds since some fixed moment. */
+
+static double now(void)
+{
+   struct timespec sTime;
+   clock_gettime(CLOCK_MONOTONIC, &sTime);
+   return (double)sTime.tv_sec + (double)sTime.tv_nsec / 1e9;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return an array of iCount keys, the decimal numerals 0 to iCount-1,
+   or NULL if memory allocation fails. */
+
+static char (*makeKeys(int iCount))[MAX_KEY_LENGTH]
+{
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   int i;
+
+   pacKeys = (char(*)[MAX_KEY_LENGTH])malloc(
+      (size_t)(iCount > 0 ? iCount : 1) * MAX_KEY_LENGTH);
+   if (pacKeys == NULL)
+      return NULL;
+   for (i = 0; i < iCount; i++)
+      sprintf(pacKeys[i], "%d", i);
+   return pacKeys;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Start each of the first iThreadCount workers of asWorkers in a
+   thread of its own, and wait for all of them. A worker whose thread
+   cannot be started runs in the calling thread instead. */
+
+static void runWorkers(struct Worker asWorkers[], int iThreadCount)
+{
+   int i;
+
+   for (i = 0; i < iThreadCount; i++)
+   {
+      asWorkers[i].iStarted = pthread_create(&asWorkers[i].oThread,
+         NULL, asWorkers[i].pfWork, &asWorkers[i]) == 0;
+      ASSURE(asWorkers[i].iStarted);
+      if (! asWorkers[i].iStarted)
+         (*asWorkers[i].pfWork)(&asWorkers[i]);
+   }
+   for (i = 0; i < iThreadCount; i++)
+      if (asWorkers[i].iStarted)
+         pthread_join(asWorkers[i].oThread, NULL);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Split iCount keys between iThreadCount workers, all of which run
+   pfWork on oSymTable and share the first iShared keys. */
+
+static void setUpWorkers(struct Worker asWorkers[], int iThreadCount,
+   void *(*pfWork)(void *), SymTable_T oSymTable,
+   char (*pacKeys)[MAX_KEY_LENGTH], int iCount, int iShared)
+{
+   int i;
+
+   for (i = 0; i < iThreadCount; i++)
+   {
+      asWorkers[i].oSymTable = oSymTable;
+      asWorkers[i].pacKeys = pacKeys;
+      asWorkers[i].iFirst = iShared
+         + (int)((long)(iCount - iShared) * i / iThreadCount);
+      asWorkers[i].iLast = iShared
+         + (int)((long)(iCount - iShared) * (i + 1) / iThreadCount);
+      asWorkers[i].iShared = iShared;
+      asWorkers[i].lCount = 0;
+      asWorkers[i].pfWork = pfWork;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put the worker's own keys, then race the other threads to put each
+   shared key. Count the puts that succeed. */
+
+static void *putKeys(void *pvWorker)
+{
+   struct Worker *psWorker = (struct Worker*)pvWorker;
+   int i;
+
+   for (i = psWorker->iFirst; i < psWorker->iLast; i++)
+   {
+      ASSURE(SymTable_put(psWorker->oSymTable, psWorker->pacKeys[i],
+         psWorker->pacKeys[i]));
+      psWorker->lCount++;
+   }
+   for (i = 0; i < psWorker->iShared; i++)
+      if (SymTable_put(psWorker->oSymTable, psWorker->pacKeys[i],
+         psWorker->pacKeys[i]))
+         psWorker->lCount++;
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Remove every other key of the worker's own keys. */
+
+static void *removeKeys(void *pvWorker)
+{
+   struct Worker *psWorker = (struct Worker*)pvWorker;
+   int i;
+
+   for (i = psWorker->iFirst; i < psWorker->iLast; i++)
+      if (i % 2 == 0)
+         ASSURE(SymTable_remove(psWorker->oSymTable,
+            psWorker->pacKeys[i]) == psWorker->pacKeys[i]);
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Look up the worker's own keys, which must all be bound, and count
+   the lookups. */
+
+static void *getKeys(void *pvWorker)
+{
+   struct Worker *psWorker = (struct Worker*)pvWorker;
+   int i;
+
+   for (i = psWorker->iFirst; i < psWorker->iLast; i++)
+      if (SymTable_get(psWorker->oSymTable, psWorker->pacKeys[i])
+          == psWorker->pacKeys[i])
+         psWorker->lCount++;
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put and then remove the worker's own keys, none of which are bound
+   to begin with, several times over. */
+
+static void *churnKeys(void *pvWorker)
+{
+   enum {CHURN_ROUNDS = 4};
+   struct Worker *psWorker = (struct Worker*)pvWorker;
+   int iRound;
+   int i;
+
+   for (iRound = 0; iRound < CHURN_ROUNDS; iRound++)
+   {
+      for (i = psWorker->iFirst; i < psWorker->iLast; i++)
+         ASSURE(SymTable_put(psWorker->oSymTable, psWorker->pacKeys[i],
+            psWorker->pacKeys[i]));
+      for (i = psWorker->iFirst; i < psWorker->iLast; i++)
+         ASSURE(SymTable_remove(psWorker->oSymTable,
+            psWorker->pacKeys[i]) == psWorker->pacKeys[i]);
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Look up the shared keys, which must stay bound the whole time, in
+   several passes. */
+
+static void *getShared(void *pvWorker)
+{
+   enum {READ_PASSES = 8};
+   struct Worker *psWorker = (struct Worker*)pvWorker;
+   int iPass;
+   int i;
+
+   for (iPass = 0; iPass < READ_PASSES; iPass++)
+      for (i = 0; i < psWorker->iShared; i++)
+         ASSURE(SymTable_get(psWorker->oSymTable, psWorker->pacKeys[i])
+            == psWorker->pacKeys[i]);
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Increment *pvExtra, a long. */
+
+static void countBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvValue != NULL);
+   assert(pvExtra != NULL);
+
+   (*(long*)pvExtra)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Have MAX_THREADS threads put iBindingCount keys at once, growing the
+   table many times over, with an eighth of the keys put by every
+   thread, then remove half the keys at once. */
+
+static void testConcurrentUpdates(int iBindingCount)
+{
+   struct Worker asWorkers[MAX_THREADS];
+   SymTable_T oSymTable;
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   long lPuts = 0;
+   long lMapped = 0;
+   int iShared;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing concurrent puts and removes.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   pacKeys = makeKeys(iBindingCount);
+   ASSURE(pacKeys != NULL);
+   if (pacKeys == NULL)
+      return;
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   iShared = iBindingCount / 8;
+   setUpWorkers(asWorkers, MAX_THREADS, putKeys, oSymTable, pacKeys,
+      iBindingCount, iShared);
+   runWorkers(asWorkers, MAX_THREADS);
+
+   /* Each shared key was put by exactly one thread. */
+   for (i = 0; i < MAX_THREADS; i++)
+      lPuts += asWorkers[i].lCount;
+   ASSURE(lPuts == iBindingCount);
+   ASSURE(SymTable_getLength(oSymTable) == (size_t)iBindingCount);
+   for (i = 0; i < iBindingCount; i++)
+      ASSURE(SymTable_get(oSymTable, pacKeys[i]) == pacKeys[i]);
+
+   setUpWorkers(asWorkers, MAX_THREADS, removeKeys, oSymTable, pacKeys,
+      iBindingCount, 0);
+   runWorkers(asWorkers, MAX_THREADS);
+
+   ASSURE(SymTable_getLength(oSymTable)
+      == (size_t)(iBindingCount / 2));
+   for (i = 0; i < iBindingCount; i++)
+      ASSURE(SymTable_contains(oSymTable, pacKeys[i]) == (i % 2));
+   SymTable_map(oSymTable, countBinding, &lMapped);
+   ASSURE(lMapped == iBindingCount / 2);
+
+   SymTable_free(oSymTable);
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Have readers look up a fixed set of keys while writers put and
+   remove other keys, resizing the table under the readers. */
+
+static void testReadersAndWriters(int iBindingCount)
+{
+   enum {READERS = MAX_THREADS / 2};
+   struct Worker asWorkers[MAX_THREADS];
+   SymTable_T oSymTable;
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   int iShared;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing readers alongside writers.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   pacKeys = makeKeys(iBindingCount);
+   ASSURE(pacKeys != NULL);
+   if (pacKeys == NULL)
+      return;
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* The readers' keys are put before any thread starts. */
+   iShared = iBindingCount / 4;
+   for (i = 0; i < iShared; i++)
+      ASSURE(SymTable_put(oSymTable, pacKeys[i], pacKeys[i]));
+
+   setUpWorkers(asWorkers, MAX_THREADS - READERS, churnKeys, oSymTable,
+      pacKeys, iBindingCount, iShared);
+   setUpWorkers(asWorkers + MAX_THREADS - READERS, READERS, getShared,
+      oSymTable, pacKeys, iShared, iShared);
+   runWorkers(asWorkers, MAX_THREADS);
+
+   ASSURE(SymTable_getLength(oSymTable) == (size_t)iShared);
+
+   SymTable_free(oSymTable);
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Look up iBindingCount bound keys, split between 1, 2, 4, and up to
+   MAX_THREADS threads. Write the elapsed time and lookup rate of each
+   thread count to stdout. */
+
+static void testReadScaling(int iBindingCount)
+{
+   enum {LOOKUP_ROUNDS = 4};
+   struct Worker asWorkers[MAX_THREADS];
+   SymTable_T oSymTable;
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   int iThreadCount;
+   int iRound;
+   int i;
+   long lFound;
+   double dStart;
+   double dSeconds;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing read throughput as threads are added.\n");
+   printf("No output except elapsed time should appear here:\n");
+   fflush(stdout);
+
+   pacKeys = makeKeys(iBindingCount);
+   ASSURE(pacKeys != NULL);
+   if (pacKeys == NULL)
+      return;
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < iBindingCount; i++)
+      ASSURE(SymTable_put(oSymTable, pacKeys[i], pacKeys[i]));
+
+   for (iThreadCount = 1; iThreadCount <= MAX_THREADS; iThreadCount *= 2)
+   {
+      setUpWorkers(asWorkers, iThreadCount, getKeys, oSymTable, pacKeys,
+         iBindingCount, 0);
+      dStart = now();
+      for (iRound = 0; iRound < LOOKUP_ROUNDS; iRound++)
+         runWorkers(asWorkers, iThreadCount);
+      dSeconds = now() - dStart;
+
+      lFound = 0;
+      for (i = 0; i < iThreadCount; i++)
+         lFound += asWorkers[i].lCount;
+      ASSURE(lFound == (long)iBindingCount * LOOKUP_ROUNDS);
+
+      printf("Elapsed time (%d lookups, %d threads):  %f seconds"
+         "  (%.0f lookups/second)\n", iBindingCount * LOOKUP_ROUNDS,
+         iThreadCount, dSeconds,
+         dSeconds > 0.0 ? lFound / dSeconds : 0.0);
+      fflush(stdout);
+   }
+
+   SymTable_free(oSymTable);
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a SymTable implementation that may be used by several threads
+   at once. argv[1] is the number of bindings to use in each test.
+   Exit with EXIT_FAILURE if argv[1] is missing or not a nonnegative
+   number. Otherwise return 0. */
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+
+   if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s bindingcount\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1)
+   {
+      fprintf(stderr, "bindingcount must be numeric\n");
+      exit(EXIT_FAILURE);
+   }
+   if (iBindingCount < 0)
+   {
+      fprintf(stderr, "bindingcount cannot be negative\n");
+      exit(EXIT_FAILURE);
+   }
+
+   testConcurrentUpdates(iBindingCount);
+   testReadersAndWriters(iBindingCount);
+   testReadScaling(iBindingCount);
+
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}